@@ -0,0 +1,520 @@
+/*------------------------------------------------------------------------------
+	oglh_ frame capture -- streaming the FBO to disk without stalling
+
+	The render thread only ever issues glReadPixels into a PBO, polls fences
+	with a zero timeout and maps buffers whose fence has already signalled,
+	none of which wait on the GPU or the disk. Each PBO slot goes around:
+
+	FREE -> READING -> MAPPED -> WRITTEN -> FREE
+
+	READING	glReadPixels issued, waiting on the fence	(render thread)
+	MAPPED	mapped and queued for the writer			(writer thread)
+	WRITTEN	the writer is done with the mapping			(render thread)
+
+	Mapping and unmapping must happen on the GL thread, the writer only reads
+	through the pointer it is given.
+------------------------------------------------------------------------------*/
+#include "OpenGL_capture.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+#include <pthread.h>		//	POSIX threads
+#include <semaphore.h>		//	POSIX semaphores
+#include <stdatomic.h>		//	(since C11) Atomic operations
+#ifdef __SSE2__
+#include <emmintrin.h>		//	SSE2 intrinsics
+#endif
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define SLOT_FREE		0
+#define SLOT_READING	1
+#define SLOT_MAPPED		2
+#define SLOT_WRITTEN	3
+
+typedef struct capture_slot
+{
+	GLuint pbo_id;
+	GLsync fence;
+	long frame_number;
+	const unsigned char *pixels;	// the mapping, valid while MAPPED
+	atomic_int state;
+}
+CAPTURE_SLOT;
+
+static struct
+{
+	bool active;
+	int format, width, height;
+	size_t frame_bytes;
+	char file_name[FILENAME_MAX];
+	FILE *y4m_fptr;
+	GLuint frame_buffer_id;
+
+	CAPTURE_SLOT slot[OGLH_CAPTURE_RING_SIZE];
+	int next_read_slot;		// where the next glReadPixels goes
+	int next_map_slot;		// the oldest read still waiting on its fence
+
+	// single producer (render) single consumer (writer) queue of slots
+	int queue[OGLH_CAPTURE_RING_SIZE];
+	atomic_uint queue_head, queue_tail;
+	sem_t queue_items;
+	atomic_bool quit;
+	pthread_t writer_thread;
+
+	// writer thread only
+	unsigned char *plane_buffer;
+
+	long captured, dropped;
+	atomic_long written;
+}
+capture;
+/*------------------------------------------------------------------------------
+	BT.601 studio range luma for one row, four pixels at a time with SSE2
+------------------------------------------------------------------------------*/
+static void rgba_row_to_luma
+(
+	const unsigned char *rgba, unsigned char *luma, int width
+)
+{
+	int x = 0;
+
+#ifdef __SSE2__
+	const __m128i coefficients = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+	const __m128i rounding = _mm_set1_epi32(128 + (16 << 8));
+	const __m128i zero = _mm_setzero_si128();
+
+	for(; x + 4 <= width; x += 4)
+	{
+		__m128i pixels, low, high, even, odd, y;
+		int four_lumas;
+
+		pixels = _mm_loadu_si128((const __m128i *)(rgba + 4 * x));
+		// each pixel becomes a pair of sums: 66r + 129g and 25b + 0a
+		low  = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients);
+		high = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients);
+
+		even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low),
+			_mm_castsi128_ps(high), _MM_SHUFFLE(2, 0, 2, 0)));
+		odd  = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(low),
+			_mm_castsi128_ps(high), _MM_SHUFFLE(3, 1, 3, 1)));
+
+		y = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), rounding), 8);
+		y = _mm_packs_epi32(y, y);
+		y = _mm_packus_epi16(y, y);
+		four_lumas = _mm_cvtsi128_si32(y);
+		memcpy(luma + x, &four_lumas, 4);
+	}
+#endif
+
+	for(; x < width; x++)
+	{
+		const unsigned char *p = rgba + 4 * x;
+		luma[x] = ((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16;
+	}
+}
+/*------------------------------------------------------------------------------
+	4:2:0 chroma from the average of each 2x2 block of two rows
+------------------------------------------------------------------------------*/
+static void rgba_rows_to_chroma
+(
+	const unsigned char *row_0, const unsigned char *row_1,
+	unsigned char *u, unsigned char *v, int width
+)
+{
+	int x, r, g, b;
+
+	for(x = 0; x < width; x += 2)
+	{
+		const unsigned char *p = row_0 + 4 * x, *q = row_1 + 4 * x;
+
+		r = (p[0] + p[4] + q[0] + q[4] + 2) >> 2;
+		g = (p[1] + p[5] + q[1] + q[5] + 2) >> 2;
+		b = (p[2] + p[6] + q[2] + q[6] + 2) >> 2;
+
+		u[x / 2] = ((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+		v[x / 2] = ((112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+	}
+}
+/*------------------------------------------------------------------------------
+	GL rows are bottom up, Y4M and PPM are top down
+------------------------------------------------------------------------------*/
+static void write_y4m_frame(const unsigned char *pixels)
+{
+	int y, width = capture.width, height = capture.height;
+	size_t stride = 4 * (size_t)width;
+	unsigned char *luma, *u, *v;
+
+	luma = capture.plane_buffer;
+	u = luma + (size_t)width * height;
+	v = u + (size_t)(width / 2) * (height / 2);
+
+	for(y = 0; y < height; y++)
+	{
+		rgba_row_to_luma(pixels + (height - 1 - y) * stride,
+			luma + (size_t)y * width, width);
+	}
+
+	for(y = 0; y < height; y += 2)
+	{
+		rgba_rows_to_chroma
+		(
+			pixels + (height - 1 - y) * stride,
+			pixels + (height - 2 - y) * stride,
+			u + (size_t)(y / 2) * (width / 2),
+			v + (size_t)(y / 2) * (width / 2),
+			width
+		);
+	}
+
+	fputs("FRAME\n", capture.y4m_fptr);
+	fwrite(capture.plane_buffer, (size_t)width * height * 3 / 2, 1,
+		capture.y4m_fptr);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void write_ppm_frame(const unsigned char *pixels, long frame_number)
+{
+	char ppm_file[FILENAME_MAX];
+	FILE *ppm_fptr;
+	int x, y, width = capture.width, height = capture.height;
+	unsigned char *rgb = capture.plane_buffer;
+
+	snprintf(ppm_file, sizeof(ppm_file), capture.file_name, frame_number);
+
+	if((ppm_fptr = fopen(ppm_file, "wb")) == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"capture can't open frame file: %s", ppm_file);
+		return;
+	}
+
+	fprintf(ppm_fptr, "P6\n%d %d\n255\n", width, height);
+	for(y = height - 1; y >= 0; y--)
+	{
+		const unsigned char *row = pixels + (size_t)y * width * 4;
+
+		for(x = 0; x < width; x++)
+		{
+			rgb[3 * x + 0] = row[4 * x + 0];
+			rgb[3 * x + 1] = row[4 * x + 1];
+			rgb[3 * x + 2] = row[4 * x + 2];
+		}
+		fwrite(rgb, 3 * (size_t)width, 1, ppm_fptr);
+	}
+	fclose(ppm_fptr);
+}
+/*------------------------------------------------------------------------------
+	The writer sleeps on the semaphore, one post per queued frame plus a
+	final post to quit once the queue has drained
+------------------------------------------------------------------------------*/
+static void *capture_writer_thread(void *unused)
+{
+	unsigned int head;
+	CAPTURE_SLOT *slot;
+
+	(void)unused;
+	for(;;)
+	{
+		sem_wait(&capture.queue_items);
+
+		head = atomic_load_explicit(&capture.queue_head, memory_order_relaxed);
+		if(head == atomic_load_explicit(&capture.queue_tail, memory_order_acquire))
+		{
+			if(atomic_load(&capture.quit)) break;
+			continue;
+		}
+
+		slot = &capture.slot[capture.queue[head % OGLH_CAPTURE_RING_SIZE]];
+		atomic_store_explicit(&capture.queue_head, head + 1, memory_order_release);
+
+		if(capture.format == OGLH_CAPTURE_Y4M)
+			write_y4m_frame(slot->pixels);
+		else
+			write_ppm_frame(slot->pixels, slot->frame_number);
+
+		atomic_store_explicit(&slot->state, SLOT_WRITTEN, memory_order_release);
+		atomic_fetch_add(&capture.written, 1);
+	}
+	return NULL;
+}
+/*------------------------------------------------------------------------------
+	render thread: map a slot whose fence has signalled and queue it
+------------------------------------------------------------------------------*/
+static void queue_slot_for_writer(int index)
+{
+	CAPTURE_SLOT *slot = &capture.slot[index];
+	unsigned int tail;
+
+	glDeleteSync(slot->fence);
+	slot->fence = NULL;
+
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, slot->pbo_id);
+	slot->pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+		capture.frame_bytes, GL_MAP_READ_BIT);
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if(slot->pixels == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"capture failed to map PBO %d", slot->pbo_id);
+		atomic_store(&slot->state, SLOT_WRITTEN);	// unmap and reuse it
+		return;
+	}
+
+	atomic_store_explicit(&slot->state, SLOT_MAPPED, memory_order_relaxed);
+	// there is one queue entry per slot so the queue can never overflow
+	tail = atomic_load_explicit(&capture.queue_tail, memory_order_relaxed);
+	capture.queue[tail % OGLH_CAPTURE_RING_SIZE] = index;
+	atomic_store_explicit(&capture.queue_tail, tail + 1, memory_order_release);
+	sem_post(&capture.queue_items);
+}
+/*------------------------------------------------------------------------------
+	render thread: unmap whatever the writer has finished with
+------------------------------------------------------------------------------*/
+static void reclaim_written_slots(void)
+{
+	int index;
+	CAPTURE_SLOT *slot;
+
+	for(index = 0; index < OGLH_CAPTURE_RING_SIZE; index++)
+	{
+		slot = &capture.slot[index];
+		if(atomic_load_explicit(&slot->state, memory_order_acquire) != SLOT_WRITTEN)
+			continue;
+
+		if(slot->pixels != NULL)
+		{
+			oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, slot->pbo_id);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot->pixels = NULL;
+		}
+		atomic_store_explicit(&slot->state, SLOT_FREE, memory_order_relaxed);
+	}
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+/*------------------------------------------------------------------------------
+	render thread: hand over finished reads in the order they were issued,
+	a timeout of zero just polls -- wait_for_gpu is for draining at the end
+------------------------------------------------------------------------------*/
+static void queue_finished_reads(bool wait_for_gpu)
+{
+	CAPTURE_SLOT *slot;
+	GLenum status;
+
+	for(;;)
+	{
+		slot = &capture.slot[capture.next_map_slot];
+		if(atomic_load(&slot->state) != SLOT_READING) break;
+
+		status = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+			wait_for_gpu ? 1000000000ull : 0);
+		if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+
+		queue_slot_for_writer(capture.next_map_slot);
+		capture.next_map_slot =
+			(capture.next_map_slot + 1) % OGLH_CAPTURE_RING_SIZE;
+	}
+}
+/*------------------------------------------------------------------------------
+	The PBOs, the file and the buffer, whichever have been made -- for
+	oglh_capture_stop and a start that fails part way
+------------------------------------------------------------------------------*/
+static void release_capture(void)
+{
+	int index;
+
+	for(index = 0; index < OGLH_CAPTURE_RING_SIZE; index++)
+	{
+		if(capture.slot[index].fence != NULL)
+			glDeleteSync(capture.slot[index].fence);
+		capture.slot[index].fence = NULL;
+		oglh_registry_delete(OGLH_OBJECT_BUFFER, capture.slot[index].pbo_id);
+		capture.slot[index].pbo_id = 0;
+	}
+
+	if(capture.y4m_fptr != NULL) fclose(capture.y4m_fptr);
+	capture.y4m_fptr = NULL;
+	free(capture.plane_buffer);
+	capture.plane_buffer = NULL;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_capture_start(const char *file_name, int format, int frame_rate)
+{
+	int index;
+	size_t plane_bytes;
+
+	OGLH_NOTE_CALL_SITE();
+	if(capture.active)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"capture is already running");
+		return;
+	}
+
+	capture.frame_buffer_id =
+		oglh_get_rendering_fbo(&capture.width, &capture.height);
+	if(capture.frame_buffer_id == 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"capture needs oglh_set_rendering_to_fbo to be called first");
+		return;
+	}
+
+	capture.format = format;
+	capture.frame_bytes = 4 * (size_t)capture.width * capture.height;
+	snprintf(capture.file_name, sizeof(capture.file_name), "%s", file_name);
+
+	switch(format)
+	{
+		case OGLH_CAPTURE_Y4M:
+			if(capture.width % 2 != 0 || capture.height % 2 != 0)
+			{
+				oglh_program_error(__FILE__, __LINE__, __FUNC__,
+					"Y4M capture needs an even width and height, not %d x %d",
+					capture.width, capture.height);
+				return;
+			}
+			if((capture.y4m_fptr = fopen(file_name, "wb")) == NULL)
+			{
+				oglh_program_error(__FILE__, __LINE__, __FUNC__,
+					"capture can't open file: %s", file_name);
+				return;
+			}
+			fprintf(capture.y4m_fptr,
+				"YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n",
+				capture.width, capture.height, frame_rate);
+			plane_bytes = (size_t)capture.width * capture.height * 3 / 2;
+		break;
+
+		case OGLH_CAPTURE_PPM:
+			capture.y4m_fptr = NULL;
+			plane_bytes = 3 * (size_t)capture.width;	// one row
+		break;
+
+		default:
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"unrecognized capture format: %d", format);
+			return;
+	}
+
+	if((capture.plane_buffer = (unsigned char *)malloc(plane_bytes)) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"capture out of memory opening buffer");
+		release_capture();
+		return;
+	}
+
+	for(index = 0; index < OGLH_CAPTURE_RING_SIZE; index++)
+	{
+		oglh_generate_and_bind_opengl_object(GL_PIXEL_PACK_BUFFER,
+			&capture.slot[index].pbo_id);
+		glBufferData(GL_PIXEL_PACK_BUFFER, capture.frame_bytes, NULL,
+			GL_STREAM_READ);
+		oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, capture.slot[index].pbo_id,
+			capture.frame_bytes);
+		capture.slot[index].fence = NULL;
+		capture.slot[index].pixels = NULL;
+		atomic_init(&capture.slot[index].state, SLOT_FREE);
+	}
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	capture.next_read_slot = capture.next_map_slot = 0;
+	atomic_init(&capture.queue_head, 0);
+	atomic_init(&capture.queue_tail, 0);
+	atomic_init(&capture.quit, false);
+	atomic_init(&capture.written, 0);
+	capture.captured = capture.dropped = 0;
+	sem_init(&capture.queue_items, 0, 0);
+
+	if(pthread_create(&capture.writer_thread, NULL, capture_writer_thread, NULL))
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"capture failed to start the writer thread");
+		sem_destroy(&capture.queue_items);
+		release_capture();
+		return;
+	}
+
+	capture.active = true;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Call once per frame when the FBO holds the finished image
+------------------------------------------------------------------------------*/
+void oglh_capture_frame(void)
+{
+	CAPTURE_SLOT *slot;
+	GLint read_frame_buffer, pack_buffer, alignment;
+
+	if(!capture.active) return;
+	OGLH_NOTE_CALL_SITE();
+
+	reclaim_written_slots();
+	queue_finished_reads(false);
+
+	slot = &capture.slot[capture.next_read_slot];
+	if(atomic_load(&slot->state) != SLOT_FREE)
+	{
+		capture.dropped++;	// the writer is behind -- never wait for it
+		return;
+	}
+
+	// the caller's bindings and pack alignment are put back
+	oglh_state_get_integerv(GL_READ_FRAMEBUFFER_BINDING, &read_frame_buffer);
+	oglh_state_get_integerv(GL_PIXEL_PACK_BUFFER_BINDING, &pack_buffer);
+	oglh_state_get_integerv(GL_PACK_ALIGNMENT, &alignment);
+	oglh_state_bind_framebuffer(GL_READ_FRAMEBUFFER, capture.frame_buffer_id);
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, slot->pbo_id);
+	if(alignment != 4) glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	// with a PBO bound this only queues the copy, the data pointer is an offset
+	glReadPixels(0, 0, capture.width, capture.height,
+		GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+	if(alignment != 4) glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+	oglh_state_bind_buffer(GL_PIXEL_PACK_BUFFER, pack_buffer);
+	oglh_state_bind_framebuffer(GL_READ_FRAMEBUFFER, read_frame_buffer);
+
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot->frame_number = capture.captured++;
+	atomic_store(&slot->state, SLOT_READING);
+	capture.next_read_slot = (capture.next_read_slot + 1) % OGLH_CAPTURE_RING_SIZE;
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Drains everything still in flight -- this one does wait
+------------------------------------------------------------------------------*/
+void oglh_capture_stop(void)
+{
+	if(!capture.active) return;
+	OGLH_NOTE_CALL_SITE();
+
+	queue_finished_reads(true);
+	atomic_store(&capture.quit, true);
+	sem_post(&capture.queue_items);
+	pthread_join(capture.writer_thread, NULL);
+
+	reclaim_written_slots();
+	sem_destroy(&capture.queue_items);
+	release_capture();
+
+	capture.active = false;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_capture_get_statistics(OGLH_CAPTURE_STATISTICS *statistics)
+{
+	statistics->captured = capture.captured;
+	statistics->written = atomic_load(&capture.written);
+	statistics->dropped = capture.dropped;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,56 @@
+/*------------------------------------------------------------------------------
+	oglh_ frame capture -- streaming the FBO to disk without stalling
+
+	The FBO made by oglh_set_rendering_to_fbo is read back into a small ring
+	of pixel pack buffers (PBOs). glReadPixels into a PBO returns at once; a
+	frame or two later, when its fence has signalled, the PBO is mapped and
+	the mapped pointer is handed to a writer thread through a bounded
+	lock-free queue. The writer does the RGB to YUV conversion and all the
+	disk I/O so the render thread never waits on either.
+
+	If the writer falls behind and every PBO is still busy the frame is
+	dropped, and counted, rather than making the render thread wait.
+
+	Typical use:
+
+	oglh_set_rendering_to_fbo(1920, 1080);
+	oglh_capture_start("render.y4m", OGLH_CAPTURE_Y4M, 30);
+	while(rendering)
+	{
+		... draw ...
+		oglh_capture_frame();
+		oglh_blit_fbo_to_front_buffer();
+	}
+	oglh_capture_stop();
+
+	OGLH_CAPTURE_Y4M writes a single YUV4MPEG2 (4:2:0) stream, width and
+	height must be even. OGLH_CAPTURE_PPM writes one binary PPM per frame
+	and the file name is a printf pattern such as "frames/frame_%06d.ppm".
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_CAPTURE_Y4M			1
+#define OGLH_CAPTURE_PPM			2
+
+#define OGLH_CAPTURE_RING_SIZE		4	// PBOs in flight, a power of two
+
+typedef struct oglh_capture_statistics
+{
+	long captured;	// frames read back from the FBO
+	long written;	// frames the writer thread has put on disk
+	long dropped;	// frames skipped because the writer fell behind
+}
+OGLH_CAPTURE_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_capture_start(const char *file_name, int format, int frame_rate);
+void oglh_capture_frame(void);
+void oglh_capture_stop(void);
+void oglh_capture_get_statistics(OGLH_CAPTURE_STATISTICS *statistics);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,507 @@
+/*------------------------------------------------------------------------------
+	oglh_ command buffers -- helper calls recorded on any thread, made on
+	the GL thread
+
+	A command is a header, its opcode and length, and the call's arguments,
+	packed one after another in the buffer's memory and padded to 8 bytes.
+
+	The submit queue is an intrusive multi-producer single-consumer queue
+	after Dmitry Vyukov's: a push is one atomic exchange of the tail and a
+	store linking the previous buffer to the new one. The GL thread follows
+	the links from the head. A push that is half done, between the exchange
+	and the link, hides the buffers behind it until the next execute -- they
+	are late, never out of order.
+
+	Executed buffers go back to their thread on a stack of their arena's.
+	The GL thread pushes, the owner takes the whole stack at once, so there
+	is no ABA problem to worry about.
+------------------------------------------------------------------------------*/
+#include "OpenGL_commands.h"
+#include "OpenGL_state.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_counted_calls.h"
+#include <stdatomic.h>		//	(since C11) Atomic operations
+#include <stddef.h>			//	offsetof
+#include <stdint.h>			//	Fixed-width integer types
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OP_USE_PROGRAM		1
+#define OP_UNIFORM			2
+#define OP_BIND_TEXTURE		3
+#define OP_BLIT				4
+#define OP_DRAW_ARRAYS		5
+#define OP_DRAW_ELEMENTS	6
+
+#define COMMAND_ALIGNMENT	8
+#define MAX_UNIFORM_BYTES	64		// a mat4
+
+typedef struct command_header
+{
+	uint32_t opcode;
+	uint32_t bytes;				// this command's, header and padding too
+}
+COMMAND_HEADER;
+
+typedef struct command_use_program
+{
+	COMMAND_HEADER header;
+	GLuint program_id;
+}
+COMMAND_USE_PROGRAM;
+
+typedef struct command_uniform
+{
+	COMMAND_HEADER header;
+	int type;
+	unsigned char data[MAX_UNIFORM_BYTES];
+	char variable_name[];		// as long as it is
+}
+COMMAND_UNIFORM;
+
+typedef struct command_bind_texture
+{
+	COMMAND_HEADER header;
+	int unit;
+	GLenum target;
+	GLuint texture_id;
+}
+COMMAND_BIND_TEXTURE;
+
+typedef struct command_draw
+{
+	COMMAND_HEADER header;
+	GLenum mode;
+	GLint first;				// draw arrays
+	GLsizei count;
+	GLenum type;				// draw elements
+	GLintptr offset;
+}
+COMMAND_DRAW;
+
+typedef struct thread_arena THREAD_ARENA;
+
+struct oglh_command_buffer
+{
+	_Atomic(OGLH_COMMAND_BUFFER *) next;	// in the queue or returned stack
+	OGLH_COMMAND_BUFFER *next_free;			// the owner's list
+	OGLH_COMMAND_BUFFER *next_allocated;	// every buffer of the arena
+	THREAD_ARENA *arena;
+
+	unsigned char *memory;
+	size_t used, allocated;
+	int commands;
+	bool broken;							// a command didn't fit
+};
+
+struct thread_arena
+{
+	OGLH_COMMAND_BUFFER *free;				// owner thread only
+	_Atomic(OGLH_COMMAND_BUFFER *) returned;	// pushed by the GL thread
+	OGLH_COMMAND_BUFFER *allocated;			// owner thread only
+	THREAD_ARENA *next;						// every arena, for shutdown
+};
+
+static struct
+{
+	_Atomic(OGLH_COMMAND_BUFFER *) tail;	// producers
+	OGLH_COMMAND_BUFFER *head;				// the GL thread
+	OGLH_COMMAND_BUFFER stub;
+
+	_Atomic(THREAD_ARENA *) arenas;
+	atomic_uint generation;					// of arenas, one a shutdown
+
+	atomic_long submitted, threads;
+	long executed, commands, bytes;
+}
+queue = { .tail = &queue.stub, .head = &queue.stub };
+
+// stale once the arenas of its generation have been freed
+static _Thread_local THREAD_ARENA *thread_arena;
+static _Thread_local unsigned int thread_arena_generation;
+/*------------------------------------------------------------------------------
+	bytes of data behind the void pointer oglh_set_uniform_variable takes
+------------------------------------------------------------------------------*/
+static int uniform_data_bytes(int type)
+{
+	switch(type)
+	{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_FLOAT:			return 4;
+		case GL_FLOAT_VEC2:		return 8;
+		case GL_FLOAT_VEC3:		return 12;
+		case GL_FLOAT_VEC4:		return 16;
+		case GL_FLOAT_MAT4:		return 64;
+		default:				return 0;
+	}
+}
+/*------------------------------------------------------------------------------
+	The calling thread's arena, made the first time it records
+------------------------------------------------------------------------------*/
+static THREAD_ARENA *calling_thread_arena(void)
+{
+	THREAD_ARENA *arena;
+	unsigned int generation = atomic_load(&queue.generation);
+
+	if(thread_arena != NULL && thread_arena_generation == generation)
+		return thread_arena;
+
+	if((arena = calloc(1, sizeof(THREAD_ARENA))) == NULL) return NULL;
+	atomic_init(&arena->returned, NULL);
+
+	arena->next = atomic_load(&queue.arenas);
+	while(!atomic_compare_exchange_weak(&queue.arenas, &arena->next, arena));
+	atomic_fetch_add(&queue.threads, 1);
+
+	thread_arena = arena;
+	thread_arena_generation = generation;
+	return arena;
+}
+/*------------------------------------------------------------------------------
+	Room for a command of bytes at the end of the buffer, or NULL and the
+	buffer broken if there's no memory for it
+------------------------------------------------------------------------------*/
+static void *append(OGLH_COMMAND_BUFFER *buffer, int opcode, size_t bytes)
+{
+	COMMAND_HEADER *header;
+	unsigned char *larger;
+	size_t allocate;
+
+	if(buffer == NULL || buffer->broken) return NULL;
+
+	bytes = (bytes + COMMAND_ALIGNMENT - 1) & ~(size_t)(COMMAND_ALIGNMENT - 1);
+	if(buffer->used + bytes > buffer->allocated)
+	{
+		allocate = buffer->allocated ? buffer->allocated : OGLH_COMMAND_BUFFER_SIZE;
+		while(allocate < buffer->used + bytes) allocate *= 2;
+		if((larger = realloc(buffer->memory, allocate)) == NULL)
+		{
+			buffer->broken = true;
+			return NULL;
+		}
+		buffer->memory = larger;
+		buffer->allocated = allocate;
+	}
+
+	header = (COMMAND_HEADER *)(buffer->memory + buffer->used);
+	header->opcode = opcode;
+	header->bytes = bytes;
+	buffer->used += bytes;
+	buffer->commands++;
+	return header;
+}
+
+static void reset(OGLH_COMMAND_BUFFER *buffer)
+{
+	buffer->used = 0;
+	buffer->commands = 0;
+	buffer->broken = false;
+}
+/*------------------------------------------------------------------------------
+	Recording, any thread
+------------------------------------------------------------------------------*/
+OGLH_COMMAND_BUFFER *oglh_commands_begin(void)
+{
+	THREAD_ARENA *arena;
+	OGLH_COMMAND_BUFFER *buffer, *returned;
+
+	if((arena = calling_thread_arena()) == NULL) return NULL;
+
+	if(arena->free == NULL)		// take back what the GL thread has finished
+	{
+		returned = atomic_exchange(&arena->returned, NULL);
+		while(returned != NULL)
+		{
+			buffer = returned;
+			returned = atomic_load_explicit(&buffer->next, memory_order_relaxed);
+			buffer->next_free = arena->free;
+			arena->free = buffer;
+		}
+	}
+
+	if((buffer = arena->free) != NULL)
+	{
+		arena->free = buffer->next_free;
+	}
+	else
+	{
+		if((buffer = calloc(1, sizeof(OGLH_COMMAND_BUFFER))) == NULL) return NULL;
+		buffer->arena = arena;
+		buffer->next_allocated = arena->allocated;
+		arena->allocated = buffer;
+	}
+
+	reset(buffer);
+	return buffer;
+}
+
+void oglh_commands_use_program(OGLH_COMMAND_BUFFER *buffer, GLuint program_id)
+{
+	COMMAND_USE_PROGRAM *command;
+
+	if((command = append(buffer, OP_USE_PROGRAM, sizeof(*command))) == NULL)
+		return;
+	command->program_id = program_id;
+}
+
+void oglh_commands_uniform
+(
+	OGLH_COMMAND_BUFFER *buffer, const char *variable_name, int type,
+	const void *data
+)
+{
+	COMMAND_UNIFORM *command;
+	size_t name_length = strlen(variable_name) + 1;
+	int bytes = uniform_data_bytes(type);
+
+	if(bytes == 0)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't record uniform %s of type %d", variable_name, type);
+		return;
+	}
+
+	if((command = append(buffer, OP_UNIFORM,
+		offsetof(COMMAND_UNIFORM, variable_name) + name_length)) == NULL)
+	{
+		return;
+	}
+	command->type = type;
+	memcpy(command->data, data, bytes);
+	memcpy(command->variable_name, variable_name, name_length);
+}
+
+void oglh_commands_bind_texture
+(
+	OGLH_COMMAND_BUFFER *buffer, int unit, GLenum target, GLuint texture_id
+)
+{
+	COMMAND_BIND_TEXTURE *command;
+
+	if((command = append(buffer, OP_BIND_TEXTURE, sizeof(*command))) == NULL)
+		return;
+	command->unit = unit;
+	command->target = target;
+	command->texture_id = texture_id;
+}
+
+void oglh_commands_blit(OGLH_COMMAND_BUFFER *buffer)
+{
+	append(buffer, OP_BLIT, sizeof(COMMAND_HEADER));
+}
+
+void oglh_commands_draw_arrays
+(
+	OGLH_COMMAND_BUFFER *buffer, GLenum mode, GLint first, GLsizei count
+)
+{
+	COMMAND_DRAW *command;
+
+	if((command = append(buffer, OP_DRAW_ARRAYS, sizeof(*command))) == NULL)
+		return;
+	command->mode = mode;
+	command->first = first;
+	command->count = count;
+}
+
+void oglh_commands_draw_elements
+(
+	OGLH_COMMAND_BUFFER *buffer, GLenum mode, GLsizei count, GLenum type,
+	GLintptr offset
+)
+{
+	COMMAND_DRAW *command;
+
+	if((command = append(buffer, OP_DRAW_ELEMENTS, sizeof(*command))) == NULL)
+		return;
+	command->mode = mode;
+	command->count = count;
+	command->type = type;
+	command->offset = offset;
+}
+/*------------------------------------------------------------------------------
+	A broken buffer is still submitted, what it holds is executed and the
+	GL thread reports the commands that were lost
+------------------------------------------------------------------------------*/
+static void push(OGLH_COMMAND_BUFFER *buffer)
+{
+	OGLH_COMMAND_BUFFER *previous;
+
+	atomic_store_explicit(&buffer->next, NULL, memory_order_relaxed);
+	previous = atomic_exchange_explicit(&queue.tail, buffer, memory_order_acq_rel);
+	atomic_store_explicit(&previous->next, buffer, memory_order_release);
+}
+
+void oglh_commands_submit(OGLH_COMMAND_BUFFER *buffer)
+{
+	if(buffer == NULL) return;
+	push(buffer);
+	atomic_fetch_add_explicit(&queue.submitted, 1, memory_order_relaxed);
+}
+
+void oglh_commands_discard(OGLH_COMMAND_BUFFER *buffer)
+{
+	if(buffer == NULL) return;
+	buffer->next_free = buffer->arena->free;
+	buffer->arena->free = buffer;
+}
+/*------------------------------------------------------------------------------
+	GL thread: the oldest buffer submitted, or NULL if there's none yet
+------------------------------------------------------------------------------*/
+static OGLH_COMMAND_BUFFER *pop(void)
+{
+	OGLH_COMMAND_BUFFER *head = queue.head, *next, *tail;
+
+	next = atomic_load_explicit(&head->next, memory_order_acquire);
+	if(head == &queue.stub)
+	{
+		if(next == NULL) return NULL;
+		queue.head = head = next;
+		next = atomic_load_explicit(&head->next, memory_order_acquire);
+	}
+	if(next != NULL)
+	{
+		queue.head = next;
+		return head;
+	}
+
+	tail = atomic_load_explicit(&queue.tail, memory_order_acquire);
+	if(head != tail) return NULL;		// a push is half done
+
+	push(&queue.stub);					// so the last buffer can be taken
+	next = atomic_load_explicit(&head->next, memory_order_acquire);
+	if(next != NULL)
+	{
+		queue.head = next;
+		return head;
+	}
+	return NULL;
+}
+
+static void return_to_arena(OGLH_COMMAND_BUFFER *buffer)
+{
+	THREAD_ARENA *arena = buffer->arena;
+	OGLH_COMMAND_BUFFER *top = atomic_load(&arena->returned);
+
+	do atomic_store_explicit(&buffer->next, top, memory_order_relaxed);
+	while(!atomic_compare_exchange_weak(&arena->returned, &top, buffer));
+}
+/*------------------------------------------------------------------------------
+	Each command is made with the call the thread would have made itself
+------------------------------------------------------------------------------*/
+static void execute(OGLH_COMMAND_BUFFER *buffer)
+{
+	unsigned char *next = buffer->memory, *end = buffer->memory + buffer->used;
+	COMMAND_HEADER *header;
+	COMMAND_UNIFORM *uniform;
+	COMMAND_BIND_TEXTURE *bind;
+	COMMAND_DRAW *draw;
+	float value[MAX_UNIFORM_BYTES / sizeof(float)];
+
+	for(; next < end; next += header->bytes)
+	{
+		header = (COMMAND_HEADER *)next;
+		switch(header->opcode)
+		{
+			case OP_USE_PROGRAM:
+				oglh_state_use_program(((COMMAND_USE_PROGRAM *)header)->program_id);
+			break;
+
+			case OP_UNIFORM:
+				uniform = (COMMAND_UNIFORM *)header;
+				memcpy(value, uniform->data, sizeof(value));
+				oglh_set_uniform_variable(uniform->variable_name,
+					uniform->type, value);
+			break;
+
+			case OP_BIND_TEXTURE:
+				bind = (COMMAND_BIND_TEXTURE *)header;
+				oglh_texture_units_bind(bind->unit, bind->target,
+					bind->texture_id);
+			break;
+
+			case OP_BLIT:
+				oglh_blit_fbo_to_front_buffer();
+			break;
+
+			case OP_DRAW_ARRAYS:
+				draw = (COMMAND_DRAW *)header;
+				oglh_draw_arrays(draw->mode, draw->first, draw->count);
+			break;
+
+			case OP_DRAW_ELEMENTS:
+				draw = (COMMAND_DRAW *)header;
+				oglh_draw_elements(draw->mode, draw->count, draw->type,
+					draw->offset);
+			break;
+		}
+	}
+
+	if(buffer->broken)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"a command buffer ran out of memory after %d commands",
+			buffer->commands);
+	}
+	queue.commands += buffer->commands;
+	queue.bytes += buffer->used;
+}
+/*------------------------------------------------------------------------------
+	GL thread
+------------------------------------------------------------------------------*/
+int oglh_commands_execute(void)
+{
+	OGLH_COMMAND_BUFFER *buffer;
+	int executed = 0;
+
+	OGLH_NOTE_CALL_SITE();
+	while((buffer = pop()) != NULL)
+	{
+		execute(buffer);
+		return_to_arena(buffer);
+		executed++;
+	}
+
+	queue.executed += executed;
+	return executed;
+}
+/*------------------------------------------------------------------------------
+	The workers must have stopped recording; what is still queued is
+	thrown away
+------------------------------------------------------------------------------*/
+void oglh_commands_shutdown(void)
+{
+	THREAD_ARENA *arena, *next_arena;
+	OGLH_COMMAND_BUFFER *buffer, *next_buffer;
+
+	OGLH_NOTE_CALL_SITE();
+	while(pop() != NULL);
+
+	arena = atomic_exchange(&queue.arenas, NULL);
+	for(; arena != NULL; arena = next_arena)
+	{
+		next_arena = arena->next;
+		for(buffer = arena->allocated; buffer != NULL; buffer = next_buffer)
+		{
+			next_buffer = buffer->next_allocated;
+			free(buffer->memory);
+			free(buffer);
+		}
+		free(arena);
+	}
+	atomic_fetch_add(&queue.generation, 1);
+}
+
+void oglh_commands_get_statistics(OGLH_COMMAND_STATISTICS *statistics)
+{
+	statistics->submitted = atomic_load(&queue.submitted);
+	statistics->executed = queue.executed;
+	statistics->commands = queue.commands;
+	statistics->bytes = queue.bytes;
+	statistics->threads = atomic_load(&queue.threads);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,88 @@
+/*------------------------------------------------------------------------------
+	oglh_ command buffers -- helper calls recorded on any thread, made on
+	the GL thread
+
+	The helpers must be called on the thread whose context is current. A
+	worker that only wants to set a uniform or draw can record the calls
+	into a command buffer instead and submit it; the GL thread executes
+	every submitted buffer, in the order they were submitted, through the
+	same oglh_ calls it would make itself.
+
+	worker thread:
+
+	OGLH_COMMAND_BUFFER *commands = oglh_commands_begin();
+	oglh_commands_uniform(commands, "model", GL_FLOAT_MAT4, model);
+	oglh_commands_bind_texture(commands, 1, GL_TEXTURE_2D, rock_texture);
+	oglh_commands_draw_elements(commands, GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+	oglh_commands_submit(commands);
+
+	GL thread, once a frame or as often as it likes:
+
+	oglh_commands_execute();
+
+	Recording takes no locks. Each thread records into buffers of its own,
+	an arena that grows to the most the thread has needed and is reused;
+	submitting pushes the buffer onto a lock-free queue that any number of
+	threads can push to and only the GL thread takes from. An executed
+	buffer goes back to the thread that recorded it.
+
+	A buffer belongs to the thread that began it until it is submitted --
+	don't record into it from another. Names and values are copied as they
+	are recorded. Call oglh_commands_shutdown on the GL thread once the
+	workers have finished, to free every thread's arena.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_COMMAND_BUFFER_SIZE	(16 * 1024)	// bytes to begin with
+
+typedef struct oglh_command_buffer OGLH_COMMAND_BUFFER;
+
+typedef struct oglh_command_statistics
+{
+	long submitted;			// buffers
+	long executed;			// buffers
+	long commands;			// executed
+	long bytes;				// of commands executed
+	long threads;			// that have recorded
+}
+OGLH_COMMAND_STATISTICS;
+/*------------------------------------------------------------------------------
+	Any thread
+------------------------------------------------------------------------------*/
+OGLH_COMMAND_BUFFER *oglh_commands_begin(void);		// NULL without memory
+
+void oglh_commands_use_program(OGLH_COMMAND_BUFFER *buffer, GLuint program_id);
+void oglh_commands_uniform
+(
+	OGLH_COMMAND_BUFFER *buffer, const char *variable_name, int type,
+	const void *data
+);
+void oglh_commands_bind_texture
+(
+	OGLH_COMMAND_BUFFER *buffer, int unit, GLenum target, GLuint texture_id
+);
+void oglh_commands_blit(OGLH_COMMAND_BUFFER *buffer);
+void oglh_commands_draw_arrays
+(
+	OGLH_COMMAND_BUFFER *buffer, GLenum mode, GLint first, GLsizei count
+);
+void oglh_commands_draw_elements
+(
+	OGLH_COMMAND_BUFFER *buffer, GLenum mode, GLsizei count, GLenum type,
+	GLintptr offset
+);
+
+void oglh_commands_submit(OGLH_COMMAND_BUFFER *buffer);
+void oglh_commands_discard(OGLH_COMMAND_BUFFER *buffer);	// unsubmitted
+/*------------------------------------------------------------------------------
+	GL thread
+------------------------------------------------------------------------------*/
+int oglh_commands_execute(void);			// buffers executed
+void oglh_commands_shutdown(void);
+void oglh_commands_get_statistics(OGLH_COMMAND_STATISTICS *statistics);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,102 @@
+/*------------------------------------------------------------------------------
+	oglh_ contexts -- the helpers' caches, one set per GL context
+
+	Each module keeps a thread local pointer to its part of the current
+	oglh context, so a helper reaches its cache in one load with no call
+	through here. Making a context current sets them all.
+------------------------------------------------------------------------------*/
+#include "OpenGL_context.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_timers.h"
+#include "OpenGL_instancing.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+struct oglh_context
+{
+	char label[OGLH_CONTEXT_LABEL_SIZE];
+	void *helpers;
+	void *state;
+	void *texture_units;
+	void *registry;
+	void *timers;
+	void *instancing;
+};
+
+static _Thread_local OGLH_CONTEXT *current_context;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+OGLH_CONTEXT *oglh_context_create(const char *label)
+{
+	OGLH_CONTEXT *context;
+
+	OGLH_NOTE_CALL_SITE();
+	if((context = calloc(1, sizeof(OGLH_CONTEXT))) == NULL ||
+		(context->helpers = oglh_helpers_new_context()) == NULL ||
+		(context->state = oglh_state_new_context()) == NULL ||
+		(context->texture_units = oglh_texture_units_new_context()) == NULL ||
+		(context->registry = oglh_registry_new_context()) == NULL ||
+		(context->timers = oglh_timers_new_context()) == NULL ||
+		(context->instancing = oglh_instancing_new_context()) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for oglh context %s", label != NULL ? label : "");
+		oglh_context_delete(context);
+		return NULL;
+	}
+
+	snprintf(context->label, sizeof(context->label), "%s",
+		label != NULL ? label : "");
+	return context;
+}
+/*------------------------------------------------------------------------------
+	Nothing is known of the GL context yet, the caches fill as they are used
+------------------------------------------------------------------------------*/
+void oglh_context_make_current(OGLH_CONTEXT *context)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(context == current_context) return;
+
+	current_context = context;
+	oglh_helpers_use_context(context != NULL ? context->helpers : NULL);
+	oglh_state_use_context(context != NULL ? context->state : NULL);
+	oglh_texture_units_use_context(context != NULL ?
+		context->texture_units : NULL);
+	oglh_registry_use_context(context != NULL ? context->registry : NULL);
+	oglh_timers_use_context(context != NULL ? context->timers : NULL);
+	oglh_instancing_use_context(context != NULL ? context->instancing : NULL);
+}
+
+OGLH_CONTEXT *oglh_context_get_current(void)
+{
+	return current_context;
+}
+
+const char *oglh_context_get_label(const OGLH_CONTEXT *context)
+{
+	return context != NULL ? context->label : "default";
+}
+/*------------------------------------------------------------------------------
+	Each part goes back to the default on this thread if it was current
+------------------------------------------------------------------------------*/
+void oglh_context_delete(OGLH_CONTEXT *context)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(context == NULL) return;
+
+	if(context == current_context) current_context = NULL;
+	oglh_helpers_delete_context(context->helpers);
+	oglh_state_delete_context(context->state);
+	oglh_texture_units_delete_context(context->texture_units);
+	oglh_registry_delete_context(context->registry);
+	oglh_timers_delete_context(context->timers);
+	oglh_instancing_delete_context(context->instancing);
+	free(context);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
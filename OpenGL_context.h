@@ -0,0 +1,55 @@
+/*------------------------------------------------------------------------------
+	oglh_ contexts -- the helpers' caches, one set per GL context
+
+	The helpers remember a lot about the GL context they work on: the state
+	cache (OpenGL_state.h), the texture units (OpenGL_texture_units.h), the
+	object registry (OpenGL_registry.h), the timers' queries
+	(OpenGL_timers.h), the instanced layouts and batch (OpenGL_instancing.h),
+	the rendering FBO and the uniform locations. With one GL context that is one set of caches and nothing
+	to do. With several -- a window per thread, say -- give each GL
+	context an oglh context and make it current alongside the GL context:
+
+	OGLH_CONTEXT *context = oglh_context_create("left window");
+	...
+	glXMakeCurrent(display, left_window, left_gl_context);	// on this thread
+	oglh_context_make_current(context);
+	... helpers as usual, with the left window's caches
+	...
+	oglh_context_make_current(NULL);
+	oglh_context_delete(context);
+
+	The current oglh context is thread local, like the GL context, so the
+	helpers find their caches with no locking. A thread that never makes
+	one current uses the default set, shared by every such thread -- which
+	is the single context case. An oglh context must be current on one
+	thread at a time, and belongs to one GL context: making it current
+	with another GL context gives the caches that context's state.
+
+	oglh_context_delete frees the caches and makes no GL calls, so it can
+	come after the GL context is gone. It must not be current on another
+	thread; on this one the default set takes over. If the GL context
+	carries on, call oglh_registry_release_free_ids, oglh_timer_delete_all
+	and oglh_batch_shutdown before it.
+
+	Frame capture and the trace remain one per process and belong to one
+	rendering thread; the counters add up every thread's calls.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_CONTEXT_LABEL_SIZE		64
+
+typedef struct oglh_context OGLH_CONTEXT;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+OGLH_CONTEXT *oglh_context_create(const char *label);
+void oglh_context_make_current(OGLH_CONTEXT *context);	// NULL: the default
+OGLH_CONTEXT *oglh_context_get_current(void);			// NULL: the default
+const char *oglh_context_get_label(const OGLH_CONTEXT *context);
+void oglh_context_delete(OGLH_CONTEXT *context);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,79 @@
+/*------------------------------------------------------------------------------
+	For the oglh_ sources only: with OGLH_COUNTERS defined the GL entry
+	points of interest are wrapped so that every call is counted. Include
+	this after the GL headers. A macro isn't expanded inside its own
+	expansion so the GL function is still what gets called.
+
+	glGetError is counted in oglh_error_check itself.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_counters.h"
+
+#ifdef OGLH_COUNTERS
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_COUNTED(entry_point, call) \
+	(oglh_count_gl_call(entry_point), call)
+
+#define glUniform1i(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1i(__VA_ARGS__))
+#define glUniform2i(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform2i(__VA_ARGS__))
+#define glUniform3i(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform3i(__VA_ARGS__))
+#define glUniform4i(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform4i(__VA_ARGS__))
+#define glUniform1f(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1f(__VA_ARGS__))
+#define glUniform2f(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform2f(__VA_ARGS__))
+#define glUniform3f(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform3f(__VA_ARGS__))
+#define glUniform4f(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform4f(__VA_ARGS__))
+#define glUniform1iv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1iv(__VA_ARGS__))
+#define glUniform2iv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform2iv(__VA_ARGS__))
+#define glUniform3iv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform3iv(__VA_ARGS__))
+#define glUniform4iv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform4iv(__VA_ARGS__))
+#define glUniform1uiv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1uiv(__VA_ARGS__))
+#define glUniform2uiv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform2uiv(__VA_ARGS__))
+#define glUniform3uiv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform3uiv(__VA_ARGS__))
+#define glUniform4uiv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform4uiv(__VA_ARGS__))
+#define glUniform1fv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1fv(__VA_ARGS__))
+#define glUniform2fv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform2fv(__VA_ARGS__))
+#define glUniform3fv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform3fv(__VA_ARGS__))
+#define glUniform4fv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform4fv(__VA_ARGS__))
+#define glUniform1dv(...)			OGLH_COUNTED(OGLH_GL_UNIFORM, glUniform1dv(__VA_ARGS__))
+#define glUniformMatrix2fv(...)		OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix2fv(__VA_ARGS__))
+#define glUniformMatrix3fv(...)		OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix3fv(__VA_ARGS__))
+#define glUniformMatrix4fv(...)		OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix4fv(__VA_ARGS__))
+#define glUniformMatrix2x3fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix2x3fv(__VA_ARGS__))
+#define glUniformMatrix2x4fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix2x4fv(__VA_ARGS__))
+#define glUniformMatrix3x2fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix3x2fv(__VA_ARGS__))
+#define glUniformMatrix3x4fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix3x4fv(__VA_ARGS__))
+#define glUniformMatrix4x2fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix4x2fv(__VA_ARGS__))
+#define glUniformMatrix4x3fv(...)	OGLH_COUNTED(OGLH_GL_UNIFORM, glUniformMatrix4x3fv(__VA_ARGS__))
+
+#define glGetUniformiv(...)			OGLH_COUNTED(OGLH_GL_GET_UNIFORM, glGetUniformiv(__VA_ARGS__))
+#define glGetUniformuiv(...)		OGLH_COUNTED(OGLH_GL_GET_UNIFORM, glGetUniformuiv(__VA_ARGS__))
+#define glGetUniformfv(...)			OGLH_COUNTED(OGLH_GL_GET_UNIFORM, glGetUniformfv(__VA_ARGS__))
+#define glGetUniformdv(...)			OGLH_COUNTED(OGLH_GL_GET_UNIFORM, glGetUniformdv(__VA_ARGS__))
+#define glGetUniformLocation(...)	OGLH_COUNTED(OGLH_GL_GET_UNIFORM, glGetUniformLocation(__VA_ARGS__))
+
+#define glBindTexture(...)			OGLH_COUNTED(OGLH_GL_BIND_TEXTURE, glBindTexture(__VA_ARGS__))
+#define glActiveTexture(...)		OGLH_COUNTED(OGLH_GL_BIND_TEXTURE, glActiveTexture(__VA_ARGS__))
+#define glBindTextures(...)			OGLH_COUNTED(OGLH_GL_BIND_TEXTURE, glBindTextures(__VA_ARGS__))
+
+#define glUseProgram(...)			OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glUseProgram(__VA_ARGS__))
+#define glBindFramebuffer(...)		OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glBindFramebuffer(__VA_ARGS__))
+#define glBindRenderbuffer(...)		OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glBindRenderbuffer(__VA_ARGS__))
+#define glBindBuffer(...)			OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glBindBuffer(__VA_ARGS__))
+#define glBindVertexArray(...)		OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glBindVertexArray(__VA_ARGS__))
+#define glBindBufferBase(...)		OGLH_COUNTED(OGLH_GL_BIND_OBJECT, glBindBufferBase(__VA_ARGS__))
+
+#define glEnable(...)				OGLH_COUNTED(OGLH_GL_STATE, glEnable(__VA_ARGS__))
+#define glDisable(...)				OGLH_COUNTED(OGLH_GL_STATE, glDisable(__VA_ARGS__))
+#define glBlendFunc(...)			OGLH_COUNTED(OGLH_GL_STATE, glBlendFunc(__VA_ARGS__))
+#define glViewport(...)				OGLH_COUNTED(OGLH_GL_STATE, glViewport(__VA_ARGS__))
+#define glDrawBuffer(...)			OGLH_COUNTED(OGLH_GL_STATE, glDrawBuffer(__VA_ARGS__))
+#define glReadBuffer(...)			OGLH_COUNTED(OGLH_GL_STATE, glReadBuffer(__VA_ARGS__))
+
+#define glGetIntegerv(...)			OGLH_COUNTED(OGLH_GL_GET_INTEGERV, glGetIntegerv(__VA_ARGS__))
+
+#endif
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,265 @@
+/*------------------------------------------------------------------------------
+	oglh_ counters -- how many GL calls each helper makes per frame
+
+	A helper is identified by its function name as noted by
+	OGLH_NOTE_CALL_SITE on entry. __func__ of a given function is one
+	static string so the pointer is enough to tell helpers apart, and the
+	last helper seen is remembered so the common case is one compare.
+
+	Every thread that counts has a table of its own, so counting takes no
+	lock and shares no cache line. A thread's counts only ever grow, each
+	written by that thread alone; oglh_counters_new_frame reads them all
+	and keeps what it read, so the difference is the frame's. Tables are
+	linked in as threads start counting and never taken out.
+------------------------------------------------------------------------------*/
+#include "OpenGL_helpers.h"
+#include "OpenGL_counters.h"
+
+#ifdef OGLH_COUNTERS
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef struct helper_counters
+{
+	const char *helper_name;
+	long last_frame[OGLH_GL_ENTRY_POINTS];
+	long total[OGLH_GL_ENTRY_POINTS];
+}
+HELPER_COUNTERS;
+
+typedef struct thread_helper
+{
+	const char *helper_name;
+	long count[OGLH_GL_ENTRY_POINTS];		// written by its thread alone
+	long read[OGLH_GL_ENTRY_POINTS];		// by the last new frame
+}
+THREAD_HELPER;
+
+typedef struct thread_counters
+{
+	THREAD_HELPER helper[OGLH_COUNTER_MAX_HELPERS];
+	int number_of_helpers;
+	int last_helper;
+	struct thread_counters *next;
+}
+THREAD_COUNTERS;
+
+static const char not_in_a_helper[] = "(not in a helper)";
+
+static HELPER_COUNTERS helper_counters[OGLH_COUNTER_MAX_HELPERS] =
+{
+	{ not_in_a_helper, { 0 }, { 0 } }
+};
+static int number_of_helpers = 1;
+static long counter_frame = 0;
+static int report_interval = 0;
+
+static THREAD_COUNTERS *counting_threads;
+static _Thread_local THREAD_COUNTERS *thread_counters;
+
+static const char *entry_point_name[OGLH_GL_ENTRY_POINTS] =
+{
+	"uniform", "get uniform", "texture", "bind", "state", "getint", "geterror"
+};
+/*------------------------------------------------------------------------------
+	This thread's table, made and linked in on its first count; NULL if
+	there's no memory for one, then the thread isn't counted
+------------------------------------------------------------------------------*/
+static THREAD_COUNTERS *start_counting(void)
+{
+	THREAD_COUNTERS *counters;
+
+	if((counters = calloc(1, sizeof(THREAD_COUNTERS))) == NULL) return NULL;
+
+	counters->helper[0].helper_name = not_in_a_helper;
+	counters->number_of_helpers = 1;
+	counters->next = __atomic_load_n(&counting_threads, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&counting_threads, &counters->next,
+		counters, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return thread_counters = counters;
+}
+
+static int find_thread_helper(THREAD_COUNTERS *counters, const char *helper_name)
+{
+	int index;
+
+	for(index = 0; index < counters->number_of_helpers; index++)
+	{
+		if(counters->helper[index].helper_name == helper_name) return index;
+	}
+
+	if(index >= OGLH_COUNTER_MAX_HELPERS) return 0;
+
+	// the name is in place before new_frame can see the entry
+	counters->helper[index].helper_name = helper_name;
+	__atomic_store_n(&counters->number_of_helpers, index + 1, __ATOMIC_RELEASE);
+	return index;
+}
+
+static HELPER_COUNTERS *find_helper(const char *helper_name)
+{
+	int index;
+
+	for(index = 0; index < number_of_helpers; index++)
+	{
+		if(helper_counters[index].helper_name == helper_name)
+			return &helper_counters[index];
+	}
+
+	if(number_of_helpers >= OGLH_COUNTER_MAX_HELPERS) return &helper_counters[0];
+
+	helper_counters[number_of_helpers].helper_name = helper_name;
+	return &helper_counters[number_of_helpers++];
+}
+/*------------------------------------------------------------------------------
+	The hot path
+------------------------------------------------------------------------------*/
+void oglh_count_gl_call(int entry_point)
+{
+	THREAD_COUNTERS *counters = thread_counters;
+	const OGLH_CALL_SITE *site = oglh_current_call_site;
+	const char *helper_name = site != NULL ? site->func : not_in_a_helper;
+	long *count;
+
+	if(counters == NULL && (counters = start_counting()) == NULL) return;
+
+	if(counters->helper[counters->last_helper].helper_name != helper_name)
+		counters->last_helper = find_thread_helper(counters, helper_name);
+
+	count = &counters->helper[counters->last_helper].count[entry_point];
+	__atomic_store_n(count, *count + 1, __ATOMIC_RELAXED);
+}
+/*------------------------------------------------------------------------------
+	Every thread's calls since the last call become "last frame", which is
+	what is reported
+------------------------------------------------------------------------------*/
+void oglh_counters_new_frame(void)
+{
+	THREAD_COUNTERS *counters;
+	THREAD_HELPER *helper;
+	HELPER_COUNTERS *merged;
+	int index, entry_point, helpers;
+	long count;
+
+	for(index = 0; index < number_of_helpers; index++)
+	{
+		memset(helper_counters[index].last_frame, 0,
+			sizeof(helper_counters[index].last_frame));
+	}
+
+	for(counters = __atomic_load_n(&counting_threads, __ATOMIC_ACQUIRE);
+		counters != NULL; counters = counters->next)
+	{
+		helpers = __atomic_load_n(&counters->number_of_helpers, __ATOMIC_ACQUIRE);
+		for(index = 0; index < helpers; index++)
+		{
+			helper = &counters->helper[index];
+			merged = find_helper(helper->helper_name);
+			for(entry_point = 0; entry_point < OGLH_GL_ENTRY_POINTS; entry_point++)
+			{
+				count = __atomic_load_n(&helper->count[entry_point],
+					__ATOMIC_RELAXED);
+				merged->last_frame[entry_point] += count - helper->read[entry_point];
+				helper->read[entry_point] = count;
+			}
+		}
+	}
+
+	for(index = 0; index < number_of_helpers; index++)
+	{
+		for(entry_point = 0; entry_point < OGLH_GL_ENTRY_POINTS; entry_point++)
+		{
+			helper_counters[index].total[entry_point] +=
+				helper_counters[index].last_frame[entry_point];
+		}
+	}
+
+	counter_frame++;
+	if(report_interval > 0 && counter_frame % report_interval == 0)
+		oglh_counters_report(stdout);
+}
+/*------------------------------------------------------------------------------
+	last frame's count for one helper, or for all of them if helper_name is
+	NULL; entry_point -1 sums every entry point
+------------------------------------------------------------------------------*/
+long oglh_counters_get(const char *helper_name, int entry_point)
+{
+	int index, group;
+	long count = 0;
+
+	for(index = 0; index < number_of_helpers; index++)
+	{
+		if(helper_name != NULL &&
+			strcmp(helper_counters[index].helper_name, helper_name))
+		{
+			continue;
+		}
+
+		for(group = 0; group < OGLH_GL_ENTRY_POINTS; group++)
+		{
+			if(entry_point < 0 || entry_point == group)
+				count += helper_counters[index].last_frame[group];
+		}
+	}
+	return count;
+}
+/*------------------------------------------------------------------------------
+	zero turns the periodic report off
+------------------------------------------------------------------------------*/
+void oglh_counters_set_report_interval(int frames)
+{
+	report_interval = frames;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_counters_report(FILE *report_fptr)
+{
+	int index, entry_point;
+	long sum[OGLH_GL_ENTRY_POINTS] = { 0 };
+	HELPER_COUNTERS *counters;
+
+	fprintf
+	(
+		report_fptr,
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+	fprintf(report_fptr, ANSI_COLOR_GREEN "\tGL calls in frame %-12ld",
+		counter_frame);
+	for(entry_point = 0; entry_point < OGLH_GL_ENTRY_POINTS; entry_point++)
+		fprintf(report_fptr, " %9s", entry_point_name[entry_point]);
+	fprintf(report_fptr, "\n" ANSI_COLOR_RESET);
+
+	for(index = 0; index < number_of_helpers; index++)
+	{
+		counters = &helper_counters[index];
+		fprintf(report_fptr, "\t%-30s", counters->helper_name);
+		for(entry_point = 0; entry_point < OGLH_GL_ENTRY_POINTS; entry_point++)
+		{
+			fprintf(report_fptr, " %9ld", counters->last_frame[entry_point]);
+			sum[entry_point] += counters->last_frame[entry_point];
+		}
+		fprintf(report_fptr, "\n");
+	}
+
+	fprintf(report_fptr, ANSI_COLOR_YELLOW "\t%-30s", "all helpers");
+	for(entry_point = 0; entry_point < OGLH_GL_ENTRY_POINTS; entry_point++)
+		fprintf(report_fptr, " %9ld", sum[entry_point]);
+	fprintf(report_fptr, "\n" ANSI_COLOR_RESET);
+	fprintf
+	(
+		report_fptr,
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#endif
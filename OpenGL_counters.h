@@ -0,0 +1,77 @@
+/*------------------------------------------------------------------------------
+	oglh_ counters -- how many GL calls each helper makes per frame
+
+	Build with OGLH_COUNTERS defined to count the GL entry points that the
+	helpers call, grouped as below and attributed to the oglh_ helper that
+	issued them. Without OGLH_COUNTERS everything here compiles to nothing,
+	the functions become empty inlines so calling code needn't change.
+
+	oglh_counters_new_frame();			// once per frame
+	...
+	printf("%ld uniform sets last frame\n",
+		oglh_counters_get(NULL, OGLH_GL_UNIFORM));
+	printf("%ld of them from oglh_set_uniform_value\n",
+		oglh_counters_get("oglh_set_uniform_value", OGLH_GL_UNIFORM));
+
+	oglh_counters_set_report_interval(600) prints the per-helper table of
+	the last frame every 600 frames.
+
+	Only calls made from inside the helpers are counted; the helpers' own
+	sources include OpenGL_counted_calls.h which wraps the GL entry points.
+	Each thread counts into a table of its own -- several rendering
+	threads, the resource thread, texture loaders -- and
+	oglh_counters_new_frame adds them all up, so a frame's counts are
+	every thread's since the last one. Call oglh_counters_new_frame and
+	read the counters on one thread.
+------------------------------------------------------------------------------*/
+#pragma once
+#include <stdio.h>			//	Input/output
+/*------------------------------------------------------------------------------
+	GL entry point groups
+------------------------------------------------------------------------------*/
+#define OGLH_GL_UNIFORM				0	// glUniform*
+#define OGLH_GL_GET_UNIFORM			1	// glGetUniform*, glGetUniformLocation
+#define OGLH_GL_BIND_TEXTURE		2	// glBindTexture, glActiveTexture
+#define OGLH_GL_BIND_OBJECT			3	// program, framebuffer, buffer, VAO
+#define OGLH_GL_STATE				4	// enable, blend, viewport, draw/read
+#define OGLH_GL_GET_INTEGERV		5	// glGetIntegerv
+#define OGLH_GL_GET_ERROR			6	// glGetError
+#define OGLH_GL_ENTRY_POINTS		7
+
+#define OGLH_COUNTER_MAX_HELPERS	64
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#ifdef OGLH_COUNTERS
+
+#define OGLH_COUNT_GL_CALL(entry_point) oglh_count_gl_call(entry_point)
+
+void oglh_count_gl_call(int entry_point);
+void oglh_counters_new_frame(void);
+long oglh_counters_get(const char *helper_name, int entry_point);
+void oglh_counters_set_report_interval(int frames);
+void oglh_counters_report(FILE *report_fptr);
+
+#else
+
+#define OGLH_COUNT_GL_CALL(entry_point) do { } while(0)
+
+static inline void oglh_counters_new_frame(void) { }
+static inline long oglh_counters_get(const char *helper_name, int entry_point)
+{
+	(void)helper_name; (void)entry_point;
+	return 0;
+}
+static inline void oglh_counters_set_report_interval(int frames)
+{
+	(void)frames;
+}
+static inline void oglh_counters_report(FILE *report_fptr)
+{
+	(void)report_fptr;
+}
+
+#endif
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
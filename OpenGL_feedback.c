@@ -0,0 +1,276 @@
+/*------------------------------------------------------------------------------
+	oglh_ transform feedback -- simulation state that stays on the GPU
+
+	Each buffer has a vertex array that reads it and a transform feedback
+	object that captures into it, made once, so an update is a few binds
+	and one draw. Vertex shaders alone write exactly one vertex per vertex
+	read, which is why the count can be kept on the CPU for the
+	glDrawArrays fallback without asking the GPU for it.
+------------------------------------------------------------------------------*/
+#include "OpenGL_feedback.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static bool have_feedback_objects(void)
+{
+#ifdef OGLH_FEEDBACK_DRAW_ARRAYS
+	return false;
+#else
+	return oglh_gl_version_or_extension(40, "GL_ARB_transform_feedback2");
+#endif
+}
+/*------------------------------------------------------------------------------
+	Leaves the first vertex array bound
+------------------------------------------------------------------------------*/
+bool oglh_feedback_create
+(
+	OGLH_FEEDBACK *feedback, GLsizei vertex_stride, GLsizei max_vertices,
+	const void *vertices, GLsizei vertex_count
+)
+{
+	GLsizeiptr bytes;
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(feedback, 0, sizeof(*feedback));
+
+	if(vertex_stride <= 0 || max_vertices <= 0 || vertex_count < 0 ||
+		vertex_count > max_vertices || (vertex_count > 0 && vertices == NULL))
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"bad transform feedback buffers: stride %d, %d of %d vertices",
+			vertex_stride, vertex_count, max_vertices);
+		return false;
+	}
+
+	feedback->vertex_stride = vertex_stride;
+	feedback->max_vertices = max_vertices;
+	feedback->vertex_count = vertex_count;
+	bytes = (GLsizeiptr)max_vertices * vertex_stride;
+
+	for(index = 1; index >= 0; index--)
+	{
+		oglh_generate_and_bind_opengl_object(GL_VERTEX_ARRAY,
+			&feedback->vertex_array_id[index]);
+		oglh_generate_and_bind_opengl_object(GL_ARRAY_BUFFER,
+			&feedback->buffer_id[index]);
+		glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_DYNAMIC_COPY);
+		oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, feedback->buffer_id[index],
+			bytes);
+	}
+	if(vertex_count > 0)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0,
+			(GLsizeiptr)vertex_count * vertex_stride, vertices);
+	}
+
+	if(have_feedback_objects())
+	{
+		glGenTransformFeedbacks(2, feedback->feedback_id);
+		for(index = 0; index < 2; index++)
+		{
+			glBindTransformFeedback(GL_TRANSFORM_FEEDBACK,
+				feedback->feedback_id[index]);
+			oglh_state_bind_buffer_base(GL_TRANSFORM_FEEDBACK_BUFFER, 0,
+				feedback->buffer_id[index]);
+		}
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+	}
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Floating point types are read as floats, integer types as integers
+------------------------------------------------------------------------------*/
+void oglh_feedback_attribute
+(
+	OGLH_FEEDBACK *feedback, GLuint location, GLint components, GLenum type,
+	GLsizei offset
+)
+{
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	for(index = 0; index < 2; index++)
+	{
+		oglh_state_bind_vertex_array(feedback->vertex_array_id[index]);
+		oglh_state_bind_buffer(GL_ARRAY_BUFFER, feedback->buffer_id[index]);
+
+		switch(type)
+		{
+			case GL_FLOAT:
+			case GL_HALF_FLOAT:
+			case GL_DOUBLE:
+				glVertexAttribPointer(location, components, type, GL_FALSE,
+					feedback->vertex_stride, (const void *)(intptr_t)offset);
+			break;
+
+			default:
+				glVertexAttribIPointer(location, components, type,
+					feedback->vertex_stride, (const void *)(intptr_t)offset);
+			break;
+		}
+		glEnableVertexAttribArray(location);
+	}
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Overwrites vertices of the latest state -- particles that died, say --
+	or adds them past the end; false if they don't fit
+------------------------------------------------------------------------------*/
+bool oglh_feedback_write
+(
+	OGLH_FEEDBACK *feedback, GLsizei first_vertex, GLsizei vertex_count,
+	const void *vertices
+)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(first_vertex < 0 || vertex_count < 0 ||
+		first_vertex > feedback->max_vertices - vertex_count)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"vertices %d to %d are past the %d there is room for",
+			first_vertex, first_vertex + vertex_count, feedback->max_vertices);
+		return false;
+	}
+	if(vertex_count == 0) return true;
+
+	oglh_state_bind_buffer(GL_ARRAY_BUFFER,
+		feedback->buffer_id[feedback->current]);
+	glBufferSubData(GL_ARRAY_BUFFER,
+		(GLintptr)first_vertex * feedback->vertex_stride,
+		(GLsizeiptr)vertex_count * feedback->vertex_stride, vertices);
+
+	if(first_vertex + vertex_count > feedback->vertex_count)
+	{
+		// the count transform feedback recorded is short now
+		feedback->vertex_count = first_vertex + vertex_count;
+		feedback->captured = false;
+	}
+
+	feedback->statistics.writes++;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	The current buffer's vertices, with the bound vertex array
+------------------------------------------------------------------------------*/
+static void draw_current(OGLH_FEEDBACK *feedback, GLenum mode)
+{
+	if(feedback->captured && feedback->feedback_id[feedback->current] != 0)
+	{
+		glDrawTransformFeedback(mode, feedback->feedback_id[feedback->current]);
+	}
+	else
+	{
+		glDrawArrays(mode, 0, feedback->vertex_count);
+	}
+}
+/*------------------------------------------------------------------------------
+	Runs the current program, installed with oglh_install_feedback_shader,
+	over the latest state and captures what it writes into the other
+	buffer, which then becomes the latest
+------------------------------------------------------------------------------*/
+void oglh_feedback_update(OGLH_FEEDBACK *feedback)
+{
+	int destination = 1 - feedback->current;
+	bool discarding;
+
+	OGLH_NOTE_CALL_SITE();
+	if(feedback->vertex_array_id[0] == 0 || feedback->vertex_count == 0) return;
+
+	oglh_state_bind_vertex_array(feedback->vertex_array_id[feedback->current]);
+	if(feedback->feedback_id[destination] != 0)
+	{
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK,
+			feedback->feedback_id[destination]);
+	}
+	else
+	{
+		oglh_state_bind_buffer_base(GL_TRANSFORM_FEEDBACK_BUFFER, 0,
+			feedback->buffer_id[destination]);
+	}
+
+	discarding = oglh_state_is_enabled(GL_RASTERIZER_DISCARD);
+	oglh_state_enable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	draw_current(feedback, GL_POINTS);
+	glEndTransformFeedback();
+	if(!discarding) oglh_state_disable(GL_RASTERIZER_DISCARD);
+
+	if(feedback->feedback_id[destination] != 0)
+		glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+	feedback->current = destination;
+	feedback->captured = true;
+	feedback->statistics.updates++;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	The latest state, with the current program
+------------------------------------------------------------------------------*/
+void oglh_feedback_draw(OGLH_FEEDBACK *feedback, GLenum mode)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(feedback->vertex_array_id[0] == 0 || feedback->vertex_count == 0) return;
+
+	oglh_state_bind_vertex_array(feedback->vertex_array_id[feedback->current]);
+	draw_current(feedback, mode);
+	feedback->statistics.draws++;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_feedback_delete(OGLH_FEEDBACK *feedback)
+{
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(feedback->vertex_array_id[0] == 0) return;
+
+	if(feedback->feedback_id[0] != 0)
+		glDeleteTransformFeedbacks(2, feedback->feedback_id);
+	for(index = 0; index < 2; index++)
+	{
+		oglh_registry_delete(OGLH_OBJECT_VERTEX_ARRAY,
+			feedback->vertex_array_id[index]);
+		oglh_registry_delete(OGLH_OBJECT_BUFFER, feedback->buffer_id[index]);
+	}
+	memset(feedback, 0, sizeof(*feedback));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+void oglh_feedback_get_statistics
+(
+	const OGLH_FEEDBACK *feedback, OGLH_FEEDBACK_STATISTICS *statistics
+)
+{
+	*statistics = feedback->statistics;
+}
+/*------------------------------------------------------------------------------
+	As oglh_install_shader, for a vertex shader whose outputs named in
+	varying are captured. The names need only last the call.
+------------------------------------------------------------------------------*/
+GLuint oglh_install_feedback_shader
+(
+	const char *shader_name, int varyings, const char *const *varying
+)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(varyings <= 0 || varying == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"feedback shader '%s' captures nothing", shader_name);
+		return 0;
+	}
+
+	return oglh_install_shader_with_varyings(shader_name, varyings, varying);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+	oglh_ transform feedback -- simulation state that stays on the GPU
+
+	A vertex shader moves the particles: it reads last frame's state as
+	vertex attributes and writes this frame's as outputs, which transform
+	feedback captures into a second buffer. The two buffers swap each
+	update, so the state is never read back or uploaded again.
+
+	const char *captured[] = { "out_position", "out_velocity" };
+	GLuint update = oglh_install_feedback_shader("particles_update",
+		2, captured);
+	GLuint render = oglh_install_shader("particles");
+
+	OGLH_FEEDBACK particles;
+	oglh_feedback_create(&particles, sizeof(PARTICLE), 100000,
+		initial_particles, 100000);
+	oglh_feedback_attribute(&particles, 0, 3, GL_FLOAT, 0);
+	oglh_feedback_attribute(&particles, 1, 3, GL_FLOAT, 12);
+	...
+	oglh_state_use_program(update);
+	oglh_set_uniform_value("dt", GL_FLOAT, dt);
+	oglh_feedback_update(&particles);		// rasterizer off, in to out
+	oglh_state_use_program(render);
+	oglh_feedback_draw(&particles, GL_POINTS);
+
+	A feedback shader is a vertex shader alone, shader_name.vert and the
+	optional shader_name.h. The varyings named are written interleaved, in
+	order, so they must add up to the vertex the attributes describe;
+	"gl_SkipComponents1" to "4" leave gaps.
+
+	Drawing uses glDrawTransformFeedback, which takes the vertex count from
+	the GPU. Without transform feedback objects (GL 4.0 or
+	ARB_transform_feedback2) it is glDrawArrays with the count kept here,
+	which a vertex shader can't change. Build with OGLH_FEEDBACK_DRAW_ARRAYS
+	to use that everywhere.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef struct oglh_feedback_statistics
+{
+	long updates;			// passes with the rasterizer discarded
+	long draws;
+	long writes;			// oglh_feedback_write calls
+}
+OGLH_FEEDBACK_STATISTICS;
+
+typedef struct oglh_feedback				// the fields are the module's
+{
+	GLuint buffer_id[2];
+	GLuint vertex_array_id[2];				// vertex_array_id[i] reads buffer i
+	GLuint feedback_id[2];					// captures into buffer i, or 0
+
+	GLsizei vertex_stride;
+	GLsizei max_vertices, vertex_count;
+	int current;							// the buffer with the latest state
+	bool captured;							// ... and transform feedback wrote it
+
+	OGLH_FEEDBACK_STATISTICS statistics;
+}
+OGLH_FEEDBACK;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_feedback_create
+(
+	OGLH_FEEDBACK *feedback, GLsizei vertex_stride, GLsizei max_vertices,
+	const void *vertices, GLsizei vertex_count
+);
+void oglh_feedback_attribute			// on both vertex arrays
+(
+	OGLH_FEEDBACK *feedback, GLuint location, GLint components, GLenum type,
+	GLsizei offset
+);
+bool oglh_feedback_write				// new particles, into the latest state
+(
+	OGLH_FEEDBACK *feedback, GLsizei first_vertex, GLsizei vertex_count,
+	const void *vertices
+);
+void oglh_feedback_update(OGLH_FEEDBACK *feedback);
+void oglh_feedback_draw(OGLH_FEEDBACK *feedback, GLenum mode);
+void oglh_feedback_delete(OGLH_FEEDBACK *feedback);
+void oglh_feedback_get_statistics
+(
+	const OGLH_FEEDBACK *feedback, OGLH_FEEDBACK_STATISTICS *statistics
+);
+
+GLuint oglh_install_feedback_shader
+(
+	const char *shader_name, int varyings, const char *const *varying
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
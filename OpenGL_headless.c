@@ -0,0 +1,213 @@
+/*------------------------------------------------------------------------------
+	oglh_ headless -- an OpenGL context with no window
+------------------------------------------------------------------------------*/
+#include "OpenGL_headless.h"
+#include <EGL/egl.h>		//	EGL
+#include <EGL/eglext.h>		//	EGL extensions
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static EGLDisplay headless_display = EGL_NO_DISPLAY;
+static EGLContext headless_context = EGL_NO_CONTEXT;
+static EGLSurface headless_surface = EGL_NO_SURFACE;
+static EGLint headless_major_version, headless_minor_version;
+static _Thread_local EGLContext shared_context = EGL_NO_CONTEXT;
+/*------------------------------------------------------------------------------
+	A compatibility profile so that the helpers' fixed pipeline calls
+	(glTexEnvf and friends) stay legal
+------------------------------------------------------------------------------*/
+bool oglh_create_headless_context(int major_version, int minor_version)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	EGLint major, minor;
+	EGLint context_attributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION,			major_version,
+		EGL_CONTEXT_MINOR_VERSION,			minor_version,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK,
+			EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if(get_platform_display != NULL)
+	{
+		headless_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+			EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if(headless_display == EGL_NO_DISPLAY)
+		headless_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	if(headless_display == EGL_NO_DISPLAY ||
+		!eglInitialize(headless_display, &major, &minor))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no EGL display for a headless context");
+		return false;
+	}
+
+	if(!eglBindAPI(EGL_OPENGL_API))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"EGL %d.%d has no desktop OpenGL", major, minor);
+		eglTerminate(headless_display);
+		return false;
+	}
+
+	headless_context = eglCreateContext(headless_display, EGL_NO_CONFIG_KHR,
+		EGL_NO_CONTEXT, context_attributes);
+	if(headless_context == EGL_NO_CONTEXT ||
+		!eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			headless_context))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't make a headless OpenGL %d.%d context (EGL error 0x%x)",
+			major_version, minor_version, eglGetError());
+		eglTerminate(headless_display);
+		return false;
+	}
+
+	headless_major_version = major_version;
+	headless_minor_version = minor_version;
+	printf("Headless context\t: %s, OpenGL %s\n",
+		glGetString(GL_RENDERER), glGetString(GL_VERSION));
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_destroy_headless_context(void)
+{
+	if(headless_display == EGL_NO_DISPLAY) return;
+
+	eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		EGL_NO_CONTEXT);
+	if(headless_surface != EGL_NO_SURFACE)
+		eglDestroySurface(headless_display, headless_surface);
+	if(headless_context != EGL_NO_CONTEXT)
+		eglDestroyContext(headless_display, headless_context);
+	eglTerminate(headless_display);
+
+	headless_surface = EGL_NO_SURFACE;
+	headless_context = EGL_NO_CONTEXT;
+	headless_display = EGL_NO_DISPLAY;
+}
+/*------------------------------------------------------------------------------
+	Called on another thread, makes a context current there that shares
+	the headless context's objects, or with make_current false releases
+	and destroys it
+------------------------------------------------------------------------------*/
+bool oglh_headless_shared_context(bool make_current, void *unused)
+{
+	EGLint context_attributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION,			headless_major_version,
+		EGL_CONTEXT_MINOR_VERSION,			headless_minor_version,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK,
+			EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	(void)unused;
+	if(!make_current)
+	{
+		eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			EGL_NO_CONTEXT);
+		if(shared_context != EGL_NO_CONTEXT)
+			eglDestroyContext(headless_display, shared_context);
+		eglReleaseThread();
+		shared_context = EGL_NO_CONTEXT;
+		return true;
+	}
+
+	if(headless_context == EGL_NO_CONTEXT || !eglBindAPI(EGL_OPENGL_API))
+		return false;
+
+	shared_context = eglCreateContext(headless_display, EGL_NO_CONFIG_KHR,
+		headless_context, context_attributes);
+	if(shared_context == EGL_NO_CONTEXT ||
+		!eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			shared_context))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't make a shared headless context (EGL error 0x%x)",
+			eglGetError());
+		if(shared_context != EGL_NO_CONTEXT)
+			eglDestroyContext(headless_display, shared_context);
+		shared_context = EGL_NO_CONTEXT;
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Gives the headless context a default framebuffer -- an RGBA8 pbuffer --
+	so that oglh_blit_fbo_to_front_buffer has somewhere to go. The context
+	was made without a config, which EGL_KHR_no_config_context lets us
+	pair with any surface.
+------------------------------------------------------------------------------*/
+bool oglh_create_headless_front_buffer(int width, int height)
+{
+	EGLConfig config;
+	EGLint number_of_configs;
+	EGLint config_attributes[] =
+	{
+		EGL_SURFACE_TYPE,		EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE,	EGL_OPENGL_BIT,
+		EGL_RED_SIZE,			8,
+		EGL_GREEN_SIZE,			8,
+		EGL_BLUE_SIZE,			8,
+		EGL_ALPHA_SIZE,			8,
+		EGL_NONE
+	};
+	EGLint surface_attributes[] =
+	{
+		EGL_WIDTH,				width,
+		EGL_HEIGHT,				height,
+		EGL_NONE
+	};
+
+	if(headless_context == EGL_NO_CONTEXT)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"make the headless context first");
+		return false;
+	}
+
+	if(!eglChooseConfig(headless_display, config_attributes, &config, 1,
+			&number_of_configs) || number_of_configs < 1)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no RGBA8 pbuffer config");
+		return false;
+	}
+
+	if(headless_surface != EGL_NO_SURFACE)
+	{
+		eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			headless_context);
+		eglDestroySurface(headless_display, headless_surface);
+	}
+
+	headless_surface = eglCreatePbufferSurface(headless_display, config,
+		surface_attributes);
+	if(headless_surface == EGL_NO_SURFACE ||
+		!eglMakeCurrent(headless_display, headless_surface, headless_surface,
+			headless_context))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't make a %d x %d pbuffer current (EGL error 0x%x)",
+			width, height, eglGetError());
+		if(headless_surface != EGL_NO_SURFACE)
+			eglDestroySurface(headless_display, headless_surface);
+		headless_surface = EGL_NO_SURFACE;
+		eglMakeCurrent(headless_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+			headless_context);
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
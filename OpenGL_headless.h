@@ -0,0 +1,25 @@
+/*------------------------------------------------------------------------------
+	oglh_ headless -- an OpenGL context with no window, for tools, replays
+	and benchmarks
+
+	Uses EGL on Mesa's surfaceless platform (llvmpipe when there is no GPU)
+	or, failing that, the default EGL display with EGL_KHR_surfaceless_context.
+	Nothing is drawn to a window so render into an FBO, for example with
+	oglh_set_rendering_to_fbo. oglh_create_headless_front_buffer adds a
+	pbuffer as the default framebuffer for code that blits to the front
+	buffer. Link with -lEGL.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_create_headless_context(int major_version, int minor_version);
+bool oglh_create_headless_front_buffer(int width, int height);
+void oglh_destroy_headless_context(void);
+
+// an OGLH_RESOURCE_CONTEXT, see OpenGL_resources.h
+bool oglh_headless_shared_context(bool make_current, void *unused);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -23,10 +23,137 @@ or something like them, were part of the standard API.
 
 ------------------------------------------------------------------------------*/
 #include "OpenGL_helpers.h"
+#include "OpenGL_timers.h"
+#include "OpenGL_trace.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_state.h"
+#include "OpenGL_instancing.h"
+#include "OpenGL_indirect.h"
+#include "OpenGL_shader_pack.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+	error check level, error handler and the most recent helper call site;
+	the site and the sampling count are each thread's own, like its GL
+	context
+------------------------------------------------------------------------------*/
+int oglh_error_check_level = OGLH_ERROR_CHECK_LEVEL;
+_Thread_local unsigned int oglh_error_check_count = 0;
+_Thread_local const OGLH_CALL_SITE *oglh_current_call_site = NULL;
+
+static void oglh_default_error_handler
+(
+	int severity, int code,
+	const char *path_file, int line, const char *func, const char *message
+);
+static OGLH_ERROR_HANDLER error_handler = oglh_default_error_handler;
+/*------------------------------------------------------------------------------
+	The helpers' part of an oglh context (OpenGL_context.h): the rendering
+	FBO and the uniform locations already asked for, direct mapped on the
+	program and name
+------------------------------------------------------------------------------*/
+#define LOCATION_CACHE_SIZE		256		// a power of two
+#define LOCATION_NAME_SIZE		48		// longer names are looked up each time
+
+typedef struct cached_location
+{
+	GLuint program_id;					// 0 when the entry is free
+	GLint location;						// -1 is remembered too
+	char name[LOCATION_NAME_SIZE];
+}
+CACHED_LOCATION;
+
+typedef struct helper_context
+{
+	GLuint fbo_frame_buffer_id;			// the FBO most recently set up
+	GLuint fbo_render_buffer_id;
+	int fbo_width, fbo_height;
+	CACHED_LOCATION location[LOCATION_CACHE_SIZE];
+}
+HELPER_CONTEXT;
+
+static HELPER_CONTEXT default_helpers;
+static _Thread_local HELPER_CONTEXT *helpers = &default_helpers;
+/*------------------------------------------------------------------------------
+	The runtime level can't exceed what was compiled in
+------------------------------------------------------------------------------*/
+void oglh_set_error_check_level(int level)
+{
+	if(level > OGLH_ERROR_CHECK_LEVEL) level = OGLH_ERROR_CHECK_LEVEL;
+	if(level < OGLH_CHECK_OFF) level = OGLH_CHECK_OFF;
+	oglh_error_check_level = level;
+}
+/*------------------------------------------------------------------------------
+	NULL restores the default handler
+------------------------------------------------------------------------------*/
+void oglh_set_error_handler(OGLH_ERROR_HANDLER handler)
+{
+	error_handler = handler != NULL ? handler : oglh_default_error_handler;
+}
+/*------------------------------------------------------------------------------
+	The original behaviour: report in colour, wait for a key and exit
+------------------------------------------------------------------------------*/
+static void oglh_default_error_handler
+(
+	int severity, int code,
+	const char *path_file, int line, const char *func, const char *message
+)
+{
+	switch(severity)
+	{
+		case OGLH_SEVERITY_WARNING:
+			printf(ANSI_COLOR_YELLOW);
+			printf("\n** warning ** %s\n", message);
+			printf("(in file: %s at line: %d in function: %s)\n",
+				path_file, line, func);
+			printf(ANSI_COLOR_RESET);
+		return;
+
+		case OGLH_SEVERITY_GL_ERROR:
+			printf(ANSI_CLEAR_LINE ANSI_COLOR_RED);
+			printf("** OpenGL error ** %s\n", message);
+			printf
+			(
+				"(in file: %s at line: %d in function: %s)\n", 
+				path_file, line, func
+			);
+			printf(ANSI_CLEAR_LINE ANSI_COLOR_RESET);
+		break;
+
+		case OGLH_SEVERITY_ERROR:
+		default:
+			printf
+			(
+				ANSI_COLOR_LIGHT_RED
+				"\n*** error ***\n"
+				ANSI_COLOR_RESET
+			);
+
+			printf
+			(
+				COLOR_ORANGE
+				"\t%s\n"
+				ANSI_COLOR_RESET,
+				message
+			);
+
+			printf
+			(
+				ANSI_COLOR_LIGHT_RED
+				"(in file: %s at line: %d in function: %s)\n"
+				ANSI_COLOR_RESET,
+				path_file, line, func
+			);
+		break;
+	}
+
+	getchar();
+	exit(code != 0 ? code : EXIT_FAILURE);
+}
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
-static void oglh_program_error
+void oglh_program_error
 (
 	const char *path_file, int line, const char *func,
 	const char *control, ...
@@ -36,39 +163,15 @@ static void oglh_program_error
 	char text[256]; // text expansion buffer
 
 	va_start(parms, control);
-	vsprintf(text, control, parms);
+	vsnprintf(text, sizeof(text), control, parms);
 	va_end(parms);
 
-	printf
-	(
-		ANSI_COLOR_LIGHT_RED
-		"\n*** error ***\n"
-		ANSI_COLOR_RESET
-	);
-
-	printf
-	(
-		COLOR_ORANGE
-		"\t%s\n"
-		ANSI_COLOR_RESET,
-		text
-	);
-
-	printf
-	(
-		ANSI_COLOR_LIGHT_RED
-		"(in file: %s at line: %d in function: %s)\n"
-		ANSI_COLOR_RESET,
-		path_file, line, func
-	);
-
-	getchar();
-	exit(EXIT_FAILURE);
+	error_handler(OGLH_SEVERITY_ERROR, EXIT_FAILURE, path_file, line, func, text);
 }
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
-static void oglh_program_warning
+void oglh_program_warning
 (
 	const char *path_file, int line, const char *func, const char *control, ...
 )
@@ -77,107 +180,190 @@ static void oglh_program_warning
 	char text[256]; // text expansion buffer
 
 	va_start(parms, control);
-	vsprintf(text, control, parms);
+	vsnprintf(text, sizeof(text), control, parms);
 	va_end(parms);
-	
-	printf(ANSI_COLOR_YELLOW);
-	printf("\n** warning ** %s\n", text);
-	printf("(in file: %s at line: %d in function: %s)\n",
-		path_file, line, func);
-	printf(ANSI_COLOR_RESET);
+
+	error_handler(OGLH_SEVERITY_WARNING, 0, path_file, line, func, text);
 }
 /*------------------------------------------------------------------------------
 	OpenGL error detailed reporting
 ------------------------------------------------------------------------------*/
-static void oglh_error
+void oglh_error
 (
 	const char *path_file, int line, const char *func, GLenum error_code
 )
 {
-	printf(ANSI_CLEAR_LINE ANSI_COLOR_RED);
-	printf("** OpenGL error ** ");
+	char text[64];
 
 	switch(error_code)
 	{
 	case GL_NO_ERROR:
-		printf("GL_NO_ERROR\n");
+		sprintf(text, "GL_NO_ERROR");
 		break;
 
 	case GL_INVALID_OPERATION:
-		printf("GL_INVALID_OPERATION\n");
+		sprintf(text, "GL_INVALID_OPERATION");
 		break;
 
 	case GL_INVALID_ENUM:
-		printf("GL_INVALID_ENUM\n");
+		sprintf(text, "GL_INVALID_ENUM");
 		break;
 
 	case GL_INVALID_VALUE:
-		printf("GL_INVALID_VALUE\n");
+		sprintf(text, "GL_INVALID_VALUE");
 		break;
 
 	case GL_STACK_OVERFLOW:
 	case GL_STACK_UNDERFLOW:
-		printf("GL_STACK_OVERFLOW/GL_STACK_UNDERFLOW\n");
+		sprintf(text, "GL_STACK_OVERFLOW/GL_STACK_UNDERFLOW");
 		break;
 
 	case GL_OUT_OF_MEMORY:
-		printf("GL_OUT_OF_MEMORY\n");
+		sprintf(text, "GL_OUT_OF_MEMORY");
 		break;
 
 	case GL_INVALID_FRAMEBUFFER_OPERATION:
-		printf("GL_INVALID_FRAMEBUFFER_OPERATION\n");
+		sprintf(text, "GL_INVALID_FRAMEBUFFER_OPERATION");
 		break;
 
 	default:
-		printf("undefined! = %d\n", error_code);
+		sprintf(text, "undefined! = %d", error_code);
 		break;
 	}
 
-	printf
-	(
-		"(in file: %s at line: %d in function: %s)\n", 
-		path_file, line, func
-	);
-	printf(ANSI_CLEAR_LINE ANSI_COLOR_RESET);
-	getchar();
-	exit(error_code);
+	error_handler(OGLH_SEVERITY_GL_ERROR, error_code, path_file, line, func, text);
 }
 /*------------------------------------------------------------------------------
-	OpenGL error checking -- can be sprinkled in code liberally
+	is the named extension in the current context's extension list
 ------------------------------------------------------------------------------*/
-static inline void oglh_error_check
+bool oglh_has_extension(const char *extension_name)
+{
+	GLint index, number = 0;
+
+	glGetIntegerv(GL_NUM_EXTENSIONS, &number);
+	for(index = 0; index < number; index++)
+	{
+		if(!strcmp((const char *)glGetStringi(GL_EXTENSIONS, index),
+			extension_name))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+/*------------------------------------------------------------------------------
+	is the current context at least GL version -- major * 10 + minor, 43 for
+	4.3 -- or does it list the extension that brings the same feature; a
+	NULL extension_name asks for the version alone
+------------------------------------------------------------------------------*/
+bool oglh_gl_version_or_extension(int version, const char *extension_name)
+{
+	GLint major = 0, minor = 0;
+
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	return major * 10 + minor >= version ||
+		(extension_name != NULL && oglh_has_extension(extension_name));
+}
+/*------------------------------------------------------------------------------
+	KHR_debug messages arrive here, possibly on a driver thread and possibly
+	some time after the call that caused them. The site reported is the
+	oglh_ helper that was most recently entered.
+------------------------------------------------------------------------------*/
+static const char debug_output_asynchronous;	// its address marks the mode
+
+static void GLAPIENTRY oglh_debug_message_callback
 (
-	const char *path_file, int line, const char *func
+	GLenum source, GLenum type, GLuint id, GLenum severity,
+	GLsizei length, const GLchar *message, const void *user_parameter
 )
 {
-	GLenum error_code;
+	const OGLH_CALL_SITE *site;
+	const char *path_file = "(not in a helper)", *func = "?";
+	int line = 0;
+
+	(void)source; (void)length;
 
-	if((error_code = glGetError()) == GL_NO_ERROR)
+	if(type != GL_DEBUG_TYPE_ERROR && severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+		return;	// chatter
+
+	site = oglh_current_call_site;
+	if(site != NULL)
 	{
-		return;	// quickly -- no need to report anything
+		path_file = site->path_file;
+		line = site->line;
+		func = site->func;
 	}
+
+	// asynchronous: this may be the driver's thread, where a handler that
+	// waits on the console or exits has no business running -- only log
+	if(user_parameter == &debug_output_asynchronous)
+	{
+		fprintf(stderr, "** OpenGL %s ** %s\n"
+			"(near file: %s at line: %d in function: %s)\n",
+			type == GL_DEBUG_TYPE_ERROR ? "error" : "warning", message,
+			path_file, line, func);
+		return;
+	}
+
+	if(type == GL_DEBUG_TYPE_ERROR)
+		error_handler(OGLH_SEVERITY_GL_ERROR, id, path_file, line, func, message);
 	else
+		error_handler(OGLH_SEVERITY_WARNING, 0, path_file, line, func, message);
+}
+/*------------------------------------------------------------------------------
+	Report errors through GL_KHR_debug rather than polling glGetError.
+	Asynchronous output is the fast one; synchronous output reports from
+	inside the offending GL call which is easier to debug.
+------------------------------------------------------------------------------*/
+bool oglh_enable_debug_output(bool synchronous)
+{
+	GLint context_flags = 0;
+
+	if(!oglh_has_extension("GL_KHR_debug"))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"GL_KHR_debug is not available");
+		return false;
+	}
+
+	glGetIntegerv(GL_CONTEXT_FLAGS, &context_flags);
+	if(!(context_flags & GL_CONTEXT_FLAG_DEBUG_BIT))
 	{
-		oglh_error(path_file, line, func, error_code);
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"not a debug context -- some drivers will send no messages");
 	}
+
+	glDebugMessageCallback(oglh_debug_message_callback,
+		synchronous ? NULL : &debug_output_asynchronous);
+	glEnable(GL_DEBUG_OUTPUT);
+	if(synchronous)
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	else
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
 }
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
 void oglh_activate_and_bind_opengl_object(GLint type, GLuint *object_id)
 {
+	OGLH_NOTE_CALL_SITE();
+
 	*object_id = 0;
 
 	switch(type)
 	{
 		case GL_TEXTURE_2D:
-			glActiveTexture(IMAGE_SAMPLER2D + GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, *object_id);
+			oglh_activate_and_bind_opengl_texture(
+				IMAGE_SAMPLER2D + GL_TEXTURE0, *object_id);
 		break;
 
 		case GL_VERTEX_ARRAY:
-			glGenVertexArrays(1, object_id);
-			glBindVertexArray(*object_id);	// note the different parameters
+			*object_id = oglh_registry_generate(OGLH_OBJECT_VERTEX_ARRAY);
+			oglh_state_bind_vertex_array(*object_id);
 		break;
 		
 		default:
@@ -197,9 +383,23 @@ void oglh_activate_and_bind_opengl_object(GLint type, GLuint *object_id)
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
-void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id)
+void oglh_generate_and_bind_opengl_object_at
+(
+	GLint type, GLuint *object_id,
+	const char *path_file, int line, const char *func
+)
 {
+	int object_type;
+
+	OGLH_NOTE_CALL_SITE();
+
 	*object_id = 0;
+	if((object_type = oglh_registry_object_type(type)) >= 0 &&
+		object_type <= OGLH_OBJECT_VERTEX_ARRAY)
+	{
+		*object_id = oglh_registry_generate_at(object_type,
+			path_file, line, func);
+	}
 
 	switch(type)
 	{
@@ -208,18 +408,18 @@ void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id)
 		case GL_PIXEL_PACK_BUFFER:
 		case GL_PIXEL_UNPACK_BUFFER:
 		case GL_TRANSFORM_FEEDBACK_BUFFER:
-			glGenBuffers(1, object_id);
-			glBindBuffer(type, *object_id);
+		case GL_UNIFORM_BUFFER:
+		case GL_SHADER_STORAGE_BUFFER:
+		case GL_DRAW_INDIRECT_BUFFER:
+			oglh_state_bind_buffer(type, *object_id);
 		break;
 
 		case GL_FRAMEBUFFER:
-			glGenFramebuffers(1, object_id);
-			glBindFramebuffer(type, *object_id);
+			oglh_state_bind_framebuffer(type, *object_id);
 		break;
 
 		case GL_RENDERBUFFER:
-			glGenRenderbuffers(1, object_id);
-			glBindRenderbuffer(type, *object_id);
+			oglh_state_bind_renderbuffer(*object_id);
 		break;
 
 		case GL_TEXTURE_1D:
@@ -228,26 +428,22 @@ void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id)
 		case GL_TEXTURE_1D_ARRAY:
 		case GL_TEXTURE_2D_ARRAY:
 		case GL_TEXTURE_CUBE_MAP:
-			glGenTextures(1, object_id);
-			glBindTexture(type, *object_id);
-			//glActiveTexture(object_id);
-			oglh_error_check(__FILE__, __LINE__, __FUNC__);
+			oglh_texture_units_bind_active(type, *object_id);
 		break;
 
 		case GL_VERTEX_ARRAY:
-			glGenVertexArrays(1, object_id);
-			glBindVertexArray(*object_id);	// note the different parameters
+			oglh_state_bind_vertex_array(*object_id);
 		break;
 
 		default:
-			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			oglh_program_error(path_file, line, func,
 				"unrecognized object type: %d", type);
 		break;
 	}
 
 	if(*object_id == 0)
 	{
-		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+		oglh_program_error(path_file, line, func,
 			"generating and binding opengl object failed type: %d", type);
 	}
 
@@ -258,28 +454,48 @@ void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id)
 ------------------------------------------------------------------------------*/
 void oglh_activate_and_bind_opengl_texture(int texture_map_unit, int texture_id)
 {
+	OGLH_NOTE_CALL_SITE();
+
 	if(texture_map_unit == GL_TEXTURE0)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"can't use TEXTURE_MAP_UNIT_0 "
 			"which is reserved for the fixed pipeline");
 	}
-	glActiveTexture(texture_map_unit);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
+	oglh_texture_units_activate(texture_map_unit - GL_TEXTURE0);
+	oglh_texture_units_bind(texture_map_unit - GL_TEXTURE0, GL_TEXTURE_2D,
+		texture_id);
  	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 }
+/*------------------------------------------------------------------------------
+	FNV-1a over the name, the program mixed in
+------------------------------------------------------------------------------*/
+static CACHED_LOCATION *location_entry(GLuint program_id, const char *name)
+{
+	unsigned int hash = 2166136261u ^ program_id;
+
+	while(*name != '\0') hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	return &helpers->location[hash & (LOCATION_CACHE_SIZE - 1)];
+}
 /*------------------------------------------------------------------------------
 
 	get the GLSL program location for a variable within the current program
 ------------------------------------------------------------------------------*/
 static GLint get_uniform_location(const char *variable_name)
 {
+	CACHED_LOCATION *cached;
 	GLint location, program_id;
 	// whine: why does a user care about the uniform's location
 	// an interior detail -- that is the compiler's job
 	// this is much to close to assembly language
 
-	glGetIntegerv(GL_CURRENT_PROGRAM, &program_id);
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
+	cached = location_entry(program_id, variable_name);
+	if(program_id != 0 && cached->program_id == (GLuint)program_id &&
+		strcmp(cached->name, variable_name) == 0)
+	{
+		return cached->location;
+	}
 	location = glGetUniformLocation(program_id, variable_name);
 
 	if(location == -1)
@@ -293,10 +509,32 @@ static GLint get_uniform_location(const char *variable_name)
 			"failed to locate uniform variable: '%s'\n\tin program %d",
 			variable_name, program_id);
 	}
+
+	if(program_id != 0 && strlen(variable_name) < LOCATION_NAME_SIZE)
+	{
+		cached->program_id = program_id;
+		cached->location = location;
+		strcpy(cached->name, variable_name);
+	}
 	
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 	return location;
 }
+/*------------------------------------------------------------------------------
+	The registry calls this as a program is deleted, its name may come back
+	as another program. A program relinked with glLinkProgram behind the
+	helpers' back needs it too. 0 forgets every program's.
+------------------------------------------------------------------------------*/
+void oglh_forget_uniform_locations(GLuint program_id)
+{
+	int index;
+
+	for(index = 0; index < LOCATION_CACHE_SIZE; index++)
+	{
+		if(program_id == 0 || helpers->location[index].program_id == program_id)
+			helpers->location[index].program_id = 0;
+	}
+}
 /*------------------------------------------------------------------------------
 	 The standard definitions for GLSL UNIFORM types are used
 	 The value is passed via void pointer to the variable to be set
@@ -316,6 +554,7 @@ void oglh_set_uniform_variable(const char *variable_name, int type, void *data)
 	vec4 *vec4_value;
 	mat4 mat4_value;
 
+	OGLH_NOTE_CALL_SITE();
 	location = get_uniform_location(variable_name);
 
 	switch(type) // switch on GLSL data type
@@ -325,6 +564,8 @@ void oglh_set_uniform_variable(const char *variable_name, int type, void *data)
 		case GL_SAMPLER_2D:
 			value = data;
 			glUniform1i(location, *value);
+			if(type == GL_SAMPLER_2D)
+				oglh_texture_units_note_sampler(variable_name, *value);
 		break;
 
 		case GL_FLOAT:
@@ -366,6 +607,7 @@ void oglh_set_uniform_variable(const char *variable_name, int type, void *data)
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"GLSL bad uniform data type %d\n", type);
 	}	
+	OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, data));
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 }
 /*------------------------------------------------------------------------------
@@ -379,7 +621,8 @@ void oglh_get_uniform_variable(const char *variable_name, int type, void *data)
 {
 	GLint location, program_id;
 
-	glGetIntegerv(GL_CURRENT_PROGRAM, &program_id);
+	OGLH_NOTE_CALL_SITE();
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
 	location = get_uniform_location(variable_name);
 
 	switch(type) // switch on GLSL data type
@@ -418,6 +661,7 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 	float float_value;
 	float vec_value[4];
 
+	OGLH_NOTE_CALL_SITE();
 	va_start(arg_list, type); // start at the last fixed parameter
 	location = get_uniform_location(variable_name);
 
@@ -429,6 +673,9 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 			// the same code for bool, int, & sampler2D
 			value = va_arg(arg_list, int);
 			glUniform1i(location, value);
+			if(type == GL_SAMPLER_2D)
+				oglh_texture_units_note_sampler(variable_name, value);
+			OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, &value));
 		break;
 
 		case GL_FLOAT:
@@ -436,12 +683,14 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 			// arglist always uses doubles -- floats are not allowed
 			float_value = va_arg(arg_list, double);
 			glUniform1f(location, (float)float_value);
+			OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, &float_value));
 		break;
 
 		case GL_FLOAT_VEC2:
 			vec_value[0] = va_arg(arg_list, double);
 			vec_value[1] = va_arg(arg_list, double);
 			glUniform2f(location, (vec_value)[0], (vec_value)[1]);
+			OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, vec_value));
 		break;
 
 		case GL_FLOAT_VEC3:
@@ -449,6 +698,7 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 			vec_value[1] = va_arg(arg_list, double);
 			vec_value[2] = va_arg(arg_list, double);
 			glUniform3f(location, (vec_value)[0], (vec_value)[1], (vec_value)[2]);
+			OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, vec_value));
 		break;
 
 		case GL_FLOAT_VEC4:
@@ -457,6 +707,7 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 			vec_value[2] = va_arg(arg_list, double);
 			vec_value[3] = va_arg(arg_list, double);
 			glUniform4f(location, (vec_value)[0], (vec_value)[1], (vec_value)[2], (vec_value)[3]);
+			OGLH_TRACE_HOOK(oglh_trace_uniform(variable_name, type, vec_value));
 		break;
 
 		case GL_FLOAT_MAT4:
@@ -471,6 +722,33 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...)
 	va_end(arg_list);
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 }
+/*------------------------------------------------------------------------------
+	Appends the file to the buffer, from the shader pack if it has it;
+	false if it is in neither
+------------------------------------------------------------------------------*/
+static bool read_glsl_text(const char *file_name, char *buffer, size_t size)
+{
+	size_t used = strlen(buffer), bytes;
+	const char *packed;
+	FILE *glsl_fptr;
+
+	if((packed = oglh_shader_pack_find(file_name, &bytes)) != NULL)
+	{
+		if(bytes > size - used - 1) bytes = size - used - 1;
+		memcpy(buffer + used, packed, bytes);
+		buffer[used + bytes] = '\0';
+		return true;
+	}
+
+	if(!oglh_shader_pack_loose_files() ||
+		(glsl_fptr = fopen(file_name, "rt")) == NULL)
+	{
+		return false;
+	}
+	fread(buffer + used, size - used - 1, 1, glsl_fptr);
+	fclose(glsl_fptr);
+	return true;
+}
 /*------------------------------------------------------------------------------
 	Note: if a common header is used then the GLSL version
 	needs to be specified on the _first_ line of the header and not in the GLSL
@@ -491,10 +769,7 @@ static char *load_glsl_file(const char *shader_name, GLenum shader_type)
 {
 	char *shader_code_buffer = NULL;
 	char shader_file[FILENAME_MAX];
-	FILE *shader_code_fptr;
-	char *code_buffer = NULL;
 	char header_file[FILENAME_MAX];
-	FILE *header_fptr;
 
 	switch(shader_type)
 	{
@@ -509,6 +784,7 @@ static char *load_glsl_file(const char *shader_name, GLenum shader_type)
 		default:
 			oglh_program_error(__FILE__, __LINE__, __FUNC__,
 				"GLSL shader is neither vertex nor fragment %d", shader_type);
+		return NULL;
 	}
 
 	printf("Compiling shader file\t: %s\n", shader_file);
@@ -517,9 +793,20 @@ static char *load_glsl_file(const char *shader_name, GLenum shader_type)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"GLSL out of memory opening buffer");
+		return NULL;
 	}
 
-	if((shader_code_fptr = fopen(shader_file, "rt")) == NULL)
+	// the optional common header goes first
+	sprintf(header_file, "%s.h", shader_name);
+	if(read_glsl_text(header_file, shader_code_buffer, SOURCE_CODE_BUFFER_SIZE))
+	{
+		printf("Using header file\t: %s\n", header_file);
+		// reset the line numbering
+		strcat(shader_code_buffer, "#line 0\n");
+		printf("Shader\t\t\t: %s\n", shader_file);
+	}
+
+	if(!read_glsl_text(shader_file, shader_code_buffer, SOURCE_CODE_BUFFER_SIZE))
 	{
 		oglh_program_error
 		(
@@ -527,39 +814,53 @@ static char *load_glsl_file(const char *shader_name, GLenum shader_type)
 			"GLSL opening shader file: %12s",
 			shader_file
 		);
+		free(shader_code_buffer);
+		return NULL;
 	}
-	
-	sprintf(header_file, "%s.h", shader_name);
 
-	if((header_fptr = fopen(header_file, "rt")) == NULL)
-	{
-		// no common header file -- so don't use one
-		fread(shader_code_buffer, SOURCE_CODE_BUFFER_SIZE, 1, shader_code_fptr);
-	}
-	else
+	if(!oglh_instancing_rewrite_source(shader_name, shader_type,
+		shader_code_buffer, SOURCE_CODE_BUFFER_SIZE) ||
+		!oglh_indirect_rewrite_source(shader_name, shader_type,
+		shader_code_buffer, SOURCE_CODE_BUFFER_SIZE))
 	{
-		if((code_buffer = (char *)calloc(1, SOURCE_CODE_BUFFER_SIZE)) == NULL)
-		{
-			oglh_program_error(__FILE__, __LINE__, __FUNC__,
-				"GLSL out of memory opening buffer");
-		}
-		
-		printf("Using header file\t: %s\n", header_file);
-		// read the optional header into the buffer
-		fread(shader_code_buffer, SOURCE_CODE_BUFFER_SIZE, 1, header_fptr);
-		// reset the line numbering
-		strcat(shader_code_buffer, "#line 0\n");
-		fread(code_buffer, SOURCE_CODE_BUFFER_SIZE, 1, shader_code_fptr);
-		strcat(shader_code_buffer, code_buffer);
-		
-		printf("Shader\t\t\t: %s\n", shader_file);
-		//puts(shader_code_buffer);
-		free(code_buffer);
+		free(shader_code_buffer);
+		return NULL;
 	}
 
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 	return shader_code_buffer;
 }
+
+char *oglh_load_shader_source(const char *shader_name, GLenum shader_type)
+{
+	return load_glsl_file(shader_name, shader_type);
+}
+/*------------------------------------------------------------------------------
+	The files alone, header first, for threads other than the rendering
+	one: no messages, no error handler and no rewriting
+------------------------------------------------------------------------------*/
+char *oglh_read_shader_source(const char *shader_name, GLenum shader_type)
+{
+	char file_name[FILENAME_MAX];
+	char *buffer;
+
+	if(shader_type != GL_VERTEX_SHADER && shader_type != GL_FRAGMENT_SHADER)
+		return NULL;
+	if((buffer = calloc(1, SOURCE_CODE_BUFFER_SIZE)) == NULL) return NULL;
+
+	snprintf(file_name, sizeof(file_name), "%s.h", shader_name);
+	if(read_glsl_text(file_name, buffer, SOURCE_CODE_BUFFER_SIZE))
+		strcat(buffer, "#line 0\n");
+
+	snprintf(file_name, sizeof(file_name), "%s.%s", shader_name,
+		shader_type == GL_VERTEX_SHADER ? "vert" : "frag");
+	if(!read_glsl_text(file_name, buffer, SOURCE_CODE_BUFFER_SIZE))
+	{
+		free(buffer);
+		return NULL;
+	}
+	return buffer;
+}
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
@@ -575,9 +876,13 @@ static GLuint compile_shader(const char *shader_name, GLenum shader_type)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"GLSL shader\t%s is absent\n", shader_name);
+		return 0;
 	}
 
+	OGLH_TRACE_HOOK(oglh_trace_shader_source(shader_type, shader_source_code));
+
 	shader_id = glCreateShader(shader_type);
+	oglh_registry_add(OGLH_OBJECT_SHADER, shader_id, shader_name);
 	glShaderSource(shader_id, 1, &shader_source_code, NULL);
 	glCompileShader(shader_id);
 	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
@@ -590,58 +895,128 @@ static GLuint compile_shader(const char *shader_name, GLenum shader_type)
 				"GLSL out of memory opening log buffer");
 			// we really are in trouble if this happens
 		}
-		
-		glGetShaderInfoLog(shader_id, SOURCE_CODE_BUFFER_SIZE, NULL, log_buffer);
-		printf("compilation log\t:\n%s\n", log_buffer);
+		else
+		{
+			glGetShaderInfoLog(shader_id, SOURCE_CODE_BUFFER_SIZE, NULL, log_buffer);
+			printf("compilation log\t:\n%s\n", log_buffer);
+			free(log_buffer);
+		}
 		
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"GLSL compiling shader '%s' failed",
 			shader_name);
+		oglh_registry_delete(OGLH_OBJECT_SHADER, shader_id);
+		return 0;
 	}
 
  	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 	return shader_id;
 }
 /*------------------------------------------------------------------------------
-	This code compiles both frag and vert shaders then links a shader and 
-	activates it.
-	
-	File extensions for shaders: 
-	shader_name.frag, shader_name.vert and shader_name.h 
-	
-	An optional common header file shader_name.h is "included" in both shader 
-	files and can be used elsewhere
-
+	The shaders compiled, attached and linked into program_id; false if
+	that failed, which has been reported. With varyings to capture it is a
+	transform feedback program, which stops at the vertex shader.
 ------------------------------------------------------------------------------*/
-GLuint oglh_install_shader(const char *shader_name)
+static bool compile_and_link
+(
+	const char *shader_name, GLuint program_id,
+	int varyings, const char *const *varying
+)
 {
-	GLuint vertex_shader_id, fragment_shader_id, program_id;
+	GLuint vertex_shader_id, fragment_shader_id;
 	GLint success;
-	
-	printf("Compiling shader\t: %s\n", shader_name);
-
-	program_id = glCreateProgram();
+	bool vertex_only = varyings > 0;
 
 	vertex_shader_id	= compile_shader(shader_name, GL_VERTEX_SHADER);
 	if(vertex_shader_id != 0) 
 		glAttachShader(program_id, vertex_shader_id);
 	
-	fragment_shader_id	= compile_shader(shader_name, GL_FRAGMENT_SHADER);
+	// the trace mustn't keep the previous program's fragment hash
+	if(vertex_only)
+		OGLH_TRACE_HOOK(oglh_trace_shader_source(GL_FRAGMENT_SHADER, ""));
+	fragment_shader_id	= vertex_only ? 0 :
+		compile_shader(shader_name, GL_FRAGMENT_SHADER);
 	if(fragment_shader_id != 0) 
 		glAttachShader(program_id, fragment_shader_id);
 
+	if(vertex_shader_id == 0 || (fragment_shader_id == 0 && !vertex_only))
+	{
+		oglh_registry_delete(OGLH_OBJECT_SHADER, vertex_shader_id);
+		oglh_registry_delete(OGLH_OBJECT_SHADER, fragment_shader_id);
+		return false;
+	}
+
+	if(vertex_only)
+	{
+		glTransformFeedbackVaryings(program_id, varyings,
+			(const GLchar *const *)varying, GL_INTERLEAVED_ATTRIBS);
+	}
+
 	printf("GLSL linking\t\t: %s\n", shader_name);
 	glLinkProgram(program_id);
 
+	// the program keeps the linked code, the shader objects aren't needed
+	glDetachShader(program_id, vertex_shader_id);
+	if(fragment_shader_id != 0)
+		glDetachShader(program_id, fragment_shader_id);
+	oglh_registry_delete(OGLH_OBJECT_SHADER, vertex_shader_id);
+	oglh_registry_delete(OGLH_OBJECT_SHADER, fragment_shader_id);
+
 	glGetProgramiv(program_id, GL_LINK_STATUS, &success);
 	if(!success)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"GLSL linking\tfile %s failed", shader_name);
+		return false;
 	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	This code compiles both frag and vert shaders then links a shader and 
+	activates it.
+	
+	File extensions for shaders: 
+	shader_name.frag, shader_name.vert and shader_name.h 
+	
+	An optional common header file shader_name.h is "included" in both shader 
+	files and can be used elsewhere
 
-	glUseProgram(program_id);
+------------------------------------------------------------------------------*/
+GLuint oglh_install_shader(const char *shader_name)
+{
+	OGLH_NOTE_CALL_SITE();
+	return oglh_install_shader_with_varyings(shader_name, 0, NULL);
+}
+
+GLuint oglh_install_shader_with_varyings
+(
+	const char *shader_name, int varyings, const char *const *varying
+)
+{
+	GLuint program_id;
+
+	OGLH_NOTE_CALL_SITE();
+	OGLH_TIMER_BEGIN("oglh_install_shader");
+	printf("Compiling shader\t: %s\n", shader_name);
+
+	program_id = glCreateProgram();
+	oglh_registry_add(OGLH_OBJECT_PROGRAM, program_id, shader_name);
+
+	// a binary from the shader pack saves compiling, but has no varyings
+	if((varyings > 0 || !oglh_shader_pack_load_binary(shader_name, program_id)) &&
+		!compile_and_link(shader_name, program_id, varyings, varying))
+	{
+		// the error has been reported and the handler chose to carry on
+		oglh_registry_delete(OGLH_OBJECT_PROGRAM, program_id);
+		OGLH_TIMER_END();
+		return 0;
+	}
+
+	oglh_state_use_program(program_id);
+	oglh_texture_units_assign_samplers(program_id);
  	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	OGLH_TIMER_END();
+	OGLH_TRACE_HOOK(oglh_trace_install_shader(shader_name));
 	printf("Compilation done\t: %s\n", shader_name);
 	return program_id;
 }
@@ -726,11 +1101,13 @@ void oglh_blit_fbo_to_front_buffer(void)
 	GLint frame_buffer_name;
 	GLint viewport[4];
 
-	glGetIntegerv(GL_VIEWPORT, viewport);
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &frame_buffer_name);
+	OGLH_NOTE_CALL_SITE();
+	OGLH_TIMER_BEGIN("oglh_blit_fbo_to_front_buffer");
+	oglh_state_get_integerv(GL_VIEWPORT, viewport);
+	oglh_state_get_integerv(GL_FRAMEBUFFER_BINDING, &frame_buffer_name);
 	// change draw framebuffer to be the front buffer
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-	glDrawBuffer(GL_FRONT);
+	oglh_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	oglh_state_draw_buffer(GL_FRONT);
 
 	glBlitFramebuffer		// copy FBO data to the front buffer
 	(
@@ -745,8 +1122,10 @@ void oglh_blit_fbo_to_front_buffer(void)
 	);
 
 	// restore draw framebuffer to be the FBO
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_name);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	oglh_state_bind_framebuffer(GL_FRAMEBUFFER, frame_buffer_name);
+	oglh_state_draw_buffer(GL_COLOR_ATTACHMENT0);
+	OGLH_TIMER_END();
+	OGLH_TRACE_HOOK(oglh_trace_blit());
 }
 /*------------------------------------------------------------------------------
 	http://www.songho.ca/opengl/gl_fbo.html -- this helped me a lot
@@ -765,6 +1144,8 @@ void oglh_set_rendering_to_fbo(int width, int height)
 	// id's they are just interior details -- that is the compiler's job
 	// this is, again, much too close to assembly language
 
+	OGLH_NOTE_CALL_SITE();
+	OGLH_TIMER_BEGIN("oglh_set_rendering_to_fbo");
 	if(width > GL_MAX_RENDERBUFFER_SIZE || height > GL_MAX_RENDERBUFFER_SIZE)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
@@ -772,12 +1153,15 @@ void oglh_set_rendering_to_fbo(int width, int height)
 			width, height, GL_MAX_RENDERBUFFER_SIZE);
 	}
 
+	// the last one is finished with
+	if(helpers->fbo_frame_buffer_id != 0) oglh_delete_rendering_fbo();
+
 	// create a framebuffer object
-	glGenFramebuffers(1, &frame_buffer_id);
+	frame_buffer_id = oglh_registry_generate(OGLH_OBJECT_FRAMEBUFFER);
 
 	// GL_FRAMEBUFFER target simply sets both the read and the write to
 	// the same FBO.
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_id);
+	oglh_state_bind_framebuffer(GL_FRAMEBUFFER, frame_buffer_id);
 	if(!glIsFramebuffer(frame_buffer_id))
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
@@ -786,8 +1170,8 @@ void oglh_set_rendering_to_fbo(int width, int height)
 	}
 
 	// create a renderbuffer object to store the image
-	glGenRenderbuffers(1, &render_buffer_id);
-	glBindRenderbuffer(GL_RENDERBUFFER, render_buffer_id);
+	render_buffer_id = oglh_registry_generate(OGLH_OBJECT_RENDERBUFFER);
+	oglh_state_bind_renderbuffer(render_buffer_id);
 	if(!glIsRenderbuffer(render_buffer_id))
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
@@ -800,19 +1184,80 @@ void oglh_set_rendering_to_fbo(int width, int height)
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 		GL_RENDERBUFFER, render_buffer_id);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA4, width, height);
+	oglh_registry_set_image(OGLH_OBJECT_RENDERBUFFER, render_buffer_id,
+		GL_RGBA4, width, height, 1, 1);
 
 	oglh_check_framebuffer_completeness_status(__FILE__, __LINE__, __FUNC__);
-	glViewport(0, 0, width, height);
+	oglh_state_viewport(0, 0, width, height);
+
+	helpers->fbo_frame_buffer_id = frame_buffer_id;
+	helpers->fbo_render_buffer_id = render_buffer_id;
+	helpers->fbo_width = width;
+	helpers->fbo_height = height;
 
-	glReadBuffer(GL_COLOR_ATTACHMENT0);
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	oglh_state_read_buffer(GL_COLOR_ATTACHMENT0);
+	oglh_state_draw_buffer(GL_COLOR_ATTACHMENT0);
 
-	glEnable(GL_BLEND);					// enable blending etc.
-	glEnable(GL_TEXTURE_2D);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	oglh_state_enable(GL_BLEND);		// enable blending etc.
+	glEnable(GL_TEXTURE_2D);			// per texture unit, not cached
+	oglh_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	OGLH_TIMER_END();
+	OGLH_TRACE_HOOK(oglh_trace_fbo(width, height));
+}
+/*------------------------------------------------------------------------------
+	Deletes the FBO and its renderbuffer, rendering goes back to the default
+	framebuffer if the FBO was bound
+------------------------------------------------------------------------------*/
+void oglh_delete_rendering_fbo(void)
+{
+	GLint frame_buffer_name;
+
+	OGLH_NOTE_CALL_SITE();
+	if(helpers->fbo_frame_buffer_id == 0) return;
+
+	oglh_state_get_integerv(GL_FRAMEBUFFER_BINDING, &frame_buffer_name);
+	if((GLuint)frame_buffer_name == helpers->fbo_frame_buffer_id)
+		oglh_state_bind_framebuffer(GL_FRAMEBUFFER, 0);
+
+	oglh_registry_delete(OGLH_OBJECT_FRAMEBUFFER,
+		helpers->fbo_frame_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_RENDERBUFFER,
+		helpers->fbo_render_buffer_id);
+	helpers->fbo_frame_buffer_id = helpers->fbo_render_buffer_id = 0;
+	helpers->fbo_width = helpers->fbo_height = 0;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	the FBO made by oglh_set_rendering_to_fbo -- zero if there isn't one yet
+------------------------------------------------------------------------------*/
+GLuint oglh_get_rendering_fbo(int *width, int *height)
+{
+	if(width != NULL) *width = helpers->fbo_width;
+	if(height != NULL) *height = helpers->fbo_height;
+	return helpers->fbo_frame_buffer_id;
+}
+/*------------------------------------------------------------------------------
+	Draws through the helpers -- so they can be counted and traced
+------------------------------------------------------------------------------*/
+void oglh_draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+	OGLH_NOTE_CALL_SITE();
+	glDrawArrays(mode, first, count);
+	OGLH_TRACE_HOOK(oglh_trace_draw_arrays(mode, first, count));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	offset is in bytes into the bound GL_ELEMENT_ARRAY_BUFFER
+------------------------------------------------------------------------------*/
+void oglh_draw_elements(GLenum mode, GLsizei count, GLenum type, GLintptr offset)
+{
+	OGLH_NOTE_CALL_SITE();
+	glDrawElements(mode, count, type, (const void *)offset);
+	OGLH_TRACE_HOOK(oglh_trace_draw_elements(mode, count, type, offset));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 }
 /*------------------------------------------------------------------------------
 
@@ -903,8 +1348,9 @@ void oglh_display_active_uniform_variables(void)
 	GLfloat vec_data[4];
 	GLfloat mat_data[16];
 
+	OGLH_NOTE_CALL_SITE();
 	printf(ANSI_COLOR_GREEN);
-	glGetIntegerv(GL_CURRENT_PROGRAM, &program_id);
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
 	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &max_texture_units);
 
 	glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &number);
@@ -921,6 +1367,7 @@ void oglh_display_active_uniform_variables(void)
 	{
 		oglh_program_error(__FILE__, __LINE__, __FUNC__,
 			"out of memory opening variable_name buffer");
+		return;
 	}
 
 	printf(ANSI_COLOR_RESET);
@@ -1027,6 +1474,24 @@ void oglh_display_active_uniform_variables(void)
 	);
 	oglh_error_check(__FILE__, __LINE__, __FUNC__);
 }
+/*------------------------------------------------------------------------------
+	The helpers' part of an oglh context, see OpenGL_context.h
+------------------------------------------------------------------------------*/
+void *oglh_helpers_new_context(void)
+{
+	return calloc(1, sizeof(HELPER_CONTEXT));
+}
+
+void oglh_helpers_use_context(void *part)
+{
+	helpers = part != NULL ? part : &default_helpers;
+}
+
+void oglh_helpers_delete_context(void *part)
+{
+	if(part == helpers) helpers = &default_helpers;
+	free(part);
+}
 /*------------------------------------------------------------------------------
 
 ------------------------------------------------------------------------------*/
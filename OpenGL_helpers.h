@@ -88,10 +88,170 @@ typedef float vec4[4];
 typedef int sampler2D;
 typedef float *mat4;
 /*------------------------------------------------------------------------------
+	Error check levels
 
+	OGLH_CHECK_OFF		no glGetError at all
+	OGLH_CHECK_SAMPLED	glGetError once every OGLH_ERROR_CHECK_SAMPLE_INTERVAL
+	OGLH_CHECK_FULL		glGetError at the end of every helper
+
+	glGetError can make the driver synchronize so it is worth turning down
+	once things work. OGLH_ERROR_CHECK_LEVEL is the compile time ceiling, it
+	defaults to OFF when NDEBUG is defined -- in which case the checks and
+	call site notes compile to nothing. oglh_set_error_check_level picks a
+	level at runtime up to that ceiling.
+------------------------------------------------------------------------------*/
+#define OGLH_CHECK_OFF						0
+#define OGLH_CHECK_SAMPLED					1
+#define OGLH_CHECK_FULL						2
+
+#ifndef OGLH_ERROR_CHECK_LEVEL
+#ifdef NDEBUG
+#define OGLH_ERROR_CHECK_LEVEL				OGLH_CHECK_OFF
+#else
+#define OGLH_ERROR_CHECK_LEVEL				OGLH_CHECK_FULL
+#endif
+#endif
+
+#ifndef OGLH_ERROR_CHECK_SAMPLE_INTERVAL
+#define OGLH_ERROR_CHECK_SAMPLE_INTERVAL	64
+#endif
+
+void oglh_set_error_check_level(int level);
+/*------------------------------------------------------------------------------
+	Error handler
+
+	Every error and warning from the helpers goes through one handler. The
+	default prints in colour then, for errors, waits for a key and exits,
+	which is fine at a desk but not in a production process. Install your
+	own to log, throw or carry on; if it returns after an error the helper
+	returns as best it can (e.g. oglh_install_shader returns 0).
+
+	code is the GLenum for OpenGL errors, the KHR_debug message id for
+	debug output errors and EXIT_FAILURE for program errors.
 ------------------------------------------------------------------------------*/
-void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id);
+#define OGLH_SEVERITY_WARNING				1
+#define OGLH_SEVERITY_ERROR					2
+#define OGLH_SEVERITY_GL_ERROR				3
 
+typedef void (*OGLH_ERROR_HANDLER)
+(
+	int severity, int code,
+	const char *path_file, int line, const char *func, const char *message
+);
+
+void oglh_set_error_handler(OGLH_ERROR_HANDLER handler);	// NULL: the default
+/*------------------------------------------------------------------------------
+	GL_KHR_debug output instead of polling glGetError. Pair it with
+	oglh_set_error_check_level(OGLH_CHECK_OFF) to take glGetError out of
+	the helpers entirely. Each helper notes its call site on entry so a
+	debug message can be pinned to the helper that caused it.
+
+	Synchronous messages go to the error handler on the thread that made
+	the call. Asynchronous ones may arrive on a driver thread, so they are
+	only printed to stderr -- the handler is never called from there --
+	and, the call site being each thread's own, without the helper.
+------------------------------------------------------------------------------*/
+bool oglh_enable_debug_output(bool synchronous);
+bool oglh_has_extension(const char *extension_name);
+bool oglh_gl_version_or_extension(int version, const char *extension_name);
+
+typedef struct oglh_call_site
+{
+	const char *path_file;
+	int line;
+	const char *func;
+}
+OGLH_CALL_SITE;
+
+extern _Thread_local const OGLH_CALL_SITE *oglh_current_call_site;
+
+// a helper called from another hands the site back to its caller on return
+static inline void oglh_restore_call_site(const OGLH_CALL_SITE **outer_site)
+{
+	oglh_current_call_site = *outer_site;
+}
+
+#if OGLH_ERROR_CHECK_LEVEL != OGLH_CHECK_OFF || defined(OGLH_COUNTERS)
+#define OGLH_NOTE_CALL_SITE()											\
+	static const OGLH_CALL_SITE oglh_call_site =						\
+		{ __FILE__, __LINE__, __func__ };								\
+	const OGLH_CALL_SITE *oglh_outer_call_site							\
+		__attribute__((cleanup(oglh_restore_call_site))) =				\
+		oglh_current_call_site;											\
+	oglh_current_call_site = &oglh_call_site
+#else
+#define OGLH_NOTE_CALL_SITE() do { } while(0)
+#endif
+
+#include "OpenGL_counters.h"
+/*------------------------------------------------------------------------------
+	Error reporting shared by all the oglh_ modules. Call these with
+	__FILE__, __LINE__, __FUNC__ so the report points at the caller.
+------------------------------------------------------------------------------*/
+void oglh_program_error
+(
+	const char *path_file, int line, const char *func,
+	const char *control, ...
+);
+void oglh_program_warning
+(
+	const char *path_file, int line, const char *func, const char *control, ...
+);
+void oglh_error
+(
+	const char *path_file, int line, const char *func, GLenum error_code
+);
+/*------------------------------------------------------------------------------
+	OpenGL error checking -- can be sprinkled in code liberally
+------------------------------------------------------------------------------*/
+extern int oglh_error_check_level;
+extern _Thread_local unsigned int oglh_error_check_count;
+
+static inline void oglh_error_check
+(
+	const char *path_file, int line, const char *func
+)
+{
+#if OGLH_ERROR_CHECK_LEVEL != OGLH_CHECK_OFF
+	GLenum error_code;
+
+	if(oglh_error_check_level != OGLH_CHECK_FULL)
+	{
+		if(oglh_error_check_level == OGLH_CHECK_OFF) return;
+		if(++oglh_error_check_count % OGLH_ERROR_CHECK_SAMPLE_INTERVAL) return;
+	}
+
+	OGLH_COUNT_GL_CALL(OGLH_GL_GET_ERROR);
+	if((error_code = glGetError()) == GL_NO_ERROR)
+	{
+		return;	// quickly -- no need to report anything
+	}
+	else
+	{
+		oglh_error(path_file, line, func, error_code);
+	}
+#else
+	(void)path_file; (void)line; (void)func;
+#endif
+}
+/*------------------------------------------------------------------------------
+	The object's name comes from, and is recorded in, the object registry
+	(OpenGL_registry.h) along with the caller's file and line
+------------------------------------------------------------------------------*/
+#define oglh_generate_and_bind_opengl_object(type, object_id)				\
+	oglh_generate_and_bind_opengl_object_at(type, object_id,				\
+		__FILE__, __LINE__, __FUNC__)
+
+void oglh_generate_and_bind_opengl_object_at
+(
+	GLint type, GLuint *object_id,
+	const char *path_file, int line, const char *func
+);
+/*------------------------------------------------------------------------------
+	texture_map_unit is GL_TEXTURE0 + n; binds through the texture unit
+	manager (OpenGL_texture_units.h) and leaves the unit active
+------------------------------------------------------------------------------*/
+void oglh_activate_and_bind_opengl_texture(int texture_map_unit, int texture_id);
 
 /*------------------------------------------------------------------------------
 	In the folowing functions ensure that *data points to one of these C types:
@@ -111,6 +271,14 @@ void oglh_generate_and_bind_opengl_object(GLint type, GLuint *object_id);
 void oglh_get_uniform_variable(const char *variable_name, int type, void *data);
 void oglh_set_uniform_variable(const char *variable_name, int type, void *data);
 
+/*------------------------------------------------------------------------------
+	Uniform locations are looked up once per program and name, and kept in
+	the current oglh context (OpenGL_context.h). A program deleted through
+	the registry is forgotten; one relinked with glLinkProgram directly
+	must be forgotten by hand, 0 forgets them all.
+------------------------------------------------------------------------------*/
+void oglh_forget_uniform_locations(GLuint program_id);
+
 
 /*------------------------------------------------------------------------------
 	Set a uniform to an immediate constant value
@@ -136,16 +304,53 @@ void oglh_set_uniform_value(const char *variable_name, int type, ...);
 	An optional common header file shader_name.h is "included" in both shader 
 	files and can be used elsewhere. If the optional header is used then the 
 	GLSL version needs to be on the first line.
+
+	Each sampler uniform is given a texture unit of its own, see
+	OpenGL_texture_units.h.
 ------------------------------------------------------------------------------*/
 GLuint oglh_install_shader(const char *shader_name);
 
+// for OpenGL_feedback.c: varying are captured, there is no fragment shader
+GLuint oglh_install_shader_with_varyings
+(
+	const char *shader_name, int varyings, const char *const *varying
+);
+
+/*------------------------------------------------------------------------------
+	The source oglh_install_shader would compile for one stage, the header
+	included, in a buffer for the caller to free; NULL if it can't be read.
+	oglh_read_shader_source reads the same files without the instancing
+	and indirect rewrites, and says nothing -- no messages, no error
+	handler -- so it is the one for other threads (OpenGL_resources.h).
+------------------------------------------------------------------------------*/
+char *oglh_load_shader_source(const char *shader_name, GLenum shader_type);
+char *oglh_read_shader_source(const char *shader_name, GLenum shader_type);
+
 
 /*------------------------------------------------------------------------------
 	Now for simple FBO use. Use the normal glDraw routines and periodically
-	blit the FBO to the front buffer
+	blit the FBO to the front buffer. Setting up a new FBO deletes the last
+	one, oglh_delete_rendering_fbo deletes it and goes back to the default
+	framebuffer. Each oglh context has an FBO of its own.
 ------------------------------------------------------------------------------*/
 void oglh_set_rendering_to_fbo(int width, int height);
+void oglh_delete_rendering_fbo(void);
 void oglh_blit_fbo_to_front_buffer(void);
+GLuint oglh_get_rendering_fbo(int *width, int *height);
+
+// for OpenGL_context.c
+void *oglh_helpers_new_context(void);
+void oglh_helpers_use_context(void *part);
+void oglh_helpers_delete_context(void *part);
+
+
+/*------------------------------------------------------------------------------
+	Draw calls that go through the helpers, so that they are counted and
+	traced along with everything else. offset is in bytes into the bound
+	GL_ELEMENT_ARRAY_BUFFER.
+------------------------------------------------------------------------------*/
+void oglh_draw_arrays(GLenum mode, GLint first, GLsizei count);
+void oglh_draw_elements(GLenum mode, GLsizei count, GLenum type, GLintptr offset);
 
 
 /*------------------------------------------------------------------------------
@@ -155,6 +360,7 @@ void oglh_blit_fbo_to_front_buffer(void);
 	
 ------------------------------------------------------------------------------*/
 void oglh_display_active_uniform_variables(void);
+GLSL_UNIFORM_TYPE *oglh_find_uniform_variable_template(GLint gl_type);
 
 
 /*------------------------------------------------------------------------------
@@ -0,0 +1,400 @@
+/*------------------------------------------------------------------------------
+	oglh_ indirect drawing -- thousands of meshes in one draw call
+
+	The arenas are filled front to back and never compacted; a mesh lives
+	as long as its scene. Commands and draw data are built on the CPU and
+	uploaded whole at each submit, the buffers orphaned first so the
+	driver needn't wait for the last frame's draws to finish with them.
+------------------------------------------------------------------------------*/
+#include "OpenGL_indirect.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static _Thread_local const char *installing;	// shader name, on this thread
+
+/*------------------------------------------------------------------------------
+	Asked of the current context each time, once per scene or shader. GL
+	4.6 has gl_DrawID in core, but only for #version 460 shaders, so only
+	the extension is certain for any shader.
+------------------------------------------------------------------------------*/
+static bool have_draw_parameters_extension(void)
+{
+#ifdef OGLH_INDIRECT_BASE_INSTANCE
+	return false;
+#else
+	return oglh_has_extension("GL_ARB_shader_draw_parameters");
+#endif
+}
+
+static bool have_core_draw_parameters(long shader_version)
+{
+#ifdef OGLH_INDIRECT_BASE_INSTANCE
+	(void)shader_version;
+	return false;
+#else
+	return shader_version >= 460 && oglh_gl_version_or_extension(46, NULL);
+#endif
+}
+
+static bool have_multi_draw_indirect(void)
+{
+	return oglh_gl_version_or_extension(43, "GL_ARB_multi_draw_indirect");
+}
+/*------------------------------------------------------------------------------
+	A buffer of size bytes made and bound through the helpers
+------------------------------------------------------------------------------*/
+static GLuint create_buffer(GLenum target, GLsizeiptr size, const void *data)
+{
+	GLuint buffer_id;
+
+	oglh_generate_and_bind_opengl_object(target, &buffer_id);
+	glBufferData(target, size, data,
+		target == GL_DRAW_INDIRECT_BUFFER || target == GL_SHADER_STORAGE_BUFFER ?
+		GL_STREAM_DRAW : GL_STATIC_DRAW);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, buffer_id, size);
+	return buffer_id;
+}
+/*------------------------------------------------------------------------------
+	Leaves the scene's vertex array and vertex arena bound for the caller
+	to describe the vertex format with glVertexAttribPointer
+------------------------------------------------------------------------------*/
+bool oglh_indirect_create
+(
+	OGLH_INDIRECT_SCENE *scene, GLsizei vertex_stride, GLsizeiptr vertex_bytes,
+	GLsizeiptr index_count, int max_draws, GLsizeiptr draw_data_size
+)
+{
+	GLuint *draw_ids;
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(scene, 0, sizeof(*scene));
+
+	if(vertex_stride <= 0 || vertex_bytes < vertex_stride || index_count <= 0 ||
+		max_draws <= 0 || draw_data_size < 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"bad indirect scene: stride %d, %ld vertex bytes, %ld indices, "
+			"%d draws, %ld bytes a draw", vertex_stride, (long)vertex_bytes,
+			(long)index_count, max_draws, (long)draw_data_size);
+		return false;
+	}
+
+	scene->command = calloc(max_draws, sizeof(OGLH_INDIRECT_COMMAND));
+	scene->draw_data = calloc(max_draws, draw_data_size ? draw_data_size : 1);
+	if(scene->command == NULL || scene->draw_data == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for %d indirect draws", max_draws);
+		free(scene->command);
+		free(scene->draw_data);
+		return false;
+	}
+
+	scene->vertex_stride = vertex_stride;
+	scene->vertex_bytes = vertex_bytes;
+	scene->index_count = index_count;
+	scene->max_draws = max_draws;
+	scene->draw_data_size = draw_data_size;
+	scene->multi_draw = have_multi_draw_indirect();
+
+	oglh_generate_and_bind_opengl_object(GL_VERTEX_ARRAY,
+		&scene->vertex_array_id);
+	scene->index_buffer_id = create_buffer(GL_ELEMENT_ARRAY_BUFFER,
+		index_count * sizeof(GLuint), NULL);
+	scene->command_buffer_id = create_buffer(GL_DRAW_INDIRECT_BUFFER,
+		max_draws * sizeof(OGLH_INDIRECT_COMMAND), NULL);
+	if(draw_data_size > 0)
+	{
+		scene->draw_data_buffer_id = create_buffer(GL_SHADER_STORAGE_BUFFER,
+			max_draws * draw_data_size, NULL);
+	}
+
+	if(!have_draw_parameters_extension())
+	{
+		// draw i has base instance i, this turns it back into i; made
+		// for a #version 460 shader using gl_DrawID too, it's small
+		if((draw_ids = malloc(max_draws * sizeof(GLuint))) != NULL)
+		{
+			for(index = 0; index < max_draws; index++) draw_ids[index] = index;
+			scene->draw_id_buffer_id = create_buffer(GL_ARRAY_BUFFER,
+				max_draws * sizeof(GLuint), draw_ids);
+			free(draw_ids);
+
+			glVertexAttribIPointer(OGLH_INDIRECT_DRAW_ID_LOCATION, 1,
+				GL_UNSIGNED_INT, 0, 0);
+			glVertexAttribDivisor(OGLH_INDIRECT_DRAW_ID_LOCATION, 1);
+			glEnableVertexAttribArray(OGLH_INDIRECT_DRAW_ID_LOCATION);
+		}
+	}
+
+	// last, so it is the array buffer bound for the caller
+	scene->vertex_buffer_id = create_buffer(GL_ARRAY_BUFFER, vertex_bytes, NULL);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Copies the mesh into the arenas. Its indices count from its own first
+	vertex, as they would in a buffer of its own.
+------------------------------------------------------------------------------*/
+int oglh_indirect_add_mesh
+(
+	OGLH_INDIRECT_SCENE *scene, const void *vertices, GLsizei vertex_count,
+	const GLuint *indices, GLsizei index_count
+)
+{
+	OGLH_INDIRECT_MESH *mesh, *larger;
+	GLsizeiptr vertex_capacity = scene->vertex_bytes / scene->vertex_stride;
+	int allocate;
+
+	OGLH_NOTE_CALL_SITE();
+	if(scene->vertices_used + vertex_count > vertex_capacity ||
+		scene->indices_used + index_count > scene->index_count)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"indirect scene arenas are full: %ld of %ld vertices, "
+			"%ld of %ld indices", (long)scene->vertices_used,
+			(long)vertex_capacity, (long)scene->indices_used,
+			(long)scene->index_count);
+		return -1;
+	}
+
+	if(scene->meshes == scene->meshes_allocated)
+	{
+		allocate = scene->meshes_allocated ? scene->meshes_allocated * 2 : 64;
+		if((larger = realloc(scene->mesh,
+			allocate * sizeof(OGLH_INDIRECT_MESH))) == NULL)
+		{
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"no memory for %d meshes", allocate);
+			return -1;
+		}
+		scene->mesh = larger;
+		scene->meshes_allocated = allocate;
+	}
+
+	mesh = &scene->mesh[scene->meshes];
+	mesh->first_index = scene->indices_used;
+	mesh->index_count = index_count;
+	mesh->base_vertex = scene->vertices_used;
+
+	oglh_state_bind_buffer(GL_ARRAY_BUFFER, scene->vertex_buffer_id);
+	glBufferSubData(GL_ARRAY_BUFFER,
+		scene->vertices_used * scene->vertex_stride,
+		(GLsizeiptr)vertex_count * scene->vertex_stride, vertices);
+
+	// the index buffer is the vertex array's, copy through the other target
+	oglh_state_bind_buffer(GL_COPY_WRITE_BUFFER, scene->index_buffer_id);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, scene->indices_used * sizeof(GLuint),
+		(GLsizeiptr)index_count * sizeof(GLuint), indices);
+
+	scene->vertices_used += vertex_count;
+	scene->indices_used += index_count;
+	scene->statistics.meshes++;
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return scene->meshes++;
+}
+/*------------------------------------------------------------------------------
+	draw_data is draw_data_size bytes, or NULL for a scene without any
+------------------------------------------------------------------------------*/
+bool oglh_indirect_draw
+(
+	OGLH_INDIRECT_SCENE *scene, int mesh, const void *draw_data
+)
+{
+	OGLH_INDIRECT_COMMAND *command;
+
+	if(mesh < 0 || mesh >= scene->meshes)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no mesh %d in the indirect scene", mesh);
+		return false;
+	}
+	if(scene->draws == scene->max_draws)
+	{
+		scene->statistics.dropped++;
+		return false;
+	}
+
+	command = &scene->command[scene->draws];
+	command->count = scene->mesh[mesh].index_count;
+	command->instance_count = 1;
+	command->first_index = scene->mesh[mesh].first_index;
+	command->base_vertex = scene->mesh[mesh].base_vertex;
+	command->base_instance = scene->draws;
+
+	if(draw_data != NULL && scene->draw_data_size > 0)
+	{
+		memcpy(scene->draw_data + scene->draws * scene->draw_data_size,
+			draw_data, scene->draw_data_size);
+	}
+
+	scene->draws++;
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Uploads and draws everything added since the last submit, with the
+	current program
+------------------------------------------------------------------------------*/
+void oglh_indirect_submit(OGLH_INDIRECT_SCENE *scene, GLenum mode)
+{
+	OGLH_INDIRECT_COMMAND *command;
+	GLsizeiptr bytes;
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(scene->draws == 0) return;
+
+	oglh_state_bind_vertex_array(scene->vertex_array_id);
+
+	bytes = scene->max_draws * sizeof(OGLH_INDIRECT_COMMAND);
+	oglh_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, scene->command_buffer_id);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0,
+		scene->draws * sizeof(OGLH_INDIRECT_COMMAND), scene->command);
+
+	if(scene->draw_data_buffer_id != 0)
+	{
+		bytes = scene->max_draws * scene->draw_data_size;
+		oglh_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER,
+			OGLH_INDIRECT_DRAW_DATA_BINDING, scene->draw_data_buffer_id);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
+			scene->draws * scene->draw_data_size, scene->draw_data);
+	}
+
+	if(scene->multi_draw)
+	{
+		glMultiDrawElementsIndirect(mode, GL_UNSIGNED_INT, NULL,
+			scene->draws, 0);
+	}
+	else
+	{
+		for(index = 0; index < scene->draws; index++)
+		{
+			command = &scene->command[index];
+			glDrawElementsInstancedBaseVertexBaseInstance(mode,
+				command->count, GL_UNSIGNED_INT,
+				(const void *)(command->first_index * sizeof(GLuint)),
+				command->instance_count, command->base_vertex,
+				command->base_instance);
+		}
+	}
+
+	scene->statistics.draws += scene->draws;
+	scene->statistics.submits++;
+	scene->draws = 0;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_indirect_delete(OGLH_INDIRECT_SCENE *scene)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(scene->vertex_array_id == 0) return;
+
+	oglh_registry_delete(OGLH_OBJECT_VERTEX_ARRAY, scene->vertex_array_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, scene->vertex_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, scene->index_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, scene->command_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, scene->draw_data_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, scene->draw_id_buffer_id);
+	free(scene->mesh);
+	free(scene->command);
+	free(scene->draw_data);
+	memset(scene, 0, sizeof(*scene));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+void oglh_indirect_get_statistics
+(
+	const OGLH_INDIRECT_SCENE *scene, OGLH_INDIRECT_STATISTICS *statistics
+)
+{
+	*statistics = scene->statistics;
+}
+/*------------------------------------------------------------------------------
+	As oglh_install_shader, with OGLH_DRAW_ID defined in the vertex shader
+------------------------------------------------------------------------------*/
+GLuint oglh_install_indirect_shader(const char *shader_name)
+{
+	GLuint program_id;
+
+	OGLH_NOTE_CALL_SITE();
+	installing = shader_name;
+	program_id = oglh_install_shader(shader_name);
+	installing = NULL;
+	return program_id;
+}
+/*------------------------------------------------------------------------------
+	Called by the shader loader for every shader it reads. The definition
+	of OGLH_DRAW_ID goes after the #version line, in place; false if it
+	won't fit in size.
+------------------------------------------------------------------------------*/
+bool oglh_indirect_rewrite_source
+(
+	const char *shader_name, GLenum shader_type, char *source, size_t size
+)
+{
+	char definition[256], *version, *line;
+	long shader_version = 110;		// GLSL's, without a #version
+	size_t length, used;
+
+	if(installing == NULL || shader_type != GL_VERTEX_SHADER ||
+		strcmp(shader_name, installing) != 0)
+	{
+		return true;
+	}
+
+	// after #version, which must come first, or at the start without one
+	line = source;
+	if((version = strstr(source, "#version")) != NULL)
+	{
+		shader_version = strtol(version + strlen("#version"), NULL, 10);
+		line = strchr(version, '\n');
+		line = line ? line + 1 : version + strlen(version);
+	}
+
+	// drawn one by one the draw ID is always 0, the base instance isn't
+	if(have_draw_parameters_extension())
+	{
+		length = snprintf(definition, sizeof(definition),
+			"#extension GL_ARB_shader_draw_parameters : require\n"
+			"#define OGLH_DRAW_ID %s\n", have_multi_draw_indirect() ?
+			"gl_DrawIDARB" : "int(gl_BaseInstanceARB)");
+	}
+	else if(have_core_draw_parameters(shader_version))
+	{
+		length = snprintf(definition, sizeof(definition),
+			"#define OGLH_DRAW_ID %s\n", have_multi_draw_indirect() ?
+			"gl_DrawID" : "gl_BaseInstance");
+	}
+	else
+	{
+		length = snprintf(definition, sizeof(definition),
+			"layout(location = %d) in uint oglh_draw_id;\n"
+			"#define OGLH_DRAW_ID int(oglh_draw_id)\n",
+			OGLH_INDIRECT_DRAW_ID_LOCATION);
+	}
+
+	used = strlen(source) + 1;
+	if(used + length > size)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no room in the source of '%s' for OGLH_DRAW_ID", shader_name);
+		return false;
+	}
+
+	memmove(line + length, line, used - (line - source));
+	memcpy(line, definition, length);
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,140 @@
+/*------------------------------------------------------------------------------
+	oglh_ indirect drawing -- thousands of meshes in one draw call
+
+	Meshes share one vertex buffer and one index buffer, the arenas, so a
+	single vertex array can draw any of them. Each oglh_indirect_draw adds a
+	DrawElementsIndirectCommand and the draw's own data -- a model matrix,
+	a material -- and oglh_indirect_submit hands the lot to the GPU in one
+	glMultiDrawElementsIndirect.
+
+	OGLH_INDIRECT_SCENE scene;
+	oglh_indirect_create(&scene, sizeof(VERTEX), 64 << 20, 16 << 20,
+		20000, sizeof(DRAW_DATA));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), 0);
+	glEnableVertexAttribArray(0);			// the scene's vertex array is bound
+	rock = oglh_indirect_add_mesh(&scene, rock_vertices, 2400,
+		rock_indices, 12000);
+	GLuint program = oglh_install_indirect_shader("scene");
+	...
+	for(i = 0; i < rocks; i++)
+		oglh_indirect_draw(&scene, rock, &rock_data[i]);
+	oglh_indirect_submit(&scene, GL_TRIANGLES);
+
+	In the vertex shader OGLH_DRAW_ID is the index of the draw, for the
+	draw data in the shader storage buffer at binding
+	OGLH_INDIRECT_DRAW_DATA_BINDING:
+
+	struct DRAW_DATA { mat4 model; vec4 colour; };
+	layout(std430, binding = 0) readonly buffer draw_data_block
+	{
+		DRAW_DATA draw_data[];
+	};
+	...
+	gl_Position = projection * draw_data[OGLH_DRAW_ID].model * vec4(p, 1);
+
+	oglh_install_indirect_shader defines OGLH_DRAW_ID as gl_DrawIDARB where
+	ARB_shader_draw_parameters is listed, or as gl_DrawID for a #version
+	460 shader on GL 4.6 without it. Each command's base instance
+	is its draw index too, and elsewhere that is read back through an
+	instanced vertex attribute at OGLH_INDIRECT_DRAW_ID_LOCATION holding
+	0, 1, 2 ... -- build with OGLH_INDIRECT_BASE_INSTANCE to use that
+	everywhere.
+
+	Without ARB_multi_draw_indirect (GL 4.3) the commands are drawn one by
+	one with glDrawElementsInstancedBaseVertexBaseInstance, which still
+	saves the uniform calls between them. Indices are GLuint.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_INDIRECT_DRAW_DATA_BINDING		0
+#define OGLH_INDIRECT_DRAW_ID_LOCATION		15
+
+typedef struct oglh_indirect_command	// as glMultiDrawElementsIndirect reads it
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+}
+OGLH_INDIRECT_COMMAND;
+
+typedef struct oglh_indirect_mesh
+{
+	GLuint first_index;
+	GLuint index_count;
+	GLint base_vertex;
+}
+OGLH_INDIRECT_MESH;
+
+typedef struct oglh_indirect_statistics
+{
+	long meshes;
+	long draws;				// commands submitted
+	long submits;			// glMultiDrawElementsIndirect calls, or loops
+	long dropped;			// draws past max_draws
+}
+OGLH_INDIRECT_STATISTICS;
+
+typedef struct oglh_indirect_scene		// the fields are the module's
+{
+	GLuint vertex_array_id;
+	GLuint vertex_buffer_id;
+	GLuint index_buffer_id;
+	GLuint command_buffer_id;
+	GLuint draw_data_buffer_id;
+	GLuint draw_id_buffer_id;			// 0 with gl_DrawIDARB
+
+	GLsizei vertex_stride;
+	GLsizeiptr vertex_bytes, vertices_used;	// vertices_used in vertices
+	GLsizeiptr index_count, indices_used;
+
+	OGLH_INDIRECT_MESH *mesh;
+	int meshes, meshes_allocated;
+
+	OGLH_INDIRECT_COMMAND *command;
+	unsigned char *draw_data;
+	GLsizeiptr draw_data_size;
+	int draws, max_draws;
+
+	bool multi_draw;
+	OGLH_INDIRECT_STATISTICS statistics;
+}
+OGLH_INDIRECT_SCENE;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_indirect_create
+(
+	OGLH_INDIRECT_SCENE *scene, GLsizei vertex_stride, GLsizeiptr vertex_bytes,
+	GLsizeiptr index_count, int max_draws, GLsizeiptr draw_data_size
+);
+int oglh_indirect_add_mesh	// -1 if the arenas are full
+(
+	OGLH_INDIRECT_SCENE *scene, const void *vertices, GLsizei vertex_count,
+	const GLuint *indices, GLsizei index_count
+);
+bool oglh_indirect_draw
+(
+	OGLH_INDIRECT_SCENE *scene, int mesh, const void *draw_data
+);
+void oglh_indirect_submit(OGLH_INDIRECT_SCENE *scene, GLenum mode);
+void oglh_indirect_delete(OGLH_INDIRECT_SCENE *scene);
+void oglh_indirect_get_statistics
+(
+	const OGLH_INDIRECT_SCENE *scene, OGLH_INDIRECT_STATISTICS *statistics
+);
+
+GLuint oglh_install_indirect_shader(const char *shader_name);
+
+// for the shader loader
+bool oglh_indirect_rewrite_source
+(
+	const char *shader_name, GLenum shader_type, char *source, size_t size
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,740 @@
+/*------------------------------------------------------------------------------
+	oglh_ instancing -- per-object uniforms batched into instanced draws
+
+	Each instanced program has a layout: its per-instance uniforms, where
+	each one goes in an instance's values and which attribute location it
+	is read from. The layout also holds the current values, set by
+	oglh_batch_uniform as uniforms would be, and copied into the values
+	arena by each oglh_batch_draw_*.
+
+	draw[]		one record per object: what to draw and where its values are
+	values		the arena of the objects' values, layout->stride bytes each
+
+	With GL 4.2 (ARB_base_instance) the attribute pointers are set once per
+	vertex array and layout in a flush and each bucket starts at its own
+	base instance; before that they are set again for every bucket.
+------------------------------------------------------------------------------*/
+#include "OpenGL_instancing.h"
+#include "OpenGL_stream.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+#include <ctype.h>			//	Character classification
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define MAX_NAME_SIZE		64
+#define MAX_INSTANCE_BYTES	(OGLH_MAX_INSTANCE_UNIFORMS * 64)
+
+typedef struct instance_uniform
+{
+	char name[MAX_NAME_SIZE];
+	GLenum type;
+	const char *glsl_type;
+	int location;			// of the first column
+	int columns;			// 4 for a mat4, 1 otherwise
+	int components;			// per column
+	bool integer;
+	int offset;				// into an instance's values
+}
+INSTANCE_UNIFORM;
+
+typedef struct instance_layout
+{
+	GLuint program_id;
+	int uniforms;
+	INSTANCE_UNIFORM uniform[OGLH_MAX_INSTANCE_UNIFORMS];
+	int stride;
+	unsigned char values[MAX_INSTANCE_BYTES];	// the current values
+}
+INSTANCE_LAYOUT;
+
+typedef struct batch_draw
+{
+	INSTANCE_LAYOUT *layout;
+	GLuint vertex_array_id;
+	GLenum mode;
+	GLenum index_type;		// 0 for glDrawArrays
+	GLsizei count;
+	GLintptr first;			// first vertex or byte offset of the indices
+	long sequence;			// keeps submission order inside a bucket
+	size_t values;			// offset into the values arena
+}
+BATCH_DRAW;
+
+typedef struct batch_context
+{
+	INSTANCE_LAYOUT layout[OGLH_MAX_INSTANCED_PROGRAMS];
+	int layouts;
+
+	BATCH_DRAW *draw;
+	long draws;
+	size_t draws_allocated;
+	unsigned char *values;
+	size_t values_used, values_allocated;
+
+	bool stream_created;
+	bool base_instance;
+	OGLH_STREAM_BUFFER stream;
+	OGLH_BATCH_STATISTICS statistics;
+}
+BATCH_CONTEXT;
+
+static BATCH_CONTEXT default_batch;
+static _Thread_local BATCH_CONTEXT *batch = &default_batch;
+
+// the shader being installed on this thread and its layout
+static _Thread_local const char *installing;
+static _Thread_local INSTANCE_LAYOUT *pending;
+/*------------------------------------------------------------------------------
+	Columns and components of a supported type, false if it isn't
+------------------------------------------------------------------------------*/
+static bool instance_type
+(
+	GLenum type, int *columns, int *components, bool *integer
+)
+{
+	*columns = 1;
+	*integer = false;
+
+	switch(type)
+	{
+		case GL_FLOAT:			*components = 1;					break;
+		case GL_FLOAT_VEC2:		*components = 2;					break;
+		case GL_FLOAT_VEC3:		*components = 3;					break;
+		case GL_FLOAT_VEC4:		*components = 4;					break;
+		case GL_INT:			*components = 1; *integer = true;	break;
+		case GL_INT_VEC2:		*components = 2; *integer = true;	break;
+		case GL_INT_VEC3:		*components = 3; *integer = true;	break;
+		case GL_INT_VEC4:		*components = 4; *integer = true;	break;
+		case GL_FLOAT_MAT4:		*components = 4; *columns = 4;		break;
+		default:
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Compiles and links the shader as oglh_install_shader does, with the
+	named uniforms turned into per-instance attributes in the vertex shader
+------------------------------------------------------------------------------*/
+GLuint oglh_install_instanced_shader
+(
+	const char *shader_name, int count, const char *uniform_names[],
+	const GLenum uniform_types[]
+)
+{
+	INSTANCE_LAYOUT layout;
+	INSTANCE_UNIFORM *uniform;
+	GLSL_UNIFORM_TYPE *glsl_type;
+	GLint max_attributes = 0;
+	GLuint program_id;
+	int index, free_index = -1, location = OGLH_INSTANCE_ATTRIBUTE_FIRST;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(&layout, 0, sizeof(layout));
+	glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &max_attributes);
+
+	if(count < 1 || count > OGLH_MAX_INSTANCE_UNIFORMS)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"%d per-instance uniforms for '%s', 1 to %d can be",
+			count, shader_name, OGLH_MAX_INSTANCE_UNIFORMS);
+		return 0;
+	}
+
+	for(index = 0; index < count; index++)
+	{
+		uniform = &layout.uniform[index];
+		if(!instance_type(uniform_types[index], &uniform->columns,
+			&uniform->components, &uniform->integer) ||
+			(glsl_type = oglh_find_uniform_variable_template(
+				uniform_types[index])) == NULL)
+		{
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"per-instance uniform '%s' can't be of type 0x%x",
+				uniform_names[index], uniform_types[index]);
+			return 0;
+		}
+
+		snprintf(uniform->name, sizeof(uniform->name), "%s",
+			uniform_names[index]);
+		uniform->type = uniform_types[index];
+		uniform->glsl_type = glsl_type->glsl_type_name;
+		uniform->location = location;
+		uniform->offset = layout.stride;
+
+		location += uniform->columns;
+		layout.stride += uniform->columns * uniform->components * 4;
+	}
+	layout.uniforms = count;
+
+	if(location > max_attributes)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"'%s' needs attribute locations up to %d, there are %d",
+			shader_name, location - 1, max_attributes);
+		return 0;
+	}
+
+	installing = shader_name;
+	pending = &layout;
+	program_id = oglh_install_shader(shader_name);
+	installing = NULL;
+	pending = NULL;
+	if(program_id == 0) return 0;
+
+	// a program reinstalled under the same name takes its old entry, a new
+	// one the first a deleted program left
+	for(index = 0; index < batch->layouts; index++)
+	{
+		if(batch->layout[index].program_id == program_id) break;
+		if(batch->layout[index].program_id == 0 && free_index < 0)
+			free_index = index;
+	}
+	if(index == batch->layouts && free_index >= 0) index = free_index;
+	if(index == OGLH_MAX_INSTANCED_PROGRAMS)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"more than %d instanced programs", OGLH_MAX_INSTANCED_PROGRAMS);
+		return program_id;
+	}
+	if(index == batch->layouts) batch->layouts++;
+
+	layout.program_id = program_id;
+	batch->layout[index] = layout;
+	return program_id;
+}
+/*------------------------------------------------------------------------------
+	Called by the shader loader for every shader it reads. While an
+	instanced shader is being installed, each per-instance uniform declared
+	in its vertex shader becomes an attribute. In place, false if it won't
+	fit in size.
+------------------------------------------------------------------------------*/
+static char *skip_word(char *text, const char *word)
+{
+	size_t length = strlen(word);
+
+	if(strncmp(text, word, length) != 0 ||
+		isalnum((unsigned char)text[length]) || text[length] == '_')
+	{
+		return NULL;
+	}
+	return text + length;
+}
+
+static char *skip_space(char *text)
+{
+	while(*text == ' ' || *text == '\t') text++;
+	return text;
+}
+
+bool oglh_instancing_rewrite_source
+(
+	const char *shader_name, GLenum shader_type, char *source, size_t size
+)
+{
+	INSTANCE_UNIFORM *uniform = NULL;
+	char *line, *declaration, *text = NULL, replacement[2 * MAX_NAME_SIZE + 64];
+	size_t old_length, new_length, used;
+	int index;
+	bool found[OGLH_MAX_INSTANCE_UNIFORMS] = { false };
+
+	if(installing == NULL || shader_type != GL_VERTEX_SHADER ||
+		strcmp(shader_name, installing) != 0)
+	{
+		return true;
+	}
+
+	for(line = source; line != NULL && *line != '\0';
+		line = (line = strchr(line, '\n')) ? line + 1 : NULL)
+	{
+		// uniform <type> <name> ;
+		declaration = skip_word(skip_space(line), "uniform");
+		if(declaration == NULL) continue;
+
+		for(index = 0; index < pending->uniforms; index++)
+		{
+			uniform = &pending->uniform[index];
+			if((text = skip_word(skip_space(declaration), uniform->glsl_type)) &&
+				(text = skip_word(skip_space(text), uniform->name)) &&
+				*(text = skip_space(text)) == ';')
+			{
+				break;
+			}
+		}
+		if(index == pending->uniforms) continue;
+
+		new_length = snprintf(replacement, sizeof(replacement),
+			"layout(location = %d) in %s %s;", uniform->location,
+			uniform->glsl_type, uniform->name);
+		line = skip_space(line);
+		old_length = text + 1 - line;
+		used = strlen(source) + 1;
+
+		if(used - old_length + new_length > size)
+		{
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"no room in the source of '%s' for its instance attributes",
+				shader_name);
+			return false;
+		}
+
+		memmove(line + new_length, line + old_length,
+			used - (line - source) - old_length);
+		memcpy(line, replacement, new_length);
+		found[index] = true;
+	}
+
+	for(index = 0; index < pending->uniforms; index++)
+	{
+		if(!found[index])
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"'uniform %s %s;' isn't declared in the vertex shader of '%s'",
+				pending->uniform[index].glsl_type,
+				pending->uniform[index].name, shader_name);
+		}
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static INSTANCE_LAYOUT *current_layout(void)
+{
+	GLint program_id;
+	int index;
+
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
+	if(program_id == 0) return NULL;	// a deleted program's entry is 0
+
+	for(index = 0; index < batch->layouts; index++)
+	{
+		if(batch->layout[index].program_id == (GLuint)program_id)
+			return &batch->layout[index];
+	}
+	return NULL;
+}
+
+static INSTANCE_UNIFORM *find_uniform
+(
+	INSTANCE_LAYOUT *layout, const char *variable_name
+)
+{
+	int index;
+
+	for(index = 0; layout != NULL && index < layout->uniforms; index++)
+	{
+		if(strcmp(layout->uniform[index].name, variable_name) == 0)
+			return &layout->uniform[index];
+	}
+	return NULL;
+}
+/*------------------------------------------------------------------------------
+	Like oglh_set_uniform_variable. A per-instance uniform of the current
+	program is kept for the draws that follow; any other is set at once,
+	after flushing the draws made with its old value.
+------------------------------------------------------------------------------*/
+void oglh_batch_uniform(const char *variable_name, int type, void *data)
+{
+	INSTANCE_UNIFORM *uniform;
+	float *matrix = data, *column;
+	int row, column_index;
+
+	OGLH_NOTE_CALL_SITE();
+	if((uniform = find_uniform(current_layout(), variable_name)) == NULL)
+	{
+		oglh_batch_flush();
+		oglh_set_uniform_variable(variable_name, type, data);
+		return;
+	}
+
+	if(type != (int)uniform->type)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"per-instance uniform '%s' is 0x%x not 0x%x",
+			variable_name, uniform->type, type);
+		return;
+	}
+
+	column = (float *)(current_layout()->values + uniform->offset);
+	if(uniform->columns == 1)
+	{
+		memcpy(column, data, uniform->components * 4);
+		return;
+	}
+
+	// row first in, a column per attribute location out
+	for(column_index = 0; column_index < 4; column_index++)
+	{
+		for(row = 0; row < 4; row++)
+			column[column_index * 4 + row] = matrix[row * 4 + column_index];
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static bool grow(void **array, size_t *allocated, size_t needed, size_t unit)
+{
+	size_t count = *allocated ? *allocated : 256;
+	void *larger;
+
+	if(needed <= *allocated) return true;
+	while(count < needed) count *= 2;
+
+	if((larger = realloc(*array, count * unit)) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for %zu batched draws", needed);
+		return false;
+	}
+	*array = larger;
+	*allocated = count;
+	return true;
+}
+
+static void record_draw
+(
+	GLenum mode, GLsizei count, GLenum index_type, GLintptr first
+)
+{
+	INSTANCE_LAYOUT *layout;
+	BATCH_DRAW *draw;
+	GLint vertex_array_id;
+
+	if((layout = current_layout()) == NULL)
+	{
+		// not instanced, drawn now and in order
+		oglh_batch_flush();
+		if(index_type == 0)
+			oglh_draw_arrays(mode, first, count);
+		else
+			oglh_draw_elements(mode, count, index_type, first);
+		return;
+	}
+
+	if(!grow((void **)&batch->draw, &batch->draws_allocated, batch->draws + 1,
+		sizeof(BATCH_DRAW)) ||
+		!grow((void **)&batch->values, &batch->values_allocated,
+		batch->values_used + layout->stride, 1))
+	{
+		batch->statistics.dropped++;
+		return;
+	}
+
+	oglh_state_get_integerv(GL_VERTEX_ARRAY_BINDING, &vertex_array_id);
+	draw = &batch->draw[batch->draws];
+	draw->layout = layout;
+	draw->vertex_array_id = vertex_array_id;
+	draw->mode = mode;
+	draw->index_type = index_type;
+	draw->count = count;
+	draw->first = first;
+	draw->sequence = batch->draws++;
+	draw->values = batch->values_used;
+
+	memcpy(batch->values + batch->values_used, layout->values, layout->stride);
+	batch->values_used += layout->stride;
+	batch->statistics.objects++;
+}
+
+void oglh_batch_draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+	OGLH_NOTE_CALL_SITE();
+	record_draw(mode, count, 0, first);
+}
+
+void oglh_batch_draw_elements
+(
+	GLenum mode, GLsizei count, GLenum type, GLintptr offset
+)
+{
+	OGLH_NOTE_CALL_SITE();
+	record_draw(mode, count, type, offset);
+}
+/*------------------------------------------------------------------------------
+	Bucket order: the same program, vertex array and range drawn are
+	neighbours, in the order they were submitted
+------------------------------------------------------------------------------*/
+static int compare_draws(const void *first, const void *second)
+{
+	const BATCH_DRAW *a = first, *b = second;
+
+	if(a->layout != b->layout) return a->layout < b->layout ? -1 : 1;
+	if(a->vertex_array_id != b->vertex_array_id)
+		return a->vertex_array_id < b->vertex_array_id ? -1 : 1;
+	if(a->mode != b->mode) return a->mode < b->mode ? -1 : 1;
+	if(a->index_type != b->index_type)
+		return a->index_type < b->index_type ? -1 : 1;
+	if(a->count != b->count) return a->count < b->count ? -1 : 1;
+	if(a->first != b->first) return a->first < b->first ? -1 : 1;
+	return a->sequence < b->sequence ? -1 : a->sequence > b->sequence;
+}
+
+static bool same_bucket(const BATCH_DRAW *a, const BATCH_DRAW *b)
+{
+	return a->layout == b->layout &&
+		a->vertex_array_id == b->vertex_array_id && a->mode == b->mode &&
+		a->index_type == b->index_type && a->count == b->count &&
+		a->first == b->first;
+}
+/*------------------------------------------------------------------------------
+	Points the layout's attributes at instance values from offset on
+------------------------------------------------------------------------------*/
+static void point_attributes
+(
+	const INSTANCE_LAYOUT *layout, GLuint buffer_id, GLintptr offset
+)
+{
+	const INSTANCE_UNIFORM *uniform;
+	GLintptr column_offset;
+	int index, column;
+
+	oglh_state_bind_buffer(GL_ARRAY_BUFFER, buffer_id);
+	for(index = 0; index < layout->uniforms; index++)
+	{
+		uniform = &layout->uniform[index];
+		for(column = 0; column < uniform->columns; column++)
+		{
+			column_offset = offset + uniform->offset +
+				column * uniform->components * 4;
+
+			if(uniform->integer)
+			{
+				glVertexAttribIPointer(uniform->location + column,
+					uniform->components, GL_INT, layout->stride,
+					(const void *)column_offset);
+			}
+			else
+			{
+				glVertexAttribPointer(uniform->location + column,
+					uniform->components, GL_FLOAT, GL_FALSE, layout->stride,
+					(const void *)column_offset);
+			}
+			glVertexAttribDivisor(uniform->location + column, 1);
+			glEnableVertexAttribArray(uniform->location + column);
+		}
+	}
+}
+
+static void draw_bucket
+(
+	const BATCH_DRAW *draw, GLsizei instances, GLuint base_instance
+)
+{
+	if(draw->index_type == 0)
+	{
+		if(base_instance == 0)
+			glDrawArraysInstanced(draw->mode, draw->first, draw->count,
+				instances);
+		else
+			glDrawArraysInstancedBaseInstance(draw->mode, draw->first,
+				draw->count, instances, base_instance);
+	}
+	else
+	{
+		if(base_instance == 0)
+			glDrawElementsInstanced(draw->mode, draw->count, draw->index_type,
+				(const void *)draw->first, instances);
+		else
+			glDrawElementsInstancedBaseInstance(draw->mode, draw->count,
+				draw->index_type, (const void *)draw->first, instances,
+				base_instance);
+	}
+	batch->statistics.draws++;
+}
+/*------------------------------------------------------------------------------
+	Copies the values of the draws from first up to end into the
+	allocation, in bucket order
+------------------------------------------------------------------------------*/
+static void gather_values
+(
+	const OGLH_STREAM_ALLOCATION *allocation, long first, long end
+)
+{
+	unsigned char *to = allocation->pointer;
+	long index;
+
+	for(index = first; index < end; index++)
+	{
+		memcpy(to, batch->values + batch->draw[index].values,
+			batch->draw[index].layout->stride);
+		to += batch->draw[index].layout->stride;
+	}
+	batch->statistics.bytes += to - (unsigned char *)allocation->pointer;
+}
+
+static bool create_stream(void)
+{
+	if(batch->stream_created) return true;
+
+	batch->base_instance = oglh_gl_version_or_extension(42,
+		"GL_ARB_base_instance");
+
+	batch->stream_created = oglh_stream_create(&batch->stream, GL_ARRAY_BUFFER,
+		OGLH_BATCH_STREAM_SIZE);
+	return batch->stream_created;
+}
+/*------------------------------------------------------------------------------
+	Draws everything recorded since the last flush. The program, vertex
+	array and array buffer bound before are bound again after.
+------------------------------------------------------------------------------*/
+void oglh_batch_flush(void)
+{
+	OGLH_STREAM_ALLOCATION allocation;
+	const INSTANCE_LAYOUT *pointed_layout = NULL;
+	GLuint pointed_vertex_array = 0;
+	GLintptr pointed_offset = 0, offset;
+	GLint program_id, vertex_array_id, array_buffer_id;
+	GLsizeiptr bytes = 0;
+	long index, end;
+	bool one_allocation;
+
+	OGLH_NOTE_CALL_SITE();
+	if(batch->draws == 0 || !create_stream()) return;
+
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
+	oglh_state_get_integerv(GL_VERTEX_ARRAY_BINDING, &vertex_array_id);
+	oglh_state_get_integerv(GL_ARRAY_BUFFER_BINDING, &array_buffer_id);
+
+	qsort(batch->draw, batch->draws, sizeof(BATCH_DRAW), compare_draws);
+
+	// every value in one allocation if it fits, else a bucket at a time
+	for(index = 0; index < batch->draws; index++)
+		bytes += batch->draw[index].layout->stride;
+	one_allocation = oglh_stream_allocate(&batch->stream, bytes, 0, &allocation);
+	if(one_allocation)
+	{
+		gather_values(&allocation, 0, batch->draws);
+		oglh_stream_flush(&batch->stream);
+	}
+	offset = allocation.offset;
+
+	for(index = 0; index < batch->draws; index = end)
+	{
+		const BATCH_DRAW *draw = &batch->draw[index];
+
+		for(end = index + 1; end < batch->draws &&
+			same_bucket(draw, &batch->draw[end]); end++);
+
+		if(!one_allocation)
+		{
+			if(!oglh_stream_allocate(&batch->stream,
+				(end - index) * draw->layout->stride, 0, &allocation))
+			{
+				batch->statistics.dropped += end - index;
+				continue;
+			}
+			gather_values(&allocation, index, end);
+			oglh_stream_flush(&batch->stream);
+			offset = allocation.offset;
+			pointed_layout = NULL;
+		}
+
+		oglh_state_use_program(draw->layout->program_id);
+		oglh_state_bind_vertex_array(draw->vertex_array_id);
+
+		if(!batch->base_instance || pointed_layout != draw->layout ||
+			pointed_vertex_array != draw->vertex_array_id)
+		{
+			point_attributes(draw->layout, allocation.buffer_id, offset);
+			pointed_layout = draw->layout;
+			pointed_vertex_array = draw->vertex_array_id;
+			pointed_offset = offset;
+		}
+
+		draw_bucket(draw, end - index,
+			(offset - pointed_offset) / draw->layout->stride);
+		offset += (end - index) * draw->layout->stride;
+	}
+
+	batch->draws = 0;
+	batch->values_used = 0;
+
+	oglh_state_use_program(program_id);
+	oglh_state_bind_vertex_array(vertex_array_id);
+	oglh_state_bind_buffer(GL_ARRAY_BUFFER, array_buffer_id);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Call once a frame, after the last draw
+------------------------------------------------------------------------------*/
+void oglh_batch_end_frame(void)
+{
+	OGLH_NOTE_CALL_SITE();
+	oglh_batch_flush();
+	if(batch->stream_created) oglh_stream_end_frame(&batch->stream);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_batch_shutdown(void)
+{
+	OGLH_BATCH_STATISTICS statistics = batch->statistics;
+
+	OGLH_NOTE_CALL_SITE();
+	if(batch->stream_created) oglh_stream_delete(&batch->stream);
+	free(batch->draw);
+	free(batch->values);
+	memset(batch, 0, sizeof(BATCH_CONTEXT));
+	batch->statistics = statistics;
+}
+
+void oglh_batch_get_statistics(OGLH_BATCH_STATISTICS *statistics)
+{
+	*statistics = batch->statistics;
+}
+/*------------------------------------------------------------------------------
+	Called as a program is deleted: its layout is free for another, and
+	the draws recorded with it are dropped as there's nothing left to draw
+	them with
+------------------------------------------------------------------------------*/
+void oglh_instancing_forget_program(GLuint program_id)
+{
+	INSTANCE_LAYOUT *layout = NULL;
+	long index, kept = 0;
+
+	for(index = 0; program_id != 0 && index < batch->layouts; index++)
+	{
+		if(batch->layout[index].program_id == program_id)
+			layout = &batch->layout[index];
+	}
+	if(layout == NULL) return;
+
+	for(index = 0; index < batch->draws; index++)
+	{
+		if(batch->draw[index].layout == layout) continue;
+		batch->draw[kept] = batch->draw[index];
+		batch->draw[kept].sequence = kept;
+		kept++;
+	}
+	batch->statistics.dropped += batch->draws - kept;
+	batch->draws = kept;
+	memset(layout, 0, sizeof(*layout));
+}
+/*------------------------------------------------------------------------------
+	The batcher as a part of an oglh context, see OpenGL_context.h. The
+	part goes without GL calls, so its stream is left to
+	oglh_batch_shutdown.
+------------------------------------------------------------------------------*/
+void *oglh_instancing_new_context(void)
+{
+	return calloc(1, sizeof(BATCH_CONTEXT));
+}
+
+void oglh_instancing_use_context(void *part)
+{
+	batch = part != NULL ? part : &default_batch;
+}
+
+void oglh_instancing_delete_context(void *part)
+{
+	if(part == NULL) return;
+
+	if(part == batch) batch = &default_batch;
+	free(((BATCH_CONTEXT *)part)->draw);
+	free(((BATCH_CONTEXT *)part)->values);
+	free(part);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
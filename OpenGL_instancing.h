@@ -0,0 +1,102 @@
+/*------------------------------------------------------------------------------
+	oglh_ instancing -- per-object uniforms batched into instanced draws
+
+	The usual loop sets a uniform or two then draws, object by object:
+
+	for(i = 0; i < objects; i++)
+	{
+		oglh_set_uniform_variable("model", GL_FLOAT_MAT4, object[i].model);
+		oglh_draw_elements(GL_TRIANGLES, rock.count, GL_UNSIGNED_INT, 0);
+	}
+
+	Declare which uniforms vary per object when the shader is installed and
+	the same loop becomes a batch:
+
+	const char *names[] = { "model", "tint" };
+	GLenum types[] = { GL_FLOAT_MAT4, GL_FLOAT_VEC4 };
+	GLuint program = oglh_install_instanced_shader("rocks", 2, names, types);
+	...
+	for(i = 0; i < objects; i++)
+	{
+		oglh_batch_uniform("model", GL_FLOAT_MAT4, object[i].model);
+		oglh_batch_uniform("tint", GL_FLOAT_VEC4, object[i].tint);
+		oglh_batch_draw_elements(GL_TRIANGLES, rock.count, GL_UNSIGNED_INT, 0);
+	}
+	oglh_batch_flush();			// before anything that reads what was drawn
+	...
+	oglh_batch_end_frame();
+
+	The shader keeps its uniform declarations. As the vertex shader is
+	loaded each "uniform mat4 model;" is rewritten to
+	"layout(location = 8) in mat4 model;", an instanced vertex attribute
+	from OGLH_INSTANCE_ATTRIBUTE_FIRST up. Per-instance values are only
+	visible to the vertex shader -- pass them on as flat outputs if the
+	fragment shader needs them.
+
+	Draws are recorded, not made. oglh_batch_flush sorts them by program,
+	vertex array and the range drawn, writes each bucket's values to a
+	streaming buffer (OpenGL_stream.h) and makes one glDrawArraysInstanced
+	or glDrawElementsInstanced per bucket. So:
+
+	-	the order draws are made in isn't kept between buckets, batch
+		opaque geometry and flush before anything that depends on order
+	-	a uniform that isn't declared per-instance is shared by the whole
+		batch; setting one with oglh_batch_uniform flushes first
+	-	the attribute locations from OGLH_INSTANCE_ATTRIBUTE_FIRST belong
+		to the batcher in any vertex array drawn through it
+
+	Supported types are float, vec2-4, int, ivec2-4 and mat4. A mat4 is
+	given row first, as to oglh_set_uniform_variable.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_INSTANCE_ATTRIBUTE_FIRST	8	// locations below are the mesh's
+#define OGLH_MAX_INSTANCE_UNIFORMS		8	// per program
+#define OGLH_MAX_INSTANCED_PROGRAMS		16
+#define OGLH_BATCH_STREAM_SIZE			(4 * 1024 * 1024)	// bytes a frame
+
+typedef struct oglh_batch_statistics
+{
+	long objects;			// oglh_batch_draw_* calls
+	long draws;				// instanced draws made for them
+	long bytes;				// per-instance values written
+	long dropped;			// objects that didn't fit in the stream
+}
+OGLH_BATCH_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+GLuint oglh_install_instanced_shader
+(
+	const char *shader_name, int count, const char *uniform_names[],
+	const GLenum uniform_types[]
+);
+
+void oglh_batch_uniform(const char *variable_name, int type, void *data);
+void oglh_batch_draw_arrays(GLenum mode, GLint first, GLsizei count);
+void oglh_batch_draw_elements
+(
+	GLenum mode, GLsizei count, GLenum type, GLintptr offset
+);
+void oglh_batch_flush(void);
+void oglh_batch_end_frame(void);
+void oglh_batch_shutdown(void);
+void oglh_batch_get_statistics(OGLH_BATCH_STATISTICS *statistics);
+
+// for the shader loader
+bool oglh_instancing_rewrite_source
+(
+	const char *shader_name, GLenum shader_type, char *source, size_t size
+);
+void oglh_instancing_forget_program(GLuint program_id);	// for the registry
+
+// for OpenGL_context.c
+void *oglh_instancing_new_context(void);
+void oglh_instancing_use_context(void *part);
+void oglh_instancing_delete_context(void *part);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,460 @@
+/*------------------------------------------------------------------------------
+	oglh_ math -- the matrix and vector arithmetic that goes with the
+	vec2, vec3, vec4 and mat4 types
+
+	Everything vectorised is written with the V4 operations below, a
+	vector of four floats, so a new instruction set is one more block of
+	definitions. With rows in memory, m * v is the sum of m's columns
+	each scaled by a component of v; the batch transforms transpose once
+	and then do just that. A product a * b is, row by row, the rows of b
+	scaled by that row of a.
+
+	The general inverse is scalar, by cofactors -- it is needed a handful
+	of times a frame, not a handful of thousand.
+------------------------------------------------------------------------------*/
+#include "OpenGL_math.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+	V4 -- four floats, loaded and stored unaligned
+------------------------------------------------------------------------------*/
+#if !defined(OGLH_MATH_SCALAR) && defined(__SSE__)
+
+#include <immintrin.h>		//	x86 SIMD intrinsics
+
+#define MATH_SSE
+typedef __m128 V4;
+
+#define v4_load(p)				_mm_loadu_ps(p)
+#define v4_store(p, a)			_mm_storeu_ps(p, a)
+#define v4_splat(s)				_mm_set1_ps(s)
+#define v4_add(a, b)			_mm_add_ps(a, b)
+#define v4_mul(a, b)			_mm_mul_ps(a, b)
+#ifdef __FMA__
+#define v4_madd(a, b, c)		_mm_fmadd_ps(a, b, c)		// a * b + c
+#else
+#define v4_madd(a, b, c)		_mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+
+#elif !defined(OGLH_MATH_SCALAR) && defined(__ARM_NEON)
+
+#include <arm_neon.h>		//	ARM SIMD intrinsics
+
+#define MATH_NEON
+typedef float32x4_t V4;
+
+#define v4_load(p)				vld1q_f32(p)
+#define v4_store(p, a)			vst1q_f32(p, a)
+#define v4_splat(s)				vdupq_n_f32(s)
+#define v4_add(a, b)			vaddq_f32(a, b)
+#define v4_mul(a, b)			vmulq_f32(a, b)
+#define v4_madd(a, b, c)		vmlaq_f32(c, a, b)
+
+#else
+
+#define MATH_SCALAR
+typedef struct { float f[4]; } V4;
+
+static inline V4 v4_load(const float *p)
+{
+	V4 r = {{ p[0], p[1], p[2], p[3] }};
+	return r;
+}
+static inline void v4_store(float *p, V4 a)
+{
+	p[0] = a.f[0]; p[1] = a.f[1]; p[2] = a.f[2]; p[3] = a.f[3];
+}
+static inline V4 v4_splat(float s)
+{
+	V4 r = {{ s, s, s, s }};
+	return r;
+}
+static inline V4 v4_add(V4 a, V4 b)
+{
+	V4 r = {{ a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3] }};
+	return r;
+}
+static inline V4 v4_mul(V4 a, V4 b)
+{
+	V4 r = {{ a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3] }};
+	return r;
+}
+static inline V4 v4_madd(V4 a, V4 b, V4 c)
+{
+	return v4_add(v4_mul(a, b), c);
+}
+
+#endif
+/*------------------------------------------------------------------------------
+	column[c] is column c of m, a V4 for each
+------------------------------------------------------------------------------*/
+static void load_columns(V4 column[4], const float m[16])
+{
+	float t[16];
+
+	oglh_mat4_transpose(t, m);
+	column[0] = v4_load(t + 0);
+	column[1] = v4_load(t + 4);
+	column[2] = v4_load(t + 8);
+	column[3] = v4_load(t + 12);
+}
+
+static inline V4 transform(const V4 column[4], float x, float y, float z,
+	float w)
+{
+	return v4_madd(column[0], v4_splat(x),
+		v4_madd(column[1], v4_splat(y),
+		v4_madd(column[2], v4_splat(z),
+		v4_mul(column[3], v4_splat(w)))));
+}
+/*------------------------------------------------------------------------------
+	Vectors
+------------------------------------------------------------------------------*/
+float oglh_vec3_dot(const vec3 a, const vec3 b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+float oglh_vec3_length(const vec3 v)
+{
+	return sqrtf(oglh_vec3_dot(v, v));
+}
+
+void oglh_vec3_cross(vec3 out, const vec3 a, const vec3 b)
+{
+	float x = a[1] * b[2] - a[2] * b[1];
+	float y = a[2] * b[0] - a[0] * b[2];
+	float z = a[0] * b[1] - a[1] * b[0];
+
+	out[0] = x;
+	out[1] = y;
+	out[2] = z;
+}
+
+bool oglh_vec3_normalize(vec3 out, const vec3 v)
+{
+	float length = oglh_vec3_length(v);
+
+	if(length == 0.0f) return false;
+	out[0] = v[0] / length;
+	out[1] = v[1] / length;
+	out[2] = v[2] / length;
+	return true;
+}
+
+float oglh_vec4_dot(const vec4 a, const vec4 b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+/*------------------------------------------------------------------------------
+	Matrices
+------------------------------------------------------------------------------*/
+void oglh_mat4_identity(mat4 out)
+{
+	static const float identity[16] =
+	{
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	};
+
+	memcpy(out, identity, sizeof(identity));
+}
+
+void oglh_mat4_copy(mat4 out, const float m[16])
+{
+	memmove(out, m, 16 * sizeof(float));
+}
+
+void oglh_mat4_multiply(mat4 out, const float a[16], const float b[16])
+{
+	V4 row[4], product[4];
+	int r;
+
+	row[0] = v4_load(b + 0);
+	row[1] = v4_load(b + 4);
+	row[2] = v4_load(b + 8);
+	row[3] = v4_load(b + 12);
+
+	for(r = 0; r < 4; r++)
+	{
+		product[r] = transform(row, a[4 * r + 0], a[4 * r + 1],
+			a[4 * r + 2], a[4 * r + 3]);
+	}
+	// stored only now that a and b have been read
+	for(r = 0; r < 4; r++) v4_store(out + 4 * r, product[r]);
+}
+
+void oglh_mat4_transpose(mat4 out, const float m[16])
+{
+#if defined(MATH_SSE)
+	V4 r0 = v4_load(m + 0), r1 = v4_load(m + 4);
+	V4 r2 = v4_load(m + 8), r3 = v4_load(m + 12);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	v4_store(out + 0, r0);
+	v4_store(out + 4, r1);
+	v4_store(out + 8, r2);
+	v4_store(out + 12, r3);
+#elif defined(MATH_NEON)
+	float32x4x4_t columns = vld4q_f32(m);	// de-interleaved, a column each
+
+	v4_store(out + 0, columns.val[0]);
+	v4_store(out + 4, columns.val[1]);
+	v4_store(out + 8, columns.val[2]);
+	v4_store(out + 12, columns.val[3]);
+#else
+	float t[16];
+	int r, c;
+
+	for(r = 0; r < 4; r++)
+		for(c = 0; c < 4; c++)
+			t[4 * c + r] = m[4 * r + c];
+	memcpy(out, t, sizeof(t));
+#endif
+}
+/*------------------------------------------------------------------------------
+	The adjugate over the determinant, the cofactors a pair of rows at a
+	time
+------------------------------------------------------------------------------*/
+bool oglh_mat4_inverse(mat4 out, const float m[16])
+{
+	float s0, s1, s2, s3, s4, s5, c0, c1, c2, c3, c4, c5;
+	float determinant, inverse[16];
+	int index;
+
+	s0 = m[0] * m[5] - m[4] * m[1];
+	s1 = m[0] * m[6] - m[4] * m[2];
+	s2 = m[0] * m[7] - m[4] * m[3];
+	s3 = m[1] * m[6] - m[5] * m[2];
+	s4 = m[1] * m[7] - m[5] * m[3];
+	s5 = m[2] * m[7] - m[6] * m[3];
+
+	c5 = m[10] * m[15] - m[14] * m[11];
+	c4 = m[9] * m[15] - m[13] * m[11];
+	c3 = m[9] * m[14] - m[13] * m[10];
+	c2 = m[8] * m[15] - m[12] * m[11];
+	c1 = m[8] * m[14] - m[12] * m[10];
+	c0 = m[8] * m[13] - m[12] * m[9];
+
+	determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if(determinant == 0.0f) return false;
+
+	inverse[0] = m[5] * c5 - m[6] * c4 + m[7] * c3;
+	inverse[1] = -m[1] * c5 + m[2] * c4 - m[3] * c3;
+	inverse[2] = m[13] * s5 - m[14] * s4 + m[15] * s3;
+	inverse[3] = -m[9] * s5 + m[10] * s4 - m[11] * s3;
+
+	inverse[4] = -m[4] * c5 + m[6] * c2 - m[7] * c1;
+	inverse[5] = m[0] * c5 - m[2] * c2 + m[3] * c1;
+	inverse[6] = -m[12] * s5 + m[14] * s2 - m[15] * s1;
+	inverse[7] = m[8] * s5 - m[10] * s2 + m[11] * s1;
+
+	inverse[8] = m[4] * c4 - m[5] * c2 + m[7] * c0;
+	inverse[9] = -m[0] * c4 + m[1] * c2 - m[3] * c0;
+	inverse[10] = m[12] * s4 - m[13] * s2 + m[15] * s0;
+	inverse[11] = -m[8] * s4 + m[9] * s2 - m[11] * s0;
+
+	inverse[12] = -m[4] * c3 + m[5] * c1 - m[6] * c0;
+	inverse[13] = m[0] * c3 - m[1] * c1 + m[2] * c0;
+	inverse[14] = -m[12] * s3 + m[13] * s1 - m[14] * s0;
+	inverse[15] = m[8] * s3 - m[9] * s1 + m[10] * s0;
+
+	for(index = 0; index < 16; index++)
+		out[index] = inverse[index] / determinant;
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_mat4_translation(mat4 out, float x, float y, float z)
+{
+	oglh_mat4_identity(out);
+	out[3] = x;
+	out[7] = y;
+	out[11] = z;
+}
+
+void oglh_mat4_scaling(mat4 out, float x, float y, float z)
+{
+	oglh_mat4_identity(out);
+	out[0] = x;
+	out[5] = y;
+	out[10] = z;
+}
+
+void oglh_mat4_rotation(mat4 out, float radians, const vec3 axis)
+{
+	vec3 a;
+	float c = cosf(radians), s = sinf(radians), t = 1.0f - c;
+
+	oglh_mat4_identity(out);
+	if(!oglh_vec3_normalize(a, axis)) return;
+
+	out[0] = t * a[0] * a[0] + c;
+	out[1] = t * a[0] * a[1] - s * a[2];
+	out[2] = t * a[0] * a[2] + s * a[1];
+
+	out[4] = t * a[0] * a[1] + s * a[2];
+	out[5] = t * a[1] * a[1] + c;
+	out[6] = t * a[1] * a[2] - s * a[0];
+
+	out[8] = t * a[0] * a[2] - s * a[1];
+	out[9] = t * a[1] * a[2] + s * a[0];
+	out[10] = t * a[2] * a[2] + c;
+}
+/*------------------------------------------------------------------------------
+	As gluLookAt, gluPerspective and glOrtho made them
+------------------------------------------------------------------------------*/
+void oglh_mat4_look_at
+(
+	mat4 out, const vec3 eye, const vec3 centre, const vec3 up
+)
+{
+	vec3 forward, side, upward;
+
+	forward[0] = centre[0] - eye[0];
+	forward[1] = centre[1] - eye[1];
+	forward[2] = centre[2] - eye[2];
+	oglh_vec3_normalize(forward, forward);
+	oglh_vec3_cross(side, forward, up);
+	oglh_vec3_normalize(side, side);
+	oglh_vec3_cross(upward, side, forward);
+
+	oglh_mat4_identity(out);
+	out[0] = side[0];
+	out[1] = side[1];
+	out[2] = side[2];
+	out[3] = -oglh_vec3_dot(side, eye);
+
+	out[4] = upward[0];
+	out[5] = upward[1];
+	out[6] = upward[2];
+	out[7] = -oglh_vec3_dot(upward, eye);
+
+	out[8] = -forward[0];
+	out[9] = -forward[1];
+	out[10] = -forward[2];
+	out[11] = oglh_vec3_dot(forward, eye);
+}
+
+void oglh_mat4_perspective
+(
+	mat4 out, float fovy, float aspect, float near_plane, float far_plane
+)
+{
+	float f = 1.0f / tanf(fovy / 2.0f);
+
+	memset(out, 0, 16 * sizeof(float));
+	out[0] = f / aspect;
+	out[5] = f;
+	out[10] = (far_plane + near_plane) / (near_plane - far_plane);
+	out[11] = 2.0f * far_plane * near_plane / (near_plane - far_plane);
+	out[14] = -1.0f;
+}
+
+void oglh_mat4_ortho
+(
+	mat4 out, float left, float right, float bottom, float top,
+	float near_plane, float far_plane
+)
+{
+	oglh_mat4_identity(out);
+	out[0] = 2.0f / (right - left);
+	out[3] = -(right + left) / (right - left);
+	out[5] = 2.0f / (top - bottom);
+	out[7] = -(top + bottom) / (top - bottom);
+	out[10] = -2.0f / (far_plane - near_plane);
+	out[11] = -(far_plane + near_plane) / (far_plane - near_plane);
+}
+/*------------------------------------------------------------------------------
+	Transforms
+------------------------------------------------------------------------------*/
+void oglh_mat4_transform_vec4(vec4 out, const float m[16], const vec4 v)
+{
+	V4 column[4];
+
+	load_columns(column, m);
+	v4_store(out, transform(column, v[0], v[1], v[2], v[3]));
+}
+/*------------------------------------------------------------------------------
+	With AVX two vectors go at once, each 128 bit lane of a 256 bit
+	register doing what a V4 would
+------------------------------------------------------------------------------*/
+void oglh_mat4_transform_vec4_array
+(
+	vec4 *out, const float m[16], const vec4 *in, int count
+)
+{
+	V4 column[4];
+	int index = 0;
+#if defined(MATH_SSE) && defined(__AVX__)
+	float t[16];
+	__m256 column2[4], pair, sum;
+	int c;
+
+	oglh_mat4_transpose(t, m);
+	for(c = 0; c < 4; c++) column2[c] = _mm256_broadcast_ps((__m128 *)(t + 4 * c));
+
+	for(; index + 2 <= count; index += 2)
+	{
+		pair = _mm256_loadu_ps(in[index]);
+		sum = _mm256_mul_ps(column2[0], _mm256_permute_ps(pair, 0x00));
+		sum = _mm256_add_ps(sum,
+			_mm256_mul_ps(column2[1], _mm256_permute_ps(pair, 0x55)));
+		sum = _mm256_add_ps(sum,
+			_mm256_mul_ps(column2[2], _mm256_permute_ps(pair, 0xaa)));
+		sum = _mm256_add_ps(sum,
+			_mm256_mul_ps(column2[3], _mm256_permute_ps(pair, 0xff)));
+		_mm256_storeu_ps(out[index], sum);
+	}
+#endif
+
+	load_columns(column, m);
+	for(; index < count; index++)
+	{
+		v4_store(out[index], transform(column, in[index][0], in[index][1],
+			in[index][2], in[index][3]));
+	}
+}
+
+void oglh_mat4_transform_vec3_array
+(
+	vec3 *out, const float m[16], const vec3 *in, int count, float w
+)
+{
+	V4 column[4], translation;
+	float result[4];
+	int index;
+
+	load_columns(column, m);
+	translation = v4_mul(column[3], v4_splat(w));
+	for(index = 0; index < count; index++)
+	{
+		// a vec3 is three floats, so no loading or storing four at once
+		v4_store(result, v4_madd(column[0], v4_splat(in[index][0]),
+			v4_madd(column[1], v4_splat(in[index][1]),
+			v4_madd(column[2], v4_splat(in[index][2]), translation))));
+		out[index][0] = result[0];
+		out[index][1] = result[1];
+		out[index][2] = result[2];
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+const char *oglh_math_instruction_set(void)
+{
+#if defined(MATH_SSE) && defined(__AVX__)
+	return "AVX";
+#elif defined(MATH_SSE)
+	return "SSE";
+#elif defined(MATH_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,85 @@
+/*------------------------------------------------------------------------------
+	oglh_ math -- the matrix and vector arithmetic that goes with the
+	vec2, vec3, vec4 and mat4 types
+
+	Matrices are sixteen floats a row at a time, the order
+	oglh_set_uniform_variable takes for GL_FLOAT_MAT4 -- it hands them to
+	glUniformMatrix4fv with transpose set -- so what is built here can be
+	set as it is:
+
+	OGLH_MATRIX projection, view, model, mvp;
+	oglh_mat4_perspective(projection, M_PI / 3, 16.0f / 9.0f, 0.1f, 100.0f);
+	oglh_mat4_look_at(view, eye, centre, up);
+	oglh_mat4_translation(model, 0, 1, -5);
+	oglh_mat4_multiply(mvp, projection, view);
+	oglh_mat4_multiply(mvp, mvp, model);
+	oglh_set_uniform_variable("mvp", GL_FLOAT_MAT4, mvp);
+
+	The point ends up at mvp * v, as in GLSL, so matrices compose right to
+	left. Outputs may be the same matrix as an input.
+
+	OGLH_MATRIX is a mat4's storage, aligned so that no matrix straddles a
+	cache line; any sixteen floats will do, aligned or not.
+
+	The arithmetic is done four floats at a time with SSE on x86 (AVX too
+	for the batch transforms when the compiler is allowed it, -mavx) and
+	NEON on ARM, all through one small set of vector operations in
+	OpenGL_math.c. Build with OGLH_MATH_SCALAR for plain C everywhere.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef float OGLH_MATRIX[16] __attribute__((aligned(64)));
+/*------------------------------------------------------------------------------
+	Vectors
+------------------------------------------------------------------------------*/
+float oglh_vec3_dot(const vec3 a, const vec3 b);
+float oglh_vec3_length(const vec3 v);
+void oglh_vec3_cross(vec3 out, const vec3 a, const vec3 b);
+bool oglh_vec3_normalize(vec3 out, const vec3 v);	// false if it's zero
+float oglh_vec4_dot(const vec4 a, const vec4 b);
+/*------------------------------------------------------------------------------
+	Matrices
+------------------------------------------------------------------------------*/
+void oglh_mat4_identity(mat4 out);
+void oglh_mat4_copy(mat4 out, const float m[16]);
+void oglh_mat4_multiply(mat4 out, const float a[16], const float b[16]);
+void oglh_mat4_transpose(mat4 out, const float m[16]);
+bool oglh_mat4_inverse(mat4 out, const float m[16]);	// false if singular
+
+void oglh_mat4_translation(mat4 out, float x, float y, float z);
+void oglh_mat4_scaling(mat4 out, float x, float y, float z);
+void oglh_mat4_rotation(mat4 out, float radians, const vec3 axis);
+
+void oglh_mat4_look_at
+(
+	mat4 out, const vec3 eye, const vec3 centre, const vec3 up
+);
+void oglh_mat4_perspective		// fovy in radians, depth -1 .. 1 as GL has it
+(
+	mat4 out, float fovy, float aspect, float near_plane, float far_plane
+);
+void oglh_mat4_ortho
+(
+	mat4 out, float left, float right, float bottom, float top,
+	float near_plane, float far_plane
+);
+/*------------------------------------------------------------------------------
+	Transforms, out may be in
+------------------------------------------------------------------------------*/
+void oglh_mat4_transform_vec4(vec4 out, const float m[16], const vec4 v);
+void oglh_mat4_transform_vec4_array
+(
+	vec4 *out, const float m[16], const vec4 *in, int count
+);
+void oglh_mat4_transform_vec3_array	// w is 1 for points, 0 for directions
+(
+	vec3 *out, const float m[16], const vec3 *in, int count, float w
+);
+
+const char *oglh_math_instruction_set(void);	// "SSE", "AVX", "NEON", "scalar"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,368 @@
+/*------------------------------------------------------------------------------
+	oglh_ meshes -- a binary mesh file mapped and handed straight to GL
+
+	The mapping is read once, front to back, by the driver's copy into the
+	buffers, so the kernel is told to read ahead and the mapping is gone
+	as soon as the buffers have been made.
+------------------------------------------------------------------------------*/
+#include "OpenGL_mesh.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+#include <fcntl.h>			//	open
+#include <sys/mman.h>		//	mmap
+#include <sys/stat.h>		//	fstat
+#include <unistd.h>			//	close
+/*------------------------------------------------------------------------------
+	Everything the header says is inside the file and makes sense
+------------------------------------------------------------------------------*/
+static int index_bytes(GLenum index_type)
+{
+	switch(index_type)
+	{
+		case GL_UNSIGNED_SHORT:	return 2;
+		case GL_UNSIGNED_INT:	return 4;
+		default:				return 0;
+	}
+}
+
+// a whole attribute, 0 for a type the vertex array can't take
+static uint32_t attribute_bytes(const OGLH_MESH_ATTRIBUTE *attribute)
+{
+	switch(attribute->type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:					return attribute->components;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:						return attribute->components * 2;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:							return attribute->components * 4;
+		case GL_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:	return 4;	// all four packed
+		default:								return 0;
+	}
+}
+
+static bool check_header
+(
+	const char *file_name, const unsigned char *mapping, uint64_t file_bytes
+)
+{
+	const OGLH_MESH_HEADER *header = (const OGLH_MESH_HEADER *)mapping;
+	const OGLH_MESH_SUBMESH *submesh;
+	const OGLH_MESH_ATTRIBUTE *attribute;
+	uint64_t submesh_end;
+	uint32_t index;
+	const char *problem = NULL;
+
+	if(file_bytes < sizeof(OGLH_MESH_HEADER) ||
+		memcmp(header->magic, OGLH_MESH_MAGIC, 8) != 0)
+	{
+		problem = "isn't a mesh file";
+	}
+	else if(header->header_bytes != sizeof(OGLH_MESH_HEADER))
+	{
+		problem = "was written by another version";
+	}
+	else if(header->attribute_count == 0 ||
+		header->attribute_count > OGLH_MESH_MAX_ATTRIBUTES ||
+		header->vertex_stride == 0 || index_bytes(header->index_type) == 0)
+	{
+		problem = "has a bad vertex layout or index type";
+	}
+
+	// counts are divided into what is left, a multiplication could overflow
+	if(problem == NULL)
+	{
+		submesh_end = sizeof(OGLH_MESH_HEADER) +
+			(uint64_t)header->submesh_count * sizeof(OGLH_MESH_SUBMESH);
+
+		if(submesh_end > file_bytes ||
+			header->vertex_offset > file_bytes ||
+			header->vertex_count >
+				(file_bytes - header->vertex_offset) / header->vertex_stride ||
+			header->index_offset > file_bytes ||
+			header->index_count > (file_bytes - header->index_offset) /
+				index_bytes(header->index_type))
+		{
+			problem = "is shorter than its header says";
+		}
+	}
+
+	for(index = 0; problem == NULL && index < header->attribute_count; index++)
+	{
+		attribute = &header->attribute[index];
+		if(attribute->components < 1 || attribute->components > 4 ||
+			attribute_bytes(attribute) == 0 ||
+			attribute->offset > header->vertex_stride ||
+			attribute_bytes(attribute) > header->vertex_stride - attribute->offset)
+		{
+			problem = "has a bad vertex attribute";
+		}
+	}
+
+	submesh = (const OGLH_MESH_SUBMESH *)(mapping + sizeof(OGLH_MESH_HEADER));
+	for(index = 0; problem == NULL && index < header->submesh_count; index++)
+	{
+		if((uint64_t)submesh[index].first_index + submesh[index].index_count >
+			header->index_count)
+		{
+			problem = "has a submesh past the end of its indices";
+		}
+	}
+
+	if(problem != NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"%s %s", file_name, problem);
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	A buffer that glBufferData couldn't allocate keeps its old size, zero
+	for a new one
+------------------------------------------------------------------------------*/
+static bool buffer_allocated(GLenum target, GLsizeiptr size)
+{
+	GLint64 allocated = 0;
+
+	glGetBufferParameteri64v(target, GL_BUFFER_SIZE, &allocated);
+	return allocated == size;
+}
+/*------------------------------------------------------------------------------
+	Vertex array and both buffers made through the helpers, filled from the
+	mapping; false if either buffer is short of memory on the GPU
+------------------------------------------------------------------------------*/
+static bool upload(OGLH_MESH *mesh, const char *file_name,
+	const unsigned char *mapping)
+{
+	const OGLH_MESH_HEADER *header = (const OGLH_MESH_HEADER *)mapping;
+	const OGLH_MESH_ATTRIBUTE *attribute;
+	GLsizeiptr vertex_bytes, index_size;
+	uint32_t index;
+	bool allocated;
+
+	vertex_bytes = header->vertex_count * header->vertex_stride;
+	index_size = header->index_count * index_bytes(header->index_type);
+
+	oglh_generate_and_bind_opengl_object(GL_VERTEX_ARRAY,
+		&mesh->vertex_array_id);
+	oglh_registry_set_label(OGLH_OBJECT_VERTEX_ARRAY, mesh->vertex_array_id,
+		file_name);
+
+	oglh_generate_and_bind_opengl_object(GL_ARRAY_BUFFER,
+		&mesh->vertex_buffer_id);
+	glBufferData(GL_ARRAY_BUFFER, vertex_bytes, mapping + header->vertex_offset,
+		GL_STATIC_DRAW);
+	allocated = buffer_allocated(GL_ARRAY_BUFFER, vertex_bytes);
+	oglh_registry_set_label(OGLH_OBJECT_BUFFER, mesh->vertex_buffer_id,
+		file_name);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, mesh->vertex_buffer_id,
+		vertex_bytes);
+
+	oglh_generate_and_bind_opengl_object(GL_ELEMENT_ARRAY_BUFFER,
+		&mesh->index_buffer_id);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size,
+		mapping + header->index_offset, GL_STATIC_DRAW);
+	allocated = buffer_allocated(GL_ELEMENT_ARRAY_BUFFER, index_size) &&
+		allocated;
+	oglh_registry_set_label(OGLH_OBJECT_BUFFER, mesh->index_buffer_id,
+		file_name);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, mesh->index_buffer_id,
+		index_size);
+
+	for(index = 0; index < header->attribute_count; index++)
+	{
+		attribute = &header->attribute[index];
+		switch(attribute->type)
+		{
+			case GL_FLOAT:
+			case GL_HALF_FLOAT:
+			case GL_INT_2_10_10_10_REV:
+			case GL_UNSIGNED_INT_2_10_10_10_REV:
+				glVertexAttribPointer(attribute->location,
+					attribute->components, attribute->type,
+					attribute->normalized ? GL_TRUE : GL_FALSE,
+					header->vertex_stride,
+					(const void *)(uintptr_t)attribute->offset);
+			break;
+
+			default:	// integer types stay integers unless normalized
+				if(attribute->normalized)
+				{
+					glVertexAttribPointer(attribute->location,
+						attribute->components, attribute->type, GL_TRUE,
+						header->vertex_stride,
+						(const void *)(uintptr_t)attribute->offset);
+				}
+				else
+				{
+					glVertexAttribIPointer(attribute->location,
+						attribute->components, attribute->type,
+						header->vertex_stride,
+						(const void *)(uintptr_t)attribute->offset);
+				}
+			break;
+		}
+		glEnableVertexAttribArray(attribute->location);
+	}
+
+	return allocated;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_mesh_load(OGLH_MESH *mesh, const char *file_name)
+{
+	const OGLH_MESH_HEADER *header;
+	const OGLH_MESH_SUBMESH *submesh;
+	unsigned char *mapping;
+	struct stat file_status;
+	int file_descriptor, index;
+	bool loaded;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(mesh, 0, sizeof(*mesh));
+
+	if((file_descriptor = open(file_name, O_RDONLY)) < 0)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't open mesh %s", file_name);
+		return false;
+	}
+	if(fstat(file_descriptor, &file_status) != 0 || file_status.st_size == 0)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"mesh %s is empty", file_name);
+		close(file_descriptor);
+		return false;
+	}
+
+	mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE,
+		file_descriptor, 0);
+	close(file_descriptor);
+	if(mapping == MAP_FAILED)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't map mesh %s", file_name);
+		return false;
+	}
+	madvise(mapping, file_status.st_size, MADV_SEQUENTIAL);
+	madvise(mapping, file_status.st_size, MADV_WILLNEED);
+
+	if(!check_header(file_name, mapping, file_status.st_size))
+	{
+		munmap(mapping, file_status.st_size);
+		return false;
+	}
+
+	header = (const OGLH_MESH_HEADER *)mapping;
+	submesh = (const OGLH_MESH_SUBMESH *)(mapping + sizeof(OGLH_MESH_HEADER));
+
+	mesh->index_type = header->index_type;
+	mesh->vertex_count = header->vertex_count;
+	mesh->index_count = header->index_count;
+	memcpy(mesh->bounds_min, header->bounds_min, sizeof(mesh->bounds_min));
+	memcpy(mesh->bounds_max, header->bounds_max, sizeof(mesh->bounds_max));
+	mesh->submeshes = header->submesh_count;
+	mesh->one_draw = true;
+	if(mesh->submeshes > 0 && (mesh->submesh =
+		malloc(mesh->submeshes * sizeof(OGLH_MESH_SUBMESH))) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for the submeshes of %s", file_name);
+		munmap(mapping, file_status.st_size);
+		return false;
+	}
+	for(index = 0; index < mesh->submeshes; index++)
+	{
+		mesh->submesh[index] = submesh[index];
+		mesh->submesh[index].name[OGLH_MESH_NAME_SIZE - 1] = '\0';
+		if(submesh[index].base_vertex != 0) mesh->one_draw = false;
+	}
+
+	loaded = upload(mesh, file_name, mapping);
+	munmap(mapping, file_status.st_size);
+
+	if(!loaded)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no memory on the GPU for mesh %s", file_name);
+		oglh_mesh_delete(mesh);
+		return false;
+	}
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Leaves the mesh's vertex array bound
+------------------------------------------------------------------------------*/
+void oglh_mesh_draw(const OGLH_MESH *mesh, int submesh)
+{
+	const OGLH_MESH_SUBMESH *part;
+	int index, first, last, size = index_bytes(mesh->index_type);
+
+	OGLH_NOTE_CALL_SITE();
+	if(submesh >= mesh->submeshes)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"the mesh has no submesh %d", submesh);
+		return;
+	}
+
+	oglh_state_bind_vertex_array(mesh->vertex_array_id);
+	if(submesh < 0 && (mesh->one_draw || mesh->submeshes == 0))
+	{
+		oglh_draw_elements(GL_TRIANGLES, mesh->index_count, mesh->index_type, 0);
+		return;
+	}
+
+	first = submesh < 0 ? 0 : submesh;
+	last = submesh < 0 ? mesh->submeshes - 1 : submesh;
+	for(index = first; index <= last; index++)
+	{
+		part = &mesh->submesh[index];
+		if(part->base_vertex == 0)
+		{
+			oglh_draw_elements(GL_TRIANGLES, part->index_count,
+				mesh->index_type, (GLintptr)part->first_index * size);
+		}
+		else
+		{
+			glDrawElementsBaseVertex(GL_TRIANGLES, part->index_count,
+				mesh->index_type,
+				(const void *)((uintptr_t)part->first_index * size),
+				part->base_vertex);
+		}
+	}
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+int oglh_mesh_find_submesh(const OGLH_MESH *mesh, const char *name)
+{
+	int index;
+
+	for(index = 0; index < mesh->submeshes; index++)
+		if(strcmp(mesh->submesh[index].name, name) == 0) return index;
+	return -1;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_mesh_delete(OGLH_MESH *mesh)
+{
+	OGLH_NOTE_CALL_SITE();
+	oglh_registry_delete(OGLH_OBJECT_VERTEX_ARRAY, mesh->vertex_array_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, mesh->vertex_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, mesh->index_buffer_id);
+	free(mesh->submesh);
+	memset(mesh, 0, sizeof(*mesh));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
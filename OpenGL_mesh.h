@@ -0,0 +1,95 @@
+/*------------------------------------------------------------------------------
+	oglh_ meshes -- a binary mesh file mapped and handed straight to GL
+
+	A .mesh file is laid out as the buffers it becomes: a header saying how
+	the vertex attributes sit in a vertex and which index type there is,
+	a table of submeshes, then the vertices and the indices exactly as
+	glBufferData wants them. Loading maps the file and passes the mapping
+	to GL -- nothing is parsed, converted or copied on the way -- so a load
+	takes as long as the disk takes to read it.
+
+	OGLH_MESH rock;
+	if(oglh_mesh_load(&rock, "rock.mesh"))
+	{
+		...
+		oglh_mesh_draw(&rock, -1);			// every submesh
+	}
+	oglh_mesh_delete(&rock);
+
+	The vertex array is set up from the header, attribute i at the location
+	it was written with; tools/oglh_obj2mesh.c writes position at 0, normal
+	at 1 and texture coordinate at 2. Files are little-endian, as the
+	machines that run the helpers are.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+#include <stdint.h>			//	Fixed-width integer types
+/*------------------------------------------------------------------------------
+	The file
+------------------------------------------------------------------------------*/
+#define OGLH_MESH_MAGIC				"OGLHMSH1"
+#define OGLH_MESH_MAX_ATTRIBUTES	8
+#define OGLH_MESH_NAME_SIZE			48
+#define OGLH_MESH_ALIGNMENT			64		// of the vertices and indices
+
+typedef struct oglh_mesh_attribute
+{
+	uint32_t location;
+	uint32_t components;		// 1 to 4
+	uint32_t type;				// GL_FLOAT, GL_UNSIGNED_BYTE ...
+	uint32_t normalized;
+	uint32_t offset;			// bytes into the vertex
+}
+OGLH_MESH_ATTRIBUTE;
+
+typedef struct oglh_mesh_submesh
+{
+	uint32_t first_index;
+	uint32_t index_count;
+	int32_t base_vertex;
+	uint32_t reserved;
+	char name[OGLH_MESH_NAME_SIZE];		// the material, or the group
+}
+OGLH_MESH_SUBMESH;
+
+typedef struct oglh_mesh_header
+{
+	char magic[8];
+	uint32_t header_bytes;				// sizeof(OGLH_MESH_HEADER)
+	uint32_t vertex_stride;
+	uint32_t attribute_count;
+	uint32_t index_type;				// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	uint32_t submesh_count;				// the table follows the header
+	uint32_t reserved;
+	uint64_t vertex_count, vertex_offset;	// offsets from the file's start
+	uint64_t index_count, index_offset;
+	float bounds_min[3], bounds_max[3];
+	OGLH_MESH_ATTRIBUTE attribute[OGLH_MESH_MAX_ATTRIBUTES];
+}
+OGLH_MESH_HEADER;
+/*------------------------------------------------------------------------------
+	Loaded
+------------------------------------------------------------------------------*/
+typedef struct oglh_mesh				// the fields are the module's
+{
+	GLuint vertex_array_id;
+	GLuint vertex_buffer_id;
+	GLuint index_buffer_id;
+	GLenum index_type;
+	long vertex_count, index_count;
+	float bounds_min[3], bounds_max[3];
+	OGLH_MESH_SUBMESH *submesh;
+	int submeshes;
+	bool one_draw;						// base vertices all 0, so -1 is one draw
+}
+OGLH_MESH;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_mesh_load(OGLH_MESH *mesh, const char *file_name);
+void oglh_mesh_draw(const OGLH_MESH *mesh, int submesh);	// -1 for them all
+int oglh_mesh_find_submesh(const OGLH_MESH *mesh, const char *name);	// or -1
+void oglh_mesh_delete(OGLH_MESH *mesh);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,421 @@
+/*------------------------------------------------------------------------------
+	oglh_ occlusion culling -- expensive objects drawn only when they show
+
+	The proxy is a unit cube stretched to each box in the vertex shader, so
+	a test is two uniform calls, a query and a 36 index draw, all made in
+	one run with the state set once around it. A query is taken from the
+	pool when a test is made and goes back when its result is read, so
+	there is never more than one for an object.
+
+	Conditional draws wait on the GPU for their query. The proxy went in
+	just before, so the wait is short, and it makes a zero result mean the
+	draw was skipped -- which is what saved_draws counts.
+------------------------------------------------------------------------------*/
+#include "OpenGL_occlusion.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+	The proxy's shader and cube
+------------------------------------------------------------------------------*/
+#define BOX_MARGIN		0.001f		// relative, the test must err on showing
+
+static const char *proxy_vertex_source =
+	"#version 330 core\n"
+	"layout(location = 0) in vec3 corner;\n"
+	"uniform mat4 view_projection;\n"
+	"uniform vec3 box_min, box_max;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = view_projection * vec4(mix(box_min, box_max, corner), 1);\n"
+	"}\n";
+
+static const char *proxy_fragment_source =
+	"#version 330 core\n"
+	"out vec4 colour;\n"
+	"void main() { colour = vec4(1); }\n";
+
+static const GLfloat cube_vertices[8][3] =
+{
+	{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+	{ 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 },
+};
+
+static const GLubyte cube_indices[36] =
+{
+	0, 2, 1, 0, 3, 2,	4, 5, 6, 4, 6, 7,	0, 1, 5, 0, 5, 4,
+	3, 6, 2, 3, 7, 6,	0, 4, 7, 0, 7, 3,	1, 2, 6, 1, 6, 5,
+};
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static bool have_conservative_queries(void)
+{
+	return oglh_gl_version_or_extension(43, "GL_ARB_ES3_compatibility");
+}
+
+static GLuint compile_proxy_shader(GLenum shader_type, const char *source)
+{
+	GLuint shader_id;
+	GLint success;
+	char log[512];
+
+	shader_id = glCreateShader(shader_type);
+	oglh_registry_add(OGLH_OBJECT_SHADER, shader_id, "occlusion proxy");
+	glShaderSource(shader_id, 1, &source, NULL);
+	glCompileShader(shader_id);
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+	if(!success)
+	{
+		glGetShaderInfoLog(shader_id, sizeof(log), NULL, log);
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"the occlusion proxy shader didn't compile: %s", log);
+		oglh_registry_delete(OGLH_OBJECT_SHADER, shader_id);
+		return 0;
+	}
+	return shader_id;
+}
+
+static GLuint create_proxy_program(void)
+{
+	GLuint program_id, vertex_shader_id, fragment_shader_id;
+	GLint success = GL_FALSE;
+
+	program_id = glCreateProgram();
+	oglh_registry_add(OGLH_OBJECT_PROGRAM, program_id, "occlusion proxy");
+
+	vertex_shader_id = compile_proxy_shader(GL_VERTEX_SHADER,
+		proxy_vertex_source);
+	fragment_shader_id = compile_proxy_shader(GL_FRAGMENT_SHADER,
+		proxy_fragment_source);
+	if(vertex_shader_id != 0 && fragment_shader_id != 0)
+	{
+		glAttachShader(program_id, vertex_shader_id);
+		glAttachShader(program_id, fragment_shader_id);
+		glLinkProgram(program_id);
+		glDetachShader(program_id, vertex_shader_id);
+		glDetachShader(program_id, fragment_shader_id);
+		glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+	}
+	oglh_registry_delete(OGLH_OBJECT_SHADER, vertex_shader_id);
+	oglh_registry_delete(OGLH_OBJECT_SHADER, fragment_shader_id);
+
+	if(!success)
+	{
+		oglh_registry_delete(OGLH_OBJECT_PROGRAM, program_id);
+		return 0;
+	}
+	return program_id;
+}
+/*------------------------------------------------------------------------------
+	For objects 0 to objects - 1
+------------------------------------------------------------------------------*/
+bool oglh_occlusion_create(OGLH_OCCLUSION *occlusion, int objects)
+{
+	GLuint vertex_array_id;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(occlusion, 0, sizeof(*occlusion));
+
+	if(objects <= 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"occlusion culling for %d objects", objects);
+		return false;
+	}
+
+	occlusion->object = calloc(objects, sizeof(OGLH_OCCLUSION_OBJECT));
+	occlusion->free_query = calloc(objects, sizeof(GLuint));
+	if(occlusion->object == NULL || occlusion->free_query == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for %d occlusion objects", objects);
+		free(occlusion->object);
+		free(occlusion->free_query);
+		occlusion->object = NULL;
+		return false;
+	}
+
+	if((occlusion->program_id = create_proxy_program()) == 0)
+	{
+		free(occlusion->object);
+		free(occlusion->free_query);
+		occlusion->object = NULL;
+		return false;
+	}
+	occlusion->view_projection_location =
+		glGetUniformLocation(occlusion->program_id, "view_projection");
+	occlusion->box_min_location =
+		glGetUniformLocation(occlusion->program_id, "box_min");
+	occlusion->box_max_location =
+		glGetUniformLocation(occlusion->program_id, "box_max");
+
+	occlusion->objects = objects;
+	occlusion->free_queries = objects;
+	glGenQueries(objects, occlusion->free_query);
+	occlusion->query_target = have_conservative_queries() ?
+		GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+
+	// don't disturb the caller's vertex array
+	oglh_state_get_integerv(GL_VERTEX_ARRAY_BINDING, (GLint *)&vertex_array_id);
+	oglh_generate_and_bind_opengl_object(GL_VERTEX_ARRAY,
+		&occlusion->vertex_array_id);
+	oglh_generate_and_bind_opengl_object(GL_ARRAY_BUFFER,
+		&occlusion->vertex_buffer_id);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices,
+		GL_STATIC_DRAW);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, occlusion->vertex_buffer_id,
+		sizeof(cube_vertices));
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+	oglh_generate_and_bind_opengl_object(GL_ELEMENT_ARRAY_BUFFER,
+		&occlusion->index_buffer_id);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices,
+		GL_STATIC_DRAW);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, occlusion->index_buffer_id,
+		sizeof(cube_indices));
+	oglh_state_bind_vertex_array(vertex_array_id);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_occlusion_begin_frame
+(
+	OGLH_OCCLUSION *occlusion, const float view_projection[16], const vec3 eye
+)
+{
+	memcpy(occlusion->view_projection, view_projection,
+		sizeof(occlusion->view_projection));
+	memcpy(occlusion->eye, eye, sizeof(vec3));
+	occlusion->frame++;
+}
+/*------------------------------------------------------------------------------
+	True once the object's query has been read, or if it had none; a query
+	made this frame isn't even asked about
+------------------------------------------------------------------------------*/
+static bool read_result(OGLH_OCCLUSION *occlusion, OGLH_OCCLUSION_OBJECT *object)
+{
+	GLuint available = GL_FALSE, samples_passed = GL_TRUE;
+
+	if(object->query_id == 0) return true;
+	if(object->query_frame == occlusion->frame) return false;
+
+	glGetQueryObjectuiv(object->query_id, GL_QUERY_RESULT_AVAILABLE, &available);
+	if(!available) return false;
+	glGetQueryObjectuiv(object->query_id, GL_QUERY_RESULT, &samples_passed);
+
+	if(samples_passed)
+	{
+		object->hidden_results = 0;
+	}
+	else
+	{
+		object->hidden_results++;
+		occlusion->statistics.saved_draws += object->conditional_draws;
+	}
+
+	occlusion->free_query[occlusion->free_queries++] = object->query_id;
+	object->query_id = 0;
+	object->conditional_draws = 0;
+	occlusion->statistics.results++;
+	return true;
+}
+
+static bool eye_inside(const OGLH_OCCLUSION *occlusion, const OGLH_OCCLUSION_BOX *box)
+{
+	float margin;
+	int axis;
+
+	for(axis = 0; axis < 3; axis++)
+	{
+		margin = (box->max[axis] - box->min[axis]) * BOX_MARGIN;
+		if(occlusion->eye[axis] < box->min[axis] - margin ||
+			occlusion->eye[axis] > box->max[axis] + margin)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Reads whatever results have landed and draws a proxy in a query for
+	every object free to be tested. Call it after the occluders are drawn
+	and before the objects.
+------------------------------------------------------------------------------*/
+void oglh_occlusion_test
+(
+	OGLH_OCCLUSION *occlusion, int objects, const OGLH_OCCLUSION_BOX *box
+)
+{
+	OGLH_OCCLUSION_OBJECT *object;
+	GLint program_id, vertex_array_id;
+	bool culling, depth_testing;
+	vec3 box_min, box_max;
+	float margin;
+	int index, axis;
+
+	OGLH_NOTE_CALL_SITE();
+	if(objects > occlusion->objects) objects = occlusion->objects;
+	if(objects <= 0) return;
+
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
+	oglh_state_get_integerv(GL_VERTEX_ARRAY_BINDING, &vertex_array_id);
+	culling = oglh_state_is_enabled(GL_CULL_FACE);
+	depth_testing = oglh_state_is_enabled(GL_DEPTH_TEST);
+
+	oglh_state_use_program(occlusion->program_id);
+	oglh_state_bind_vertex_array(occlusion->vertex_array_id);
+	oglh_state_disable(GL_CULL_FACE);
+	oglh_state_enable(GL_DEPTH_TEST);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	glUniformMatrix4fv(occlusion->view_projection_location, 1, GL_TRUE,
+		occlusion->view_projection);
+
+	for(index = 0; index < objects; index++)
+	{
+		object = &occlusion->object[index];
+		if(!read_result(occlusion, object))
+		{
+			occlusion->statistics.pending++;
+			continue;
+		}
+
+		// from inside, the box is behind the near plane and never shows
+		if(eye_inside(occlusion, &box[index]))
+		{
+			object->hidden_results = 0;
+			continue;
+		}
+
+		for(axis = 0; axis < 3; axis++)
+		{
+			margin = (box[index].max[axis] - box[index].min[axis]) * BOX_MARGIN;
+			box_min[axis] = box[index].min[axis] - margin;
+			box_max[axis] = box[index].max[axis] + margin;
+		}
+		glUniform3fv(occlusion->box_min_location, 1, box_min);
+		glUniform3fv(occlusion->box_max_location, 1, box_max);
+
+		object->query_id = occlusion->free_query[--occlusion->free_queries];
+		object->query_frame = occlusion->frame;
+		glBeginQuery(occlusion->query_target, object->query_id);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, 0);
+		glEndQuery(occlusion->query_target);
+		occlusion->statistics.tests++;
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_TRUE);
+	if(!depth_testing) oglh_state_disable(GL_DEPTH_TEST);
+	if(culling) oglh_state_enable(GL_CULL_FACE);
+	oglh_state_bind_vertex_array(vertex_array_id);
+	oglh_state_use_program(program_id);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Around the object's real draws. Only a query made this frame, from this
+	frame's camera, decides: one still in flight from an earlier frame
+	could keep an object that has just come into view hidden until it
+	lands, so the object is drawn as usual meanwhile.
+------------------------------------------------------------------------------*/
+static bool known_object
+(
+	const OGLH_OCCLUSION *occlusion, int object_index, const char *func
+)
+{
+	if(object_index >= 0 && object_index < occlusion->objects) return true;
+
+	oglh_program_warning(__FILE__, __LINE__, func,
+		"object %d of %d", object_index, occlusion->objects);
+	return false;
+}
+
+void oglh_occlusion_begin_draw(OGLH_OCCLUSION *occlusion, int object_index)
+{
+	OGLH_OCCLUSION_OBJECT *object;
+
+	occlusion->draw_object = object_index;
+	if(!known_object(occlusion, object_index, __FUNC__)) return;
+
+	object = &occlusion->object[object_index];
+	if(!oglh_occlusion_is_hidden(occlusion, object_index) ||
+		object->query_id == 0 || object->query_frame != occlusion->frame)
+	{
+		occlusion->statistics.visible_draws++;
+		return;
+	}
+
+	glBeginConditionalRender(object->query_id, GL_QUERY_WAIT);
+	occlusion->conditional = true;
+	object->conditional_draws++;
+	occlusion->statistics.culled++;
+}
+
+void oglh_occlusion_end_draw(OGLH_OCCLUSION *occlusion, int object_index)
+{
+	// draws can't nest, the conditional render would end with the wrong one
+	if(known_object(occlusion, object_index, __FUNC__) &&
+		object_index != occlusion->draw_object)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"end_draw of object %d after begin_draw of object %d",
+			object_index, occlusion->draw_object);
+	}
+	if(!occlusion->conditional) return;
+
+	glEndConditionalRender();
+	occlusion->conditional = false;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+bool oglh_occlusion_is_hidden(const OGLH_OCCLUSION *occlusion, int object_index)
+{
+	return known_object(occlusion, object_index, __FUNC__) &&
+		occlusion->object[object_index].hidden_results >=
+		OGLH_OCCLUSION_HIDE_AFTER;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_occlusion_delete(OGLH_OCCLUSION *occlusion)
+{
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(occlusion->object == NULL) return;
+
+	// the queries in flight go back to the pool to be deleted with it
+	for(index = 0; index < occlusion->objects; index++)
+	{
+		if(occlusion->object[index].query_id != 0)
+		{
+			occlusion->free_query[occlusion->free_queries++] =
+				occlusion->object[index].query_id;
+		}
+	}
+	glDeleteQueries(occlusion->free_queries, occlusion->free_query);
+
+	oglh_registry_delete(OGLH_OBJECT_PROGRAM, occlusion->program_id);
+	oglh_registry_delete(OGLH_OBJECT_VERTEX_ARRAY, occlusion->vertex_array_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, occlusion->vertex_buffer_id);
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, occlusion->index_buffer_id);
+	free(occlusion->object);
+	free(occlusion->free_query);
+	memset(occlusion, 0, sizeof(*occlusion));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+void oglh_occlusion_get_statistics
+(
+	const OGLH_OCCLUSION *occlusion, OGLH_OCCLUSION_STATISTICS *statistics
+)
+{
+	*statistics = occlusion->statistics;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
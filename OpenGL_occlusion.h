@@ -0,0 +1,116 @@
+/*------------------------------------------------------------------------------
+	oglh_ occlusion culling -- expensive objects drawn only when they show
+
+	After the big occluders are drawn each object's bounding box is drawn
+	with colour and depth writes off inside an occlusion query. The real
+	draw of an object whose box has been hidden for a few frames is then
+	wrapped in conditional rendering on its query, so the GPU skips it if
+	the box still doesn't show -- no result is waited for on the CPU.
+
+	OGLH_OCCLUSION occlusion;
+	oglh_occlusion_create(&occlusion, statues);
+	...
+	oglh_occlusion_begin_frame(&occlusion, view_projection, eye);
+	draw_walls_and_floor();
+	oglh_occlusion_test(&occlusion, statues, statue_box);	// the proxies
+	for(i = 0; i < statues; i++)
+	{
+		oglh_occlusion_begin_draw(&occlusion, i);
+		draw_statue(i);
+		oglh_occlusion_end_draw(&occlusion, i);
+	}
+
+	view_projection is row-major, as oglh_set_uniform_variable takes a
+	mat4. Query results are read back only once they're available, a
+	frame or more later, and an object with a query still in flight isn't
+	tested again until it lands. Objects are drawn as usual until
+	OGLH_OCCLUSION_HIDE_AFTER results in a row have found them hidden and
+	as usual again from the first result that finds them visible, so
+	objects at the edge of visibility don't flicker between the two. Only
+	a query made this frame conditions a draw; while an object's query
+	from an earlier frame is in flight it is drawn as usual, so nothing
+	that has just come into view waits on an old camera's result.
+
+	The queries are GL_ANY_SAMPLES_PASSED_CONSERVATIVE where there is GL 4.3
+	or ARB_ES3_compatibility, GL_ANY_SAMPLES_PASSED elsewhere. The tests
+	need depth testing against the occluders; they leave colour and depth
+	writes on.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_OCCLUSION_HIDE_AFTER	3		// hidden results before culling
+
+typedef struct oglh_occlusion_box
+{
+	vec3 min, max;
+}
+OGLH_OCCLUSION_BOX;
+
+typedef struct oglh_occlusion_statistics
+{
+	long tests;					// proxy boxes drawn in a query
+	long pending;				// tests skipped, the last query hadn't landed
+	long results;				// query results read back
+	long culled;				// draws made conditional, the object seemed hidden
+	long saved_draws;			// ... that the GPU skipped
+	long visible_draws;			// draws made as usual
+}
+OGLH_OCCLUSION_STATISTICS;
+
+typedef struct oglh_occlusion_object
+{
+	GLuint query_id;			// in flight, or 0
+	long query_frame;
+	int hidden_results;			// in a row
+	int conditional_draws;		// made on query_id
+}
+OGLH_OCCLUSION_OBJECT;
+
+typedef struct oglh_occlusion				// the fields are the module's
+{
+	GLuint program_id;
+	GLint view_projection_location, box_min_location, box_max_location;
+	GLuint vertex_array_id, vertex_buffer_id, index_buffer_id;
+	GLenum query_target;
+
+	GLuint *free_query;						// the pool
+	int free_queries;
+
+	OGLH_OCCLUSION_OBJECT *object;
+	int objects;
+	bool conditional;						// between begin_draw and end_draw
+	int draw_object;						// the last begin_draw's
+
+	long frame;
+	float view_projection[16];
+	vec3 eye;
+
+	OGLH_OCCLUSION_STATISTICS statistics;
+}
+OGLH_OCCLUSION;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_occlusion_create(OGLH_OCCLUSION *occlusion, int objects);
+void oglh_occlusion_begin_frame
+(
+	OGLH_OCCLUSION *occlusion, const float view_projection[16], const vec3 eye
+);
+void oglh_occlusion_test
+(
+	OGLH_OCCLUSION *occlusion, int objects, const OGLH_OCCLUSION_BOX *box
+);
+void oglh_occlusion_begin_draw(OGLH_OCCLUSION *occlusion, int object);
+void oglh_occlusion_end_draw(OGLH_OCCLUSION *occlusion, int object);
+bool oglh_occlusion_is_hidden(const OGLH_OCCLUSION *occlusion, int object);
+void oglh_occlusion_delete(OGLH_OCCLUSION *occlusion);
+void oglh_occlusion_get_statistics
+(
+	const OGLH_OCCLUSION *occlusion, OGLH_OCCLUSION_STATISTICS *statistics
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,584 @@
+/*------------------------------------------------------------------------------
+	oglh_ registry -- every GL object the helpers make, what it is, how big
+	and where it came from
+
+	The records are in an open addressed hash table keyed on type and name,
+	the totals per type are kept up to date as objects come and go so a
+	report doesn't have to walk the table. One registry per oglh context,
+	used only on the thread it is current on, like the GL.
+------------------------------------------------------------------------------*/
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define RECORD_EMPTY		0
+#define RECORD_LIVE			1
+#define RECORD_DELETED		2	// a tombstone, so probing carries on past it
+
+#define INITIAL_CAPACITY	256	// a power of two
+
+typedef struct registry_record
+{
+	int state;
+	int object_type;
+	GLuint object_id;
+	GLenum internal_format;
+	int width, height, depth, levels;
+	long bytes;						// -1 until told
+	char label[OGLH_REGISTRY_LABEL_SIZE];
+	OGLH_CALL_SITE site;
+}
+REGISTRY_RECORD;
+
+typedef struct type_totals
+{
+	long live, created, deleted;
+	long sized, bytes;
+}
+TYPE_TOTALS;
+
+typedef struct registry
+{
+	REGISTRY_RECORD *record_table;
+	size_t table_capacity, table_used;	// used counts tombstones
+
+	TYPE_TOTALS totals[OGLH_OBJECT_TYPES];
+
+	// pre-generated names, for the types that have glGen*
+	GLuint free_ids[OGLH_OBJECT_VERTEX_ARRAY + 1][OGLH_REGISTRY_BLOCK];
+	int number_of_free_ids[OGLH_OBJECT_VERTEX_ARRAY + 1];
+}
+REGISTRY;
+
+// the thread's oglh context's, see OpenGL_context.h
+static REGISTRY default_registry;
+static _Thread_local REGISTRY *registry = &default_registry;
+
+static const char *object_type_name[OGLH_OBJECT_TYPES] =
+{
+	"buffer", "texture", "renderbuffer", "framebuffer", "vertex array",
+	"shader", "program"
+};
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static size_t hash_key(int object_type, GLuint object_id)
+{
+	unsigned long long key = ((unsigned long long)object_type << 32) | object_id;
+
+	return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 17);
+}
+
+static REGISTRY_RECORD *find_record(int object_type, GLuint object_id)
+{
+	size_t index, mask = registry->table_capacity - 1;
+	REGISTRY_RECORD *record;
+
+	if(registry->record_table == NULL) return NULL;
+
+	for(index = hash_key(object_type, object_id) & mask; ; index = (index + 1) & mask)
+	{
+		record = &registry->record_table[index];
+		if(record->state == RECORD_EMPTY) return NULL;
+		if(record->state == RECORD_LIVE && record->object_type == object_type &&
+			record->object_id == object_id)
+		{
+			return record;
+		}
+	}
+}
+/*------------------------------------------------------------------------------
+	A slot for a new record, growing the table (and dropping the tombstones)
+	when it is half full
+------------------------------------------------------------------------------*/
+static REGISTRY_RECORD *new_record(int object_type, GLuint object_id)
+{
+	REGISTRY_RECORD *old_table = registry->record_table, *record;
+	size_t old_capacity = registry->table_capacity, index, mask;
+
+	if(2 * (registry->table_used + 1) > registry->table_capacity)
+	{
+		registry->table_capacity =
+			old_capacity == 0 ? INITIAL_CAPACITY : 2 * old_capacity;
+		registry->record_table =
+			calloc(registry->table_capacity, sizeof(REGISTRY_RECORD));
+		if(registry->record_table == NULL)
+		{
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"registry out of memory for %zu records",
+				registry->table_capacity);
+			registry->record_table = old_table;
+			registry->table_capacity = old_capacity;
+			return NULL;
+		}
+
+		registry->table_used = 0;
+		mask = registry->table_capacity - 1;
+		for(record = old_table; record < old_table + old_capacity; record++)
+		{
+			if(record->state != RECORD_LIVE) continue;
+
+			index = hash_key(record->object_type, record->object_id) & mask;
+			while(registry->record_table[index].state != RECORD_EMPTY)
+				index = (index + 1) & mask;
+			registry->record_table[index] = *record;
+			registry->table_used++;
+		}
+		free(old_table);
+	}
+
+	mask = registry->table_capacity - 1;
+	index = hash_key(object_type, object_id) & mask;
+	while(registry->record_table[index].state == RECORD_LIVE)
+		index = (index + 1) & mask;
+
+	record = &registry->record_table[index];
+	if(record->state == RECORD_EMPTY) registry->table_used++;
+	return record;
+}
+/*------------------------------------------------------------------------------
+	bytes per texel, for the estimates
+------------------------------------------------------------------------------*/
+static int texel_bytes(GLenum internal_format)
+{
+	switch(internal_format)
+	{
+		case GL_R8:
+		case GL_STENCIL_INDEX8:
+			return 1;
+
+		case GL_RG8:
+		case GL_R16F:
+		case GL_RGBA4:
+		case GL_RGB5_A1:
+		case GL_RGB565:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_DEPTH_COMPONENT32F:
+			return 4;
+
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+
+		case GL_RGB32F:
+			return 12;
+
+		case GL_RGBA32F:
+			return 16;
+
+		default:	// RGBA8, RGB8 (padded), depth 24 and the rest
+			return 4;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static bool valid_object_type(int object_type, const char *func)
+{
+	if(object_type >= 0 && object_type < OGLH_OBJECT_TYPES) return true;
+
+	oglh_program_error(__FILE__, __LINE__, func,
+		"unknown registry object type %d", object_type);
+	return false;
+}
+
+int oglh_registry_object_type(GLenum target)
+{
+	switch(target)
+	{
+		case GL_ARRAY_BUFFER:
+		case GL_ELEMENT_ARRAY_BUFFER:
+		case GL_PIXEL_PACK_BUFFER:
+		case GL_PIXEL_UNPACK_BUFFER:
+		case GL_TRANSFORM_FEEDBACK_BUFFER:
+		case GL_UNIFORM_BUFFER:
+		case GL_SHADER_STORAGE_BUFFER:
+		case GL_DRAW_INDIRECT_BUFFER:
+			return OGLH_OBJECT_BUFFER;
+
+		case GL_TEXTURE_1D:
+		case GL_TEXTURE_2D:
+		case GL_TEXTURE_3D:
+		case GL_TEXTURE_1D_ARRAY:
+		case GL_TEXTURE_2D_ARRAY:
+		case GL_TEXTURE_CUBE_MAP:
+			return OGLH_OBJECT_TEXTURE;
+
+		case GL_RENDERBUFFER:		return OGLH_OBJECT_RENDERBUFFER;
+		case GL_FRAMEBUFFER:		return OGLH_OBJECT_FRAMEBUFFER;
+		case GL_VERTEX_ARRAY:		return OGLH_OBJECT_VERTEX_ARRAY;
+		case GL_VERTEX_SHADER:
+		case GL_FRAGMENT_SHADER:	return OGLH_OBJECT_SHADER;
+		case GL_PROGRAM:			return OGLH_OBJECT_PROGRAM;
+
+		default:					return -1;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void set_record_bytes(REGISTRY_RECORD *record, long bytes)
+{
+	TYPE_TOTALS *type_totals = &registry->totals[record->object_type];
+
+	if(record->bytes < 0)
+		type_totals->sized++;
+	else
+		type_totals->bytes -= record->bytes;
+
+	record->bytes = bytes;
+	type_totals->bytes += bytes;
+}
+/*------------------------------------------------------------------------------
+	the end of a long path says more than its start
+------------------------------------------------------------------------------*/
+static void copy_label(REGISTRY_RECORD *record, const char *label)
+{
+	if(label == NULL) return;
+
+	if(strlen(label) >= OGLH_REGISTRY_LABEL_SIZE)
+		label += strlen(label) - (OGLH_REGISTRY_LABEL_SIZE - 1);
+	snprintf(record->label, OGLH_REGISTRY_LABEL_SIZE, "%s", label);
+}
+/*------------------------------------------------------------------------------
+	The next pre-generated name, topping the free list up a block at a time
+------------------------------------------------------------------------------*/
+GLuint oglh_registry_generate_at
+(
+	int object_type, const char *path_file, int line, const char *func
+)
+{
+	GLuint *ids;
+	GLuint object_id;
+
+	if(!valid_object_type(object_type, __FUNC__)) return 0;
+	if(object_type > OGLH_OBJECT_VERTEX_ARRAY)
+	{
+		oglh_program_error(path_file, line, func,
+			"%ss are created, not generated", object_type_name[object_type]);
+		return 0;
+	}
+
+	ids = registry->free_ids[object_type];
+	if(registry->number_of_free_ids[object_type] == 0)
+	{
+		switch(object_type)
+		{
+			case OGLH_OBJECT_BUFFER:
+				glGenBuffers(OGLH_REGISTRY_BLOCK, ids);				break;
+			case OGLH_OBJECT_TEXTURE:
+				glGenTextures(OGLH_REGISTRY_BLOCK, ids);			break;
+			case OGLH_OBJECT_RENDERBUFFER:
+				glGenRenderbuffers(OGLH_REGISTRY_BLOCK, ids);		break;
+			case OGLH_OBJECT_FRAMEBUFFER:
+				glGenFramebuffers(OGLH_REGISTRY_BLOCK, ids);		break;
+			case OGLH_OBJECT_VERTEX_ARRAY:
+				glGenVertexArrays(OGLH_REGISTRY_BLOCK, ids);		break;
+		}
+		oglh_error_check(__FILE__, __LINE__, __FUNC__);
+		registry->number_of_free_ids[object_type] = OGLH_REGISTRY_BLOCK;
+	}
+
+	// hand them out lowest name first
+	object_id =
+		ids[OGLH_REGISTRY_BLOCK - registry->number_of_free_ids[object_type]--];
+	oglh_registry_add_at(object_type, object_id, NULL, path_file, line, func);
+	return object_id;
+}
+/*------------------------------------------------------------------------------
+	Records an object that was made some other way, glCreateShader say
+------------------------------------------------------------------------------*/
+void oglh_registry_add_at
+(
+	int object_type, GLuint object_id, const char *label,
+	const char *path_file, int line, const char *func
+)
+{
+	REGISTRY_RECORD *record;
+
+	if(object_id == 0 || !valid_object_type(object_type, __FUNC__)) return;
+
+	if(find_record(object_type, object_id) != NULL)
+	{
+		oglh_program_warning(path_file, line, func,
+			"%s %u is already registered", object_type_name[object_type],
+			object_id);
+		return;
+	}
+	if((record = new_record(object_type, object_id)) == NULL) return;
+
+	memset(record, 0, sizeof(*record));
+	record->state = RECORD_LIVE;
+	record->object_type = object_type;
+	record->object_id = object_id;
+	record->bytes = -1;
+	record->site.path_file = path_file;
+	record->site.line = line;
+	record->site.func = func;
+	copy_label(record, label);
+
+	registry->totals[object_type].live++;
+	registry->totals[object_type].created++;
+
+	// containers and code, nothing the registry could put a size on
+	if(object_type >= OGLH_OBJECT_FRAMEBUFFER) set_record_bytes(record, 0);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_registry_set_label
+(
+	int object_type, GLuint object_id, const char *label
+)
+{
+	REGISTRY_RECORD *record;
+
+	if((record = find_record(object_type, object_id)) != NULL)
+		copy_label(record, label);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_registry_set_bytes(int object_type, GLuint object_id, long bytes)
+{
+	REGISTRY_RECORD *record;
+
+	if((record = find_record(object_type, object_id)) != NULL)
+		set_record_bytes(record, bytes);
+}
+/*------------------------------------------------------------------------------
+	For textures and renderbuffers; depth 1 for 2D, levels 1 without mipmaps
+------------------------------------------------------------------------------*/
+void oglh_registry_set_image
+(
+	int object_type, GLuint object_id, GLenum internal_format,
+	int width, int height, int depth, int levels
+)
+{
+	REGISTRY_RECORD *record;
+	long bytes;
+
+	if((record = find_record(object_type, object_id)) == NULL) return;
+
+	record->internal_format = internal_format;
+	record->width = width;
+	record->height = height;
+	record->depth = depth;
+	record->levels = levels;
+
+	bytes = (long)texel_bytes(internal_format) * width * height *
+		(depth > 0 ? depth : 1);
+	if(levels > 1) bytes += bytes / 3;
+	set_record_bytes(record, bytes);
+}
+/*------------------------------------------------------------------------------
+	Drops the record, the GL object is already gone
+------------------------------------------------------------------------------*/
+void oglh_registry_forget(int object_type, GLuint object_id)
+{
+	REGISTRY_RECORD *record;
+	TYPE_TOTALS *type_totals;
+
+	oglh_state_forget_object(object_type, object_id);
+	if((record = find_record(object_type, object_id)) == NULL) return;
+
+	type_totals = &registry->totals[object_type];
+	type_totals->live--;
+	type_totals->deleted++;
+	if(record->bytes >= 0)
+	{
+		type_totals->sized--;
+		type_totals->bytes -= record->bytes;
+	}
+	record->state = RECORD_DELETED;
+}
+/*------------------------------------------------------------------------------
+	Deletes the GL object and its record. Objects the registry doesn't know
+	are deleted all the same.
+------------------------------------------------------------------------------*/
+void oglh_registry_delete(int object_type, GLuint object_id)
+{
+	if(object_id == 0 || !valid_object_type(object_type, __FUNC__)) return;
+
+	switch(object_type)
+	{
+		case OGLH_OBJECT_BUFFER:		glDeleteBuffers(1, &object_id);			break;
+		case OGLH_OBJECT_TEXTURE:		glDeleteTextures(1, &object_id);		break;
+		case OGLH_OBJECT_RENDERBUFFER:	glDeleteRenderbuffers(1, &object_id);	break;
+		case OGLH_OBJECT_FRAMEBUFFER:	glDeleteFramebuffers(1, &object_id);	break;
+		case OGLH_OBJECT_VERTEX_ARRAY:	glDeleteVertexArrays(1, &object_id);	break;
+		case OGLH_OBJECT_SHADER:		glDeleteShader(object_id);				break;
+		case OGLH_OBJECT_PROGRAM:		glDeleteProgram(object_id);				break;
+	}
+	oglh_registry_forget(object_type, object_id);
+}
+/*------------------------------------------------------------------------------
+	Gives back the names generated but not yet handed out, before the
+	context goes away say
+------------------------------------------------------------------------------*/
+void oglh_registry_release_free_ids(void)
+{
+	int object_type, count;
+	GLuint *ids;
+
+	for(object_type = 0; object_type <= OGLH_OBJECT_VERTEX_ARRAY; object_type++)
+	{
+		count = registry->number_of_free_ids[object_type];
+		ids = registry->free_ids[object_type] + OGLH_REGISTRY_BLOCK - count;
+		if(count == 0) continue;
+
+		switch(object_type)
+		{
+			case OGLH_OBJECT_BUFFER:		glDeleteBuffers(count, ids);		break;
+			case OGLH_OBJECT_TEXTURE:		glDeleteTextures(count, ids);		break;
+			case OGLH_OBJECT_RENDERBUFFER:	glDeleteRenderbuffers(count, ids);	break;
+			case OGLH_OBJECT_FRAMEBUFFER:	glDeleteFramebuffers(count, ids);	break;
+			case OGLH_OBJECT_VERTEX_ARRAY:	glDeleteVertexArrays(count, ids);	break;
+		}
+		registry->number_of_free_ids[object_type] = 0;
+	}
+}
+/*------------------------------------------------------------------------------
+	made and not yet deleted
+------------------------------------------------------------------------------*/
+bool oglh_registry_is_live(int object_type, GLuint object_id)
+{
+	return find_record(object_type, object_id) != NULL;
+}
+/*------------------------------------------------------------------------------
+	-1 for all types
+------------------------------------------------------------------------------*/
+void oglh_registry_get_totals(int object_type, long *live, long *bytes)
+{
+	int index;
+
+	if(live != NULL) *live = 0;
+	if(bytes != NULL) *bytes = 0;
+
+	for(index = 0; index < OGLH_OBJECT_TYPES; index++)
+	{
+		if(object_type >= 0 && object_type != index) continue;
+		if(live != NULL) *live += registry->totals[index].live;
+		if(bytes != NULL) *bytes += registry->totals[index].bytes;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void print_rule(FILE *report_fptr)
+{
+	fprintf
+	(
+		report_fptr,
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+}
+
+void oglh_registry_report(FILE *report_fptr)
+{
+	long live = 0, created = 0, deleted = 0, unsized = 0, bytes = 0;
+	TYPE_TOTALS *type_totals;
+	int object_type;
+
+	print_rule(report_fptr);
+	fprintf(report_fptr, ANSI_COLOR_GREEN "\t%-16s %9s %9s %9s %9s %12s\n"
+		ANSI_COLOR_RESET, "GL objects", "live", "created", "deleted",
+		"unsized", "est. MB");
+
+	for(object_type = 0; object_type < OGLH_OBJECT_TYPES; object_type++)
+	{
+		type_totals = &registry->totals[object_type];
+		fprintf(report_fptr, "\t%-16s %9ld %9ld %9ld %9ld %12.3f\n",
+			object_type_name[object_type], type_totals->live,
+			type_totals->created, type_totals->deleted,
+			type_totals->live - type_totals->sized,
+			type_totals->bytes / (1024.0 * 1024.0));
+
+		live += type_totals->live;
+		created += type_totals->created;
+		deleted += type_totals->deleted;
+		unsized += type_totals->live - type_totals->sized;
+		bytes += type_totals->bytes;
+	}
+
+	fprintf(report_fptr, ANSI_COLOR_YELLOW "\t%-16s %9ld %9ld %9ld %9ld %12.3f\n"
+		ANSI_COLOR_RESET, "all", live, created, deleted, unsized,
+		bytes / (1024.0 * 1024.0));
+	print_rule(report_fptr);
+}
+/*------------------------------------------------------------------------------
+	Every live object of a type (-1 for all) and where it was made -- the
+	leak hunter's list
+------------------------------------------------------------------------------*/
+void oglh_registry_list_objects(FILE *report_fptr, int object_type)
+{
+	REGISTRY_RECORD *record;
+	char description[OGLH_REGISTRY_LABEL_SIZE], size[32];
+	size_t index;
+
+	print_rule(report_fptr);
+	fprintf(report_fptr, ANSI_COLOR_GREEN "\t%-13s %6s %-20s %10s  %s\n"
+		ANSI_COLOR_RESET, "type", "name", "label / image", "bytes",
+		"created at");
+
+	for(index = 0; index < registry->table_capacity; index++)
+	{
+		record = &registry->record_table[index];
+		if(record->state != RECORD_LIVE) continue;
+		if(object_type >= 0 && record->object_type != object_type) continue;
+
+		if(record->label[0] == '\0' && record->width > 0)
+		{
+			snprintf(description, sizeof(description), "%dx%dx%d 0x%04x",
+				record->width, record->height, record->depth > 0 ?
+				record->depth : 1, record->internal_format);
+		}
+		else
+			snprintf(description, sizeof(description), "%s", record->label);
+		if(record->bytes < 0)
+			snprintf(size, sizeof(size), "-");
+		else
+			snprintf(size, sizeof(size), "%ld", record->bytes);
+
+		fprintf(report_fptr, "\t%-13s %6u %-20s %10s  %s:%d %s\n",
+			object_type_name[record->object_type], record->object_id,
+			description, size, record->site.path_file, record->site.line,
+			record->site.func);
+	}
+	print_rule(report_fptr);
+}
+/*------------------------------------------------------------------------------
+	The registry as a part of an oglh context, see OpenGL_context.h. The
+	part goes without GL calls, names still free are left to GL.
+------------------------------------------------------------------------------*/
+void *oglh_registry_new_context(void)
+{
+	return calloc(1, sizeof(REGISTRY));
+}
+
+void oglh_registry_use_context(void *records)
+{
+	registry = records != NULL ? records : &default_registry;
+}
+
+void oglh_registry_delete_context(void *records)
+{
+	if(records == NULL) return;
+
+	if(records == registry) registry = &default_registry;
+	free(((REGISTRY *)records)->record_table);
+	free(records);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+	oglh_ registry -- every GL object the helpers make, what it is, how big
+	and where it came from
+
+	Names for buffers, textures, renderbuffers, framebuffers and vertex
+	arrays are generated OGLH_REGISTRY_BLOCK at a time and handed out from a
+	free list, one glGen* call instead of one per object. Each object handed
+	out, and each shader and program that oglh_install_shader creates, gets
+	a record of its type, format, size and creation site until it is deleted.
+
+	GLuint vbo = oglh_registry_generate(OGLH_OBJECT_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STATIC_DRAW);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, vbo, bytes);
+	...
+	oglh_registry_report(stdout);		// counts and VRAM estimate per type
+	oglh_registry_list_objects(stdout, OGLH_OBJECT_TEXTURE);	// who made them
+	...
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, vbo);
+
+	oglh_generate_and_bind_opengl_object goes through the registry, so
+	objects made with it are recorded at the caller's file and line. Sizes
+	are whatever the registry is told -- objects never given one are
+	reported as unsized rather than guessed. The estimate for images is
+	bytes per texel times texels, a third more with mipmaps; drivers pad
+	and compress so treat it as a budget, not a measurement.
+
+	Objects must be deleted through the registry (oglh_registry_delete), or
+	forgotten with oglh_registry_forget if they were deleted some other way,
+	for the counts to mean anything.
+
+	The records are the thread's current oglh context's (OpenGL_context.h),
+	so each GL context reports its own objects.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_OBJECT_BUFFER			0
+#define OGLH_OBJECT_TEXTURE			1
+#define OGLH_OBJECT_RENDERBUFFER	2
+#define OGLH_OBJECT_FRAMEBUFFER		3
+#define OGLH_OBJECT_VERTEX_ARRAY	4
+#define OGLH_OBJECT_SHADER			5
+#define OGLH_OBJECT_PROGRAM			6
+#define OGLH_OBJECT_TYPES			7
+
+#define OGLH_REGISTRY_BLOCK			32	// names generated per glGen* call
+#define OGLH_REGISTRY_LABEL_SIZE	32
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define oglh_registry_generate(object_type)									\
+	oglh_registry_generate_at(object_type, __FILE__, __LINE__, __FUNC__)
+
+#define oglh_registry_add(object_type, object_id, label)					\
+	oglh_registry_add_at(object_type, object_id, label,						\
+		__FILE__, __LINE__, __FUNC__)
+
+GLuint oglh_registry_generate_at
+(
+	int object_type, const char *path_file, int line, const char *func
+);
+void oglh_registry_add_at
+(
+	int object_type, GLuint object_id, const char *label,
+	const char *path_file, int line, const char *func
+);
+void oglh_registry_set_label
+(
+	int object_type, GLuint object_id, const char *label
+);
+void oglh_registry_set_bytes(int object_type, GLuint object_id, long bytes);
+void oglh_registry_set_image
+(
+	int object_type, GLuint object_id, GLenum internal_format,
+	int width, int height, int depth, int levels
+);
+void oglh_registry_delete(int object_type, GLuint object_id);
+void oglh_registry_forget(int object_type, GLuint object_id);
+void oglh_registry_release_free_ids(void);
+
+int oglh_registry_object_type(GLenum target);	// -1 if there isn't one
+bool oglh_registry_is_live(int object_type, GLuint object_id);
+void oglh_registry_get_totals(int object_type, long *live, long *bytes);
+void oglh_registry_report(FILE *report_fptr);
+void oglh_registry_list_objects(FILE *report_fptr, int object_type);
+
+// for OpenGL_context.c
+void *oglh_registry_new_context(void);
+void oglh_registry_use_context(void *records);
+void oglh_registry_delete_context(void *records);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,605 @@
+/*------------------------------------------------------------------------------
+	oglh_ resource thread -- shaders, buffers and textures made off the
+	frame
+
+	A request goes from the pending queue to the resource thread, which
+	makes the object, fences it, flushes so the fence will signal, and
+	moves it to the done queue. oglh_resources_poll hands out the head of
+	the done queue once its fence has signalled. Both queues are under one
+	mutex; the work behind a request dwarfs the lock.
+
+	Nothing the resource thread does touches the helpers' caches, which
+	belong to the rendering context -- it makes plain GL calls, and leaves
+	registering and reporting to the rendering thread when it polls.
+------------------------------------------------------------------------------*/
+#include "OpenGL_resources.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_counted_calls.h"
+#include <pthread.h>		//	POSIX threads
+#include <time.h>			//	Time/date utilities
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef struct resource_request
+{
+	struct resource_request *next;
+	int request;
+	int kind;
+	void *user_data;
+
+	char shader_name[FILENAME_MAX];				// programs
+	GLenum usage;								// buffers
+	GLsizeiptr size;
+	GLsizei width, height;						// textures
+	GLenum internal_format, format, type;
+	bool mipmaps;
+	const void *data;
+
+	GLuint object_id;							// made on the resource thread
+	GLsync fence;
+	char message[OGLH_RESOURCE_MESSAGE_SIZE];	// why it failed
+}
+RESOURCE_REQUEST;
+
+static struct
+{
+	bool active;
+	pthread_t thread;
+	OGLH_RESOURCE_CONTEXT context;
+	void *context_data;
+	bool context_made;
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	RESOURCE_REQUEST *pending, *pending_tail;	// for the resource thread
+	RESOURCE_REQUEST *done, *done_tail;			// for oglh_resources_poll
+	bool quit, working;
+	int next_request;
+
+	bool have_texture_storage;
+	OGLH_RESOURCE_STATISTICS statistics;
+}
+resources;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void append(RESOURCE_REQUEST **head, RESOURCE_REQUEST **tail,
+	RESOURCE_REQUEST *request)
+{
+	request->next = NULL;
+	if(*head == NULL) *head = request; else (*tail)->next = request;
+	*tail = request;
+}
+
+static RESOURCE_REQUEST *take(RESOURCE_REQUEST **head, RESOURCE_REQUEST **tail)
+{
+	RESOURCE_REQUEST *request = *head;
+
+	if(request != NULL && (*head = request->next) == NULL) *tail = NULL;
+	return request;
+}
+
+static double milliseconds_between(struct timespec *from, struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1e3 +
+		(to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+static long texel_bytes(GLenum format, GLenum type)
+{
+	int components;
+
+	switch(format)
+	{
+		case GL_RED:	components = 1;	break;
+		case GL_RG:		components = 2;	break;
+		case GL_RGB:
+		case GL_BGR:	components = 3;	break;
+		default:		components = 4;	break;
+	}
+	switch(type)
+	{
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:			return components;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:		return components * 2;
+		default:				return components * 4;
+	}
+}
+/*------------------------------------------------------------------------------
+	Resource thread: compile and link, as oglh_install_shader does
+------------------------------------------------------------------------------*/
+static GLuint compile_shader(RESOURCE_REQUEST *request, GLenum shader_type)
+{
+	char *source;
+	const GLchar *source_code;
+	GLuint shader_id;
+	GLint success;
+	int length;
+
+	if((source = oglh_read_shader_source(request->shader_name,
+		shader_type)) == NULL)
+	{
+		snprintf(request->message, OGLH_RESOURCE_MESSAGE_SIZE,
+			"can't read the %s shader of %.400s",
+			shader_type == GL_VERTEX_SHADER ? "vertex" : "fragment",
+			request->shader_name);
+		return 0;
+	}
+
+	source_code = source;
+	shader_id = glCreateShader(shader_type);
+	glShaderSource(shader_id, 1, &source_code, NULL);
+	glCompileShader(shader_id);
+	free(source);
+
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+	if(!success)
+	{
+		length = snprintf(request->message, OGLH_RESOURCE_MESSAGE_SIZE,
+			"GLSL compiling shader '%.400s' failed:\n", request->shader_name);
+		glGetShaderInfoLog(shader_id, OGLH_RESOURCE_MESSAGE_SIZE - length,
+			NULL, request->message + length);
+		glDeleteShader(shader_id);
+		return 0;
+	}
+	return shader_id;
+}
+
+static void make_program(RESOURCE_REQUEST *request)
+{
+	GLuint vertex_shader_id, fragment_shader_id, program_id;
+	GLint success;
+
+	if((vertex_shader_id = compile_shader(request, GL_VERTEX_SHADER)) == 0)
+		return;
+	if((fragment_shader_id = compile_shader(request, GL_FRAGMENT_SHADER)) == 0)
+	{
+		glDeleteShader(vertex_shader_id);
+		return;
+	}
+
+	program_id = glCreateProgram();
+	glAttachShader(program_id, vertex_shader_id);
+	glAttachShader(program_id, fragment_shader_id);
+	glLinkProgram(program_id);
+	glDetachShader(program_id, vertex_shader_id);
+	glDetachShader(program_id, fragment_shader_id);
+	glDeleteShader(vertex_shader_id);
+	glDeleteShader(fragment_shader_id);
+
+	glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		snprintf(request->message, OGLH_RESOURCE_MESSAGE_SIZE,
+			"GLSL linking\tfile %.400s failed", request->shader_name);
+		glDeleteProgram(program_id);
+		return;
+	}
+	request->object_id = program_id;
+}
+/*------------------------------------------------------------------------------
+	Resource thread: buffers and textures, through bindings the rendering
+	context doesn't see
+------------------------------------------------------------------------------*/
+static void make_buffer(RESOURCE_REQUEST *request)
+{
+	GLuint buffer_id;
+
+	glGenBuffers(1, &buffer_id);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_id);
+	glBufferData(GL_COPY_WRITE_BUFFER, request->size, request->data,
+		request->usage);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if(glGetError() == GL_OUT_OF_MEMORY)
+	{
+		snprintf(request->message, OGLH_RESOURCE_MESSAGE_SIZE,
+			"no memory for a buffer of %ld bytes", (long)request->size);
+		glDeleteBuffers(1, &buffer_id);
+		return;
+	}
+	request->object_id = buffer_id;
+}
+
+static int texture_levels(RESOURCE_REQUEST *request)
+{
+	int levels = 1, size;
+
+	if(request->mipmaps)
+	{
+		for(size = request->width > request->height ?
+			request->width : request->height; size > 1; size >>= 1)
+		{
+			levels++;
+		}
+	}
+	return levels;
+}
+
+static void make_texture(RESOURCE_REQUEST *request)
+{
+	GLuint texture_id;
+	int levels = texture_levels(request);
+
+	// rows are tightly packed, whatever their length
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+	if(resources.have_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, request->internal_format,
+			request->width, request->height);
+		if(request->data != NULL)
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, request->width,
+				request->height, request->format, request->type, request->data);
+		}
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, request->internal_format,
+			request->width, request->height, 0, request->format, request->type,
+			request->data);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		request->mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if(request->mipmaps && request->data != NULL)
+		glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if(glGetError() != GL_NO_ERROR)
+	{
+		snprintf(request->message, OGLH_RESOURCE_MESSAGE_SIZE,
+			"can't make a %d x %d texture of format 0x%x", request->width,
+			request->height, request->internal_format);
+		glDeleteTextures(1, &texture_id);
+		return;
+	}
+	request->object_id = texture_id;
+}
+/*------------------------------------------------------------------------------
+	Resource thread
+------------------------------------------------------------------------------*/
+static void *resource_thread(void *unused)
+{
+	RESOURCE_REQUEST *request;
+	struct timespec start, end;
+
+	(void)unused;
+	pthread_mutex_lock(&resources.lock);
+	resources.context_made = resources.context(true, resources.context_data);
+	if(!resources.context_made) resources.quit = true;
+	pthread_cond_broadcast(&resources.changed);
+
+	for(;;)
+	{
+		while(resources.pending == NULL && !resources.quit)
+			pthread_cond_wait(&resources.changed, &resources.lock);
+		if(resources.quit) break;
+
+		request = take(&resources.pending, &resources.pending_tail);
+		resources.working = true;
+		pthread_mutex_unlock(&resources.lock);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		glGetError();		// don't blame this request for an older error
+		switch(request->kind)
+		{
+			case OGLH_RESOURCE_PROGRAM:	make_program(request);	break;
+			case OGLH_RESOURCE_BUFFER:	make_buffer(request);	break;
+			case OGLH_RESOURCE_TEXTURE:	make_texture(request);	break;
+		}
+		// flushed, or the rendering context could wait on it forever
+		request->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		pthread_mutex_lock(&resources.lock);
+		resources.statistics.busy_ms += milliseconds_between(&start, &end);
+		append(&resources.done, &resources.done_tail, request);
+		resources.working = false;
+		pthread_cond_broadcast(&resources.changed);
+	}
+	pthread_mutex_unlock(&resources.lock);
+
+	if(resources.context_made)
+	{
+		glFinish();
+		resources.context(false, resources.context_data);
+	}
+	return NULL;
+}
+/*------------------------------------------------------------------------------
+	Rendering thread. False if the resource thread couldn't make its
+	context; requests then fail as they are queued.
+------------------------------------------------------------------------------*/
+bool oglh_resources_start(OGLH_RESOURCE_CONTEXT context, void *context_data)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(resources.active) return true;
+
+	memset(&resources, 0, sizeof(resources));
+	resources.context = context;
+	resources.context_data = context_data;
+	pthread_mutex_init(&resources.lock, NULL);
+	pthread_cond_init(&resources.changed, NULL);
+
+	// asked here, the shared context is the same driver's
+	resources.have_texture_storage = oglh_gl_version_or_extension(42,
+		"GL_ARB_texture_storage");
+
+	// finish what the new context may share before it shares it
+	glFlush();
+	if(pthread_create(&resources.thread, NULL, resource_thread, NULL))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't start the resource thread");
+		return false;
+	}
+
+	pthread_mutex_lock(&resources.lock);
+	while(!resources.context_made && !resources.quit)
+		pthread_cond_wait(&resources.changed, &resources.lock);
+	pthread_mutex_unlock(&resources.lock);
+
+	if(!resources.context_made)
+	{
+		pthread_join(resources.thread, NULL);
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"the resource thread has no shared context");
+		return false;
+	}
+
+	resources.active = true;
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static RESOURCE_REQUEST *new_request(int kind, void *user_data)
+{
+	RESOURCE_REQUEST *request;
+
+	if(!resources.active)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"oglh_resources_start hasn't been called");
+		return NULL;
+	}
+	if((request = calloc(1, sizeof(RESOURCE_REQUEST))) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for a resource request");
+		return NULL;
+	}
+
+	request->kind = kind;
+	request->user_data = user_data;
+	request->request = ++resources.next_request;
+	return request;
+}
+
+static int queue_request(RESOURCE_REQUEST *request)
+{
+	pthread_mutex_lock(&resources.lock);
+	append(&resources.pending, &resources.pending_tail, request);
+	resources.statistics.requested++;
+	resources.statistics.pending++;
+	pthread_cond_broadcast(&resources.changed);
+	pthread_mutex_unlock(&resources.lock);
+	return request->request;
+}
+
+int oglh_resources_install_shader(const char *shader_name, void *user_data)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if((request = new_request(OGLH_RESOURCE_PROGRAM, user_data)) == NULL)
+		return 0;
+	snprintf(request->shader_name, FILENAME_MAX, "%s", shader_name);
+	return queue_request(request);
+}
+
+int oglh_resources_create_buffer
+(
+	GLsizeiptr size, const void *data, GLenum usage, void *user_data
+)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if((request = new_request(OGLH_RESOURCE_BUFFER, user_data)) == NULL)
+		return 0;
+	request->size = size;
+	request->data = data;
+	request->usage = usage;
+	return queue_request(request);
+}
+
+int oglh_resources_create_texture
+(
+	GLsizei width, GLsizei height, GLenum internal_format, GLenum format,
+	GLenum type, const void *pixels, bool mipmaps, void *user_data
+)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if(width <= 0 || height <= 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"texture is %d x %d", width, height);
+		return 0;
+	}
+	if((request = new_request(OGLH_RESOURCE_TEXTURE, user_data)) == NULL)
+		return 0;
+	request->width = width;
+	request->height = height;
+	request->internal_format = internal_format;
+	request->format = format;
+	request->type = type;
+	request->data = pixels;
+	request->mipmaps = mipmaps;
+	return queue_request(request);
+}
+/*------------------------------------------------------------------------------
+	Rendering thread: the object is the rendering context's now, make it
+	look as though it had been made here
+------------------------------------------------------------------------------*/
+static void adopt(RESOURCE_REQUEST *request)
+{
+	switch(request->kind)
+	{
+		case OGLH_RESOURCE_PROGRAM:
+			oglh_registry_add(OGLH_OBJECT_PROGRAM, request->object_id,
+				request->shader_name);
+			oglh_texture_units_assign_samplers(request->object_id);
+		break;
+
+		case OGLH_RESOURCE_BUFFER:
+			oglh_registry_add(OGLH_OBJECT_BUFFER, request->object_id, NULL);
+			oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, request->object_id,
+				request->size);
+			resources.statistics.bytes += request->size;
+		break;
+
+		case OGLH_RESOURCE_TEXTURE:
+			oglh_registry_add(OGLH_OBJECT_TEXTURE, request->object_id, NULL);
+			oglh_registry_set_image(OGLH_OBJECT_TEXTURE, request->object_id,
+				request->internal_format, request->width, request->height, 1,
+				texture_levels(request));
+			if(request->data != NULL)
+			{
+				resources.statistics.bytes += (long)request->width *
+					request->height * texel_bytes(request->format, request->type);
+			}
+		break;
+	}
+}
+
+static bool complete(RESOURCE_REQUEST *request, GLuint64 timeout,
+	OGLH_RESOURCE_COMPLETION *completion)
+{
+	GLenum status = glClientWaitSync(request->fence, 0, timeout);
+
+	if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+	glDeleteSync(request->fence);
+
+	if(request->object_id != 0)
+	{
+		adopt(request);
+		resources.statistics.completed++;
+	}
+	else
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__, "%s",
+			request->message);
+		resources.statistics.failed++;
+	}
+	resources.statistics.pending--;
+
+	completion->request = request->request;
+	completion->kind = request->kind;
+	completion->object_id = request->object_id;
+	completion->user_data = request->user_data;
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Rendering thread: the next request that is done, if there is one,
+	without waiting for it
+------------------------------------------------------------------------------*/
+bool oglh_resources_poll(OGLH_RESOURCE_COMPLETION *completion)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!resources.active) return false;
+
+	pthread_mutex_lock(&resources.lock);
+	request = resources.done;
+	pthread_mutex_unlock(&resources.lock);
+
+	// only the rendering thread takes from the done queue
+	if(request == NULL || !complete(request, 0, completion)) return false;
+
+	pthread_mutex_lock(&resources.lock);
+	take(&resources.done, &resources.done_tail);
+	pthread_mutex_unlock(&resources.lock);
+	free(request);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Rendering thread: waits until everything queued has been done, the
+	completions are still there to poll
+------------------------------------------------------------------------------*/
+void oglh_resources_finish(void)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!resources.active) return;
+
+	pthread_mutex_lock(&resources.lock);
+	while(resources.pending != NULL || resources.working)
+		pthread_cond_wait(&resources.changed, &resources.lock);
+	for(request = resources.done; request != NULL; request = request->next)
+		glClientWaitSync(request->fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+	pthread_mutex_unlock(&resources.lock);
+}
+/*------------------------------------------------------------------------------
+	Rendering thread: requests not yet done are dropped, and objects done
+	but never polled are deleted
+------------------------------------------------------------------------------*/
+void oglh_resources_stop(void)
+{
+	RESOURCE_REQUEST *request;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!resources.active) return;
+
+	pthread_mutex_lock(&resources.lock);
+	resources.quit = true;
+	pthread_cond_broadcast(&resources.changed);
+	pthread_mutex_unlock(&resources.lock);
+	pthread_join(resources.thread, NULL);
+
+	while((request = take(&resources.pending, &resources.pending_tail)) != NULL)
+		free(request);
+	while((request = take(&resources.done, &resources.done_tail)) != NULL)
+	{
+		glDeleteSync(request->fence);
+		switch(request->kind)
+		{
+			case OGLH_RESOURCE_PROGRAM:	glDeleteProgram(request->object_id);		break;
+			case OGLH_RESOURCE_BUFFER:	glDeleteBuffers(1, &request->object_id);	break;
+			case OGLH_RESOURCE_TEXTURE:	glDeleteTextures(1, &request->object_id);	break;
+		}
+		free(request);
+	}
+
+	pthread_cond_destroy(&resources.changed);
+	pthread_mutex_destroy(&resources.lock);
+	resources.active = false;	// the statistics stay for reading
+	resources.statistics.pending = 0;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+
+void oglh_resources_get_statistics(OGLH_RESOURCE_STATISTICS *statistics)
+{
+	if(resources.active) pthread_mutex_lock(&resources.lock);
+	*statistics = resources.statistics;
+	if(resources.active) pthread_mutex_unlock(&resources.lock);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,96 @@
+/*------------------------------------------------------------------------------
+	oglh_ resource thread -- shaders, buffers and textures made off the
+	frame
+
+	oglh_install_shader and the upload helpers make the rendering thread
+	wait while the driver compiles, links or copies. The resource thread
+	has a second context that shares objects with the rendering one and
+	does that work there instead. Each request ends with a fence, and the
+	object is handed back through a completion queue once the fence has
+	signalled -- by then it is ready to use in the rendering context.
+
+	oglh_resources_start(oglh_headless_shared_context, NULL);
+	int terrain = oglh_resources_install_shader("terrain", NULL);
+	oglh_resources_create_buffer(bytes, vertices, GL_STATIC_DRAW, NULL);
+	while(running)
+	{
+		OGLH_RESOURCE_COMPLETION done;
+		while(oglh_resources_poll(&done))
+			if(done.request == terrain) terrain_program = done.object_id;
+		... draw ...
+	}
+	oglh_resources_stop();
+
+	The context is the application's to make: the callback is called on
+	the resource thread with make_current true to make a context sharing
+	the rendering one's objects current, and with false when the thread
+	ends to release and destroy it. With GLFW, for example, a hidden
+	window made with the rendering window as its share does. For headless
+	contexts OpenGL_headless.h has oglh_headless_shared_context.
+
+	Requests are done in the order they are queued. Data passed to a
+	buffer or texture request is read on the resource thread so it must
+	stay as it is until that request's completion has been polled. Objects
+	are registered (OpenGL_registry.h) as they are polled, and a program
+	has its samplers given units then -- it isn't made current. Vertex
+	arrays and framebuffers aren't shared between contexts, so they are
+	not made here. Programs are compiled from their files as they are,
+	without the instancing (OpenGL_instancing.h) and indirect
+	(OpenGL_indirect.h) rewrites; install those with oglh_install_shader.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_RESOURCE_PROGRAM		1
+#define OGLH_RESOURCE_BUFFER		2
+#define OGLH_RESOURCE_TEXTURE		3
+
+#define OGLH_RESOURCE_MESSAGE_SIZE	512
+
+typedef bool (*OGLH_RESOURCE_CONTEXT)(bool make_current, void *user_data);
+
+typedef struct oglh_resource_completion
+{
+	int request;			// as returned when it was queued
+	int kind;				// OGLH_RESOURCE_PROGRAM, _BUFFER or _TEXTURE
+	GLuint object_id;		// 0 if it failed, and a warning has been given
+	void *user_data;
+}
+OGLH_RESOURCE_COMPLETION;
+
+typedef struct oglh_resource_statistics
+{
+	long requested;
+	long completed;
+	long failed;
+	long bytes;				// uploaded
+	double busy_ms;			// the resource thread spent working
+	int pending;			// queued or waiting on a fence
+}
+OGLH_RESOURCE_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_resources_start(OGLH_RESOURCE_CONTEXT context, void *context_data);
+void oglh_resources_stop(void);
+
+// the request number, or 0 if it couldn't be queued
+int oglh_resources_install_shader(const char *shader_name, void *user_data);
+int oglh_resources_create_buffer	// bind it to any target once it's done
+(
+	GLsizeiptr size, const void *data, GLenum usage, void *user_data
+);
+int oglh_resources_create_texture
+(
+	GLsizei width, GLsizei height, GLenum internal_format, GLenum format,
+	GLenum type, const void *pixels, bool mipmaps, void *user_data
+);
+
+bool oglh_resources_poll(OGLH_RESOURCE_COMPLETION *completion);
+void oglh_resources_finish(void);		// waits for every request
+void oglh_resources_get_statistics(OGLH_RESOURCE_STATISTICS *statistics);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
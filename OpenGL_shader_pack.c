@@ -0,0 +1,278 @@
+/*------------------------------------------------------------------------------
+	oglh_ shader packs -- every shader in one file
+
+	The pack is checked through once when it is opened -- every offset in
+	range, every name terminated, the table in order -- so lookups can
+	trust it and are a binary search with no copying. Files come back as
+	pointers into the mapping and aren't terminated; the loader copies
+	them into its own buffer.
+------------------------------------------------------------------------------*/
+#include "OpenGL_shader_pack.h"
+#include "OpenGL_trace.h"
+#include "OpenGL_counted_calls.h"
+#include <fcntl.h>			//	open
+#include <sys/mman.h>		//	mmap
+#include <sys/stat.h>		//	fstat
+#include <unistd.h>			//	close
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static struct
+{
+	const unsigned char *base;			// NULL with no pack open
+	size_t bytes;
+	bool mapped;
+	const OGLH_SHADER_PACK_HEADER *header;
+	const OGLH_SHADER_PACK_ENTRY *entry;
+	OGLH_SHADER_PACK_STATISTICS statistics;
+}
+pack;
+
+static const char *entry_name(const OGLH_SHADER_PACK_ENTRY *entry)
+{
+	return (const char *)pack.base + entry->name_offset;
+}
+
+static bool terminated_in_pack(const unsigned char *base, size_t bytes,
+	uint32_t offset)
+{
+	return offset < bytes && memchr(base + offset, '\0', bytes - offset) != NULL;
+}
+/*------------------------------------------------------------------------------
+	Becomes the open pack if it is sound
+------------------------------------------------------------------------------*/
+static bool adopt(const unsigned char *base, size_t bytes, const char *what)
+{
+	const OGLH_SHADER_PACK_HEADER *header = (const OGLH_SHADER_PACK_HEADER *)base;
+	const OGLH_SHADER_PACK_ENTRY *entry;
+	uint32_t index;
+
+	if(bytes < sizeof(*header) || (uintptr_t)base % 8 != 0 ||
+		memcmp(header->magic, OGLH_SHADER_PACK_MAGIC, sizeof(header->magic)) ||
+		header->bytes > bytes || header->entry_count >
+		(header->bytes - sizeof(*header)) / sizeof(OGLH_SHADER_PACK_ENTRY) ||
+		(header->renderer_offset != 0 &&
+		!terminated_in_pack(base, header->bytes, header->renderer_offset)))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"%s isn't a shader pack", what);
+		return false;
+	}
+
+	bytes = header->bytes;
+	entry = (const OGLH_SHADER_PACK_ENTRY *)(header + 1);
+	for(index = 0; index < header->entry_count; index++)
+	{
+		if(!terminated_in_pack(base, bytes, entry[index].name_offset) ||
+			entry[index].data_offset > bytes ||
+			entry[index].data_bytes > bytes - entry[index].data_offset ||
+			(index > 0 && strcmp((const char *)base + entry[index - 1].name_offset,
+			(const char *)base + entry[index].name_offset) >= 0))
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"shader pack %s is damaged at entry %u", what, index);
+			return false;
+		}
+	}
+
+	oglh_shader_pack_close();
+	pack.base = base;
+	pack.bytes = bytes;
+	pack.header = header;
+	pack.entry = entry;
+	memset(&pack.statistics, 0, sizeof(pack.statistics));
+	for(index = 0; index < header->entry_count; index++)
+	{
+		if(entry[index].binary_format == 0)
+			pack.statistics.sources++;
+		else
+			pack.statistics.binaries++;
+	}
+	printf("Shader pack\t\t: %s, %d files, %d binaries\n", what,
+		pack.statistics.sources, pack.statistics.binaries);
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_shader_pack_open(const char *file_name)
+{
+	struct stat file_status;
+	void *mapping;
+	int file;
+
+	OGLH_NOTE_CALL_SITE();
+	if((file = open(file_name, O_RDONLY)) < 0)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't open shader pack %s", file_name);
+		return false;
+	}
+
+	if(fstat(file, &file_status) != 0 || file_status.st_size <= 0 ||
+		(mapping = mmap(NULL, file_status.st_size, PROT_READ, MAP_PRIVATE,
+		file, 0)) == MAP_FAILED)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't map shader pack %s", file_name);
+		close(file);
+		return false;
+	}
+	close(file);
+
+	if(!adopt(mapping, file_status.st_size, file_name))
+	{
+		munmap(mapping, file_status.st_size);
+		return false;
+	}
+	pack.mapped = true;
+	return true;
+}
+
+bool oglh_shader_pack_use_memory(const void *memory, size_t bytes)
+{
+	OGLH_NOTE_CALL_SITE();
+	return adopt(memory, bytes, "(in memory)");
+}
+
+void oglh_shader_pack_close(void)
+{
+	if(pack.base != NULL && pack.mapped)
+		munmap((void *)pack.base, pack.bytes);
+	memset(&pack, 0, sizeof(pack));
+}
+
+void oglh_shader_pack_get_statistics(OGLH_SHADER_PACK_STATISTICS *statistics)
+{
+	*statistics = pack.statistics;
+}
+/*------------------------------------------------------------------------------
+	The entry named, sources or binaries, or NULL
+------------------------------------------------------------------------------*/
+static const OGLH_SHADER_PACK_ENTRY *find_entry(const char *name, bool binary)
+{
+	const OGLH_SHADER_PACK_ENTRY *entry;
+	uint32_t low = 0, high;
+	int order;
+
+	if(pack.base == NULL) return NULL;
+
+	high = pack.header->entry_count;
+	while(low < high)
+	{
+		entry = &pack.entry[(low + high) / 2];
+		if((order = strcmp(name, entry_name(entry))) == 0)
+			return (entry->binary_format != 0) == binary ? entry : NULL;
+		if(order < 0)
+			high = (low + high) / 2;
+		else
+			low = (low + high) / 2 + 1;
+	}
+	return NULL;
+}
+
+const char *oglh_shader_pack_find(const char *file_name, size_t *bytes)
+{
+	const OGLH_SHADER_PACK_ENTRY *entry;
+
+	if((entry = find_entry(file_name, false)) == NULL) return NULL;
+
+	*bytes = entry->data_bytes;
+	return (const char *)pack.base + entry->data_offset;
+}
+
+bool oglh_shader_pack_loose_files(void)
+{
+#ifdef OGLH_SHADER_PACK_ONLY
+	return pack.base == NULL;
+#else
+	return true;
+#endif
+}
+/*------------------------------------------------------------------------------
+	FNV-1a over both sources, with the terminator between them
+------------------------------------------------------------------------------*/
+static uint64_t hash_text(uint64_t hash, const char *text)
+{
+	do
+	{
+		hash = (hash ^ (unsigned char)*text) * 0x100000001b3ull;
+	}
+	while(*text++ != '\0');
+	return hash;
+}
+
+uint64_t oglh_shader_pack_hash
+(
+	const char *vertex_source, const char *fragment_source
+)
+{
+	return hash_text(hash_text(0xcbf29ce484222325ull, vertex_source),
+		fragment_source);
+}
+/*------------------------------------------------------------------------------
+	Called by oglh_install_shader before it compiles anything; true if the
+	program is linked from the pack's binary. Transform feedback programs
+	are always compiled, their varyings aren't in the sources.
+------------------------------------------------------------------------------*/
+static bool same_driver(void)
+{
+	char renderer[512];
+
+	snprintf(renderer, sizeof(renderer), "%s\n%s",
+		(const char *)glGetString(GL_RENDERER),
+		(const char *)glGetString(GL_VERSION));
+	return pack.header->renderer_offset != 0 && strcmp(renderer,
+		(const char *)pack.base + pack.header->renderer_offset) == 0;
+}
+
+bool oglh_shader_pack_load_binary(const char *shader_name, GLuint program_id)
+{
+	const OGLH_SHADER_PACK_ENTRY *entry;
+	char *vertex_source, *fragment_source;
+	uint64_t hash = 0;
+	GLint formats = 0, success = GL_FALSE;
+
+	if((entry = find_entry(shader_name, true)) == NULL) return false;
+
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if(formats > 0 && same_driver())
+	{
+		vertex_source = oglh_load_shader_source(shader_name, GL_VERTEX_SHADER);
+		fragment_source = oglh_load_shader_source(shader_name, GL_FRAGMENT_SHADER);
+		if(vertex_source != NULL && fragment_source != NULL)
+			hash = oglh_shader_pack_hash(vertex_source, fragment_source);
+
+		if(hash != 0 && hash == entry->source_hash)
+		{
+			glProgramBinary(program_id, entry->binary_format,
+				pack.base + entry->data_offset, entry->data_bytes);
+			glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+		}
+
+		// the trace hashes the sources as if they had been compiled
+		if(success)
+		{
+			OGLH_TRACE_HOOK(oglh_trace_shader_source(GL_VERTEX_SHADER,
+				vertex_source));
+			OGLH_TRACE_HOOK(oglh_trace_shader_source(GL_FRAGMENT_SHADER,
+				fragment_source));
+		}
+		free(vertex_source);
+		free(fragment_source);
+	}
+
+	// a binary GL won't take fails the link, it isn't a GL error
+	if(!success)
+	{
+		pack.statistics.binaries_rejected++;
+		return false;
+	}
+
+	printf("Program binary\t\t: %s\n", shader_name);
+	pack.statistics.binaries_loaded++;
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
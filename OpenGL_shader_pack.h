@@ -0,0 +1,88 @@
+/*------------------------------------------------------------------------------
+	oglh_ shader packs -- every shader in one file
+
+	oglh_install_shader reads shader_name.vert, shader_name.frag and
+	shader_name.h for every program, three opens apiece, which on network
+	storage is most of the start-up time. A shader pack holds them all in
+	one indexed file that is mapped once; with a pack open the shader loader
+	finds each file in the pack by its name, the name it would have opened,
+	and touches the filesystem only for files the pack doesn't have.
+
+	oglh_shader_pack_open("shaders.pack");
+	GLuint program = oglh_install_shader("shaders/phong");	// from the pack
+
+	or, with the pack compiled into the executable,
+
+	extern const unsigned char oglh_embedded_shader_pack[];
+	extern const size_t oglh_embedded_shader_pack_bytes;
+	oglh_shader_pack_use_memory(oglh_embedded_shader_pack,
+		oglh_embedded_shader_pack_bytes);
+
+	tools/oglh_shader_pack.c makes packs, and with -c the C file for the
+	embedded form. Run it from the directory the application runs in, so
+	the names match. Without a pack the loose files are used as always,
+	which is what to do while the shaders are being worked on; build with
+	OGLH_SHADER_PACK_ONLY to stop looking for loose files once a pack is
+	open.
+
+	A pack may also hold linked program binaries for one driver, with the
+	renderer and version they were built for. oglh_install_shader loads a
+	binary instead of compiling when the driver is the same and the sources
+	-- as the loader would hand them to GL, after any rewriting -- hash to
+	what the binary was built from, and compiles as usual otherwise.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+#include <stdint.h>			//	Fixed-width integer types
+/*------------------------------------------------------------------------------
+	The file: a header, the table sorted by name, the names, the data
+------------------------------------------------------------------------------*/
+#define OGLH_SHADER_PACK_MAGIC		"OGLHPAK1"
+
+typedef struct oglh_shader_pack_header
+{
+	char magic[8];
+	uint32_t bytes;					// the whole pack
+	uint32_t entry_count;
+	uint32_t renderer_offset;		// "GL_RENDERER\nGL_VERSION", 0 without binaries
+	uint32_t reserved;
+}
+OGLH_SHADER_PACK_HEADER;
+
+typedef struct oglh_shader_pack_entry
+{
+	uint32_t name_offset;			// offsets from the pack's start
+	uint32_t data_offset;
+	uint32_t data_bytes;
+	uint32_t binary_format;			// 0 for a source file
+	uint64_t source_hash;			// of what a binary was built from
+}
+OGLH_SHADER_PACK_ENTRY;
+
+typedef struct oglh_shader_pack_statistics
+{
+	int sources;					// files in the open pack
+	int binaries;
+	long binaries_loaded;
+	long binaries_rejected;			// wrong driver, changed sources, GL refused
+}
+OGLH_SHADER_PACK_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_shader_pack_open(const char *file_name);
+bool oglh_shader_pack_use_memory(const void *pack, size_t bytes);
+void oglh_shader_pack_close(void);
+void oglh_shader_pack_get_statistics(OGLH_SHADER_PACK_STATISTICS *statistics);
+
+// for the shader loader and the packer
+const char *oglh_shader_pack_find(const char *file_name, size_t *bytes);
+bool oglh_shader_pack_loose_files(void);
+bool oglh_shader_pack_load_binary(const char *shader_name, GLuint program_id);
+uint64_t oglh_shader_pack_hash
+(
+	const char *vertex_source, const char *fragment_source
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,639 @@
+/*------------------------------------------------------------------------------
+	oglh_ uniform snapshots -- a program's parameters saved and put back
+
+	A snapshot is a header, a table of entries, the values and the names,
+	in that order in one allocation. Offsets are from the snapshot's start
+	so it can be written and read back as it is. Each entry's values are
+	its array elements one after another, as glUniform*v takes them.
+------------------------------------------------------------------------------*/
+#include "OpenGL_snapshot.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+#include <stdint.h>			//	Fixed-width integer types
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define SNAPSHOT_MAGIC		"OGLHUNI1"
+
+typedef struct snapshot_entry
+{
+	GLint location;
+	GLenum type;
+	GLint size;					// array elements
+	GLint components;			// of one element, 16 for a mat4
+	uint32_t value_offset;
+	uint32_t name_offset;
+}
+SNAPSHOT_ENTRY;
+
+struct oglh_uniform_snapshot
+{
+	char magic[8];
+	uint32_t bytes;
+	GLuint program_id;
+	int32_t entries, skipped;
+	uint32_t values_offset, names_offset;
+	SNAPSHOT_ENTRY entry[];
+};
+/*------------------------------------------------------------------------------
+	What a type's elements are made of: 'f', 'd', 'i' or 'u', and how many
+------------------------------------------------------------------------------*/
+static char element_kind(const GLSL_UNIFORM_TYPE *uniform_type)
+{
+	switch(uniform_type->gl_type)
+	{
+		case GL_UNSIGNED_INT:
+		case GL_UNSIGNED_INT_VEC2:
+		case GL_UNSIGNED_INT_VEC3:
+		case GL_UNSIGNED_INT_VEC4:
+			return 'u';
+	}
+	return uniform_type->type[0];
+}
+
+static int element_components(const GLSL_UNIFORM_TYPE *uniform_type)
+{
+	int columns, rows;
+
+	// the table's count is a matrix's rows, not its size
+	if(sscanf(uniform_type->glsl_type_name, "mat%dx%d", &columns, &rows) == 2)
+		return columns * rows;
+	if(sscanf(uniform_type->glsl_type_name, "mat%d", &columns) == 1)
+		return columns * columns;
+	return uniform_type->count;
+}
+
+static int element_bytes(const SNAPSHOT_ENTRY *entry)
+{
+	return entry->components * (entry->type == GL_DOUBLE ? 8 : 4);
+}
+
+static const char *entry_name
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, const SNAPSHOT_ENTRY *entry
+)
+{
+	return (const char *)snapshot + snapshot->names_offset + entry->name_offset;
+}
+
+static const void *entry_values
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, const SNAPSHOT_ENTRY *entry
+)
+{
+	return (const char *)snapshot + snapshot->values_offset + entry->value_offset;
+}
+/*------------------------------------------------------------------------------
+	The active uniforms with locations and types that can be saved
+------------------------------------------------------------------------------*/
+typedef struct active_uniform
+{
+	GLint location;
+	GLint size;
+	const GLSL_UNIFORM_TYPE *uniform_type;
+	char *name;
+}
+ACTIVE_UNIFORM;
+
+static void read_values
+(
+	GLuint program_id, const SNAPSHOT_ENTRY *entry, const char *name,
+	char *values
+)
+{
+	char element_name[512];
+	size_t base_length;
+	GLint location, element;
+
+	// arrays are named name[0], the other elements have their own locations
+	base_length = strlen(name);
+	if(entry->size > 1 && base_length > 3 &&
+		strcmp(name + base_length - 3, "[0]") == 0)
+	{
+		base_length -= 3;
+	}
+
+	for(element = 0; element < entry->size; element++)
+	{
+		location = entry->location;
+		if(element > 0)
+		{
+			snprintf(element_name, sizeof(element_name), "%.*s[%d]",
+				(int)base_length, name, element);
+			location = glGetUniformLocation(program_id, element_name);
+		}
+
+		if(location >= 0)
+		{
+			switch(element_kind(oglh_find_uniform_variable_template(entry->type)))
+			{
+				case 'f':
+					glGetUniformfv(program_id, location, (GLfloat *)values);
+				break;
+
+				case 'd':
+					glGetUniformdv(program_id, location, (GLdouble *)values);
+				break;
+
+				case 'u':
+					glGetUniformuiv(program_id, location, (GLuint *)values);
+				break;
+
+				default:
+					glGetUniformiv(program_id, location, (GLint *)values);
+				break;
+			}
+		}
+		values += element_bytes(entry);
+	}
+}
+
+OGLH_UNIFORM_SNAPSHOT *oglh_uniform_snapshot_take(GLuint program_id)
+{
+	OGLH_UNIFORM_SNAPSHOT *snapshot = NULL;
+	ACTIVE_UNIFORM *active = NULL;
+	SNAPSHOT_ENTRY *entry;
+	GLint number = 0, max_length = 0, length, size, index;
+	GLenum gl_type;
+	GLSL_UNIFORM_TYPE *uniform_type;
+	char *names = NULL, *name;
+	int entries = 0, skipped = 0, components;
+	size_t values_bytes = 0, names_bytes = 0, header_bytes, bytes;
+
+	OGLH_NOTE_CALL_SITE();
+	if(program_id == 0 || !glIsProgram(program_id))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"%u isn't a program", program_id);
+		return NULL;
+	}
+
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &number);
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+	if(max_length < 1) max_length = 1;
+
+	active = calloc(number > 0 ? number : 1, sizeof(ACTIVE_UNIFORM));
+	names = calloc(number > 0 ? number : 1, max_length);
+	if(active == NULL || names == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for %d uniforms", number);
+		goto done;
+	}
+
+	for(index = 0; index < number; index++)
+	{
+		name = names + (size_t)entries * max_length;
+		glGetActiveUniform(program_id, index, max_length, &length, &size,
+			&gl_type, name);
+
+		// built in, or in a uniform block
+		if((active[entries].location = glGetUniformLocation(program_id, name)) < 0)
+			continue;
+
+		uniform_type = oglh_find_uniform_variable_template(gl_type);
+		if(uniform_type->gl_type_name == NULL)
+		{
+			skipped++;
+			continue;
+		}
+
+		components = element_components(uniform_type);
+		values_bytes += (size_t)size * components *
+			(gl_type == GL_DOUBLE ? 8 : 4);
+		names_bytes += length + 1;
+		active[entries].size = size;
+		active[entries].uniform_type = uniform_type;
+		active[entries].name = name;
+		entries++;
+	}
+
+	// the values 8 byte aligned, for doubles
+	header_bytes = sizeof(OGLH_UNIFORM_SNAPSHOT) + entries * sizeof(SNAPSHOT_ENTRY);
+	header_bytes = (header_bytes + 7) & ~(size_t)7;
+	bytes = header_bytes + values_bytes + names_bytes;
+	if((snapshot = calloc(1, bytes)) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for a snapshot of %zu bytes", bytes);
+		goto done;
+	}
+
+	memcpy(snapshot->magic, SNAPSHOT_MAGIC, sizeof(snapshot->magic));
+	snapshot->bytes = bytes;
+	snapshot->program_id = program_id;
+	snapshot->entries = entries;
+	snapshot->skipped = skipped;
+	snapshot->values_offset = header_bytes;
+	snapshot->names_offset = header_bytes + values_bytes;
+
+	values_bytes = names_bytes = 0;
+	for(index = 0; index < entries; index++)
+	{
+		entry = &snapshot->entry[index];
+		entry->location = active[index].location;
+		entry->type = active[index].uniform_type->gl_type;
+		entry->size = active[index].size;
+		entry->components = element_components(active[index].uniform_type);
+		entry->value_offset = values_bytes;
+		entry->name_offset = names_bytes;
+
+		strcpy((char *)snapshot + snapshot->names_offset + names_bytes,
+			active[index].name);
+		read_values(program_id, entry, active[index].name,
+			(char *)snapshot + snapshot->values_offset + values_bytes);
+
+		values_bytes += (size_t)entry->size * element_bytes(entry);
+		names_bytes += strlen(active[index].name) + 1;
+	}
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+
+done:
+	free(active);
+	free(names);
+	return snapshot;
+}
+/*------------------------------------------------------------------------------
+	The entry in other for snapshot's entry index, or NULL. Snapshots of
+	the same program line up, others are searched by name.
+------------------------------------------------------------------------------*/
+static const SNAPSHOT_ENTRY *matching_entry
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, int index,
+	const OGLH_UNIFORM_SNAPSHOT *other
+)
+{
+	const char *name = entry_name(snapshot, &snapshot->entry[index]);
+	int other_index;
+
+	if(index < other->entries &&
+		strcmp(entry_name(other, &other->entry[index]), name) == 0)
+	{
+		return &other->entry[index];
+	}
+
+	for(other_index = 0; other_index < other->entries; other_index++)
+	{
+		if(strcmp(entry_name(other, &other->entry[other_index]), name) == 0)
+			return &other->entry[other_index];
+	}
+	return NULL;
+}
+
+static bool same_values
+(
+	const OGLH_UNIFORM_SNAPSHOT *a, const SNAPSHOT_ENTRY *entry_a,
+	const OGLH_UNIFORM_SNAPSHOT *b, const SNAPSHOT_ENTRY *entry_b
+)
+{
+	return entry_a->type == entry_b->type && entry_a->size == entry_b->size &&
+		memcmp(entry_values(a, entry_a), entry_values(b, entry_b),
+		(size_t)entry_a->size * element_bytes(entry_a)) == 0;
+}
+/*------------------------------------------------------------------------------
+	One glUniform*v call for the whole of an entry, in the current program
+------------------------------------------------------------------------------*/
+static void set_values(GLint location, const SNAPSHOT_ENTRY *entry, const void *data)
+{
+	GLint count = entry->size;
+
+	switch(entry->type)
+	{
+		case GL_FLOAT_MAT2:		glUniformMatrix2fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT3:		glUniformMatrix3fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT4:		glUniformMatrix4fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT2x3:	glUniformMatrix2x3fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT2x4:	glUniformMatrix2x4fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT3x2:	glUniformMatrix3x2fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT3x4:	glUniformMatrix3x4fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT4x2:	glUniformMatrix4x2fv(location, count, GL_FALSE, data);	return;
+		case GL_FLOAT_MAT4x3:	glUniformMatrix4x3fv(location, count, GL_FALSE, data);	return;
+		case GL_DOUBLE:			glUniform1dv(location, count, data);					return;
+	}
+
+	switch(element_kind(oglh_find_uniform_variable_template(entry->type)) * 8 +
+		entry->components)
+	{
+		case 'f' * 8 + 1:	glUniform1fv(location, count, data);	break;
+		case 'f' * 8 + 2:	glUniform2fv(location, count, data);	break;
+		case 'f' * 8 + 3:	glUniform3fv(location, count, data);	break;
+		case 'f' * 8 + 4:	glUniform4fv(location, count, data);	break;
+		case 'i' * 8 + 1:	glUniform1iv(location, count, data);	break;
+		case 'i' * 8 + 2:	glUniform2iv(location, count, data);	break;
+		case 'i' * 8 + 3:	glUniform3iv(location, count, data);	break;
+		case 'i' * 8 + 4:	glUniform4iv(location, count, data);	break;
+		case 'u' * 8 + 1:	glUniform1uiv(location, count, data);	break;
+		case 'u' * 8 + 2:	glUniform2uiv(location, count, data);	break;
+		case 'u' * 8 + 3:	glUniform3uiv(location, count, data);	break;
+		case 'u' * 8 + 4:	glUniform4uiv(location, count, data);	break;
+	}
+}
+/*------------------------------------------------------------------------------
+	current, if given, is what the program holds now: only the uniforms
+	that differ from it are set. False if a uniform wasn't found in the
+	program, the others are set all the same.
+------------------------------------------------------------------------------*/
+bool oglh_uniform_snapshot_restore
+(
+	GLuint program_id, const OGLH_UNIFORM_SNAPSHOT *snapshot,
+	const OGLH_UNIFORM_SNAPSHOT *current
+)
+{
+	const SNAPSHOT_ENTRY *entry, *current_entry;
+	GLint previous_program_id, location;
+	bool same_program, found_all = true;
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(snapshot == NULL || program_id == 0) return false;
+
+	same_program = snapshot->program_id == program_id;
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &previous_program_id);
+	oglh_state_use_program(program_id);
+
+	for(index = 0; index < snapshot->entries; index++)
+	{
+		entry = &snapshot->entry[index];
+
+		if(current != NULL &&
+			(current_entry = matching_entry(snapshot, index, current)) != NULL &&
+			same_values(snapshot, entry, current, current_entry))
+		{
+			continue;
+		}
+
+		location = same_program ? entry->location :
+			glGetUniformLocation(program_id, entry_name(snapshot, entry));
+		if(location < 0)
+		{
+			found_all = false;
+			continue;
+		}
+		set_values(location, entry, entry_values(snapshot, entry));
+	}
+
+	oglh_state_use_program(previous_program_id);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return found_all;
+}
+/*------------------------------------------------------------------------------
+	The values as comma separated numbers, NaN and infinity as null
+------------------------------------------------------------------------------*/
+static void write_values
+(
+	FILE *fptr, const OGLH_UNIFORM_SNAPSHOT *snapshot, const SNAPSHOT_ENTRY *entry
+)
+{
+	const void *values = entry_values(snapshot, entry);
+	char kind = element_kind(oglh_find_uniform_variable_template(entry->type));
+	long index, count = (long)entry->size * entry->components;
+	double value;
+
+	for(index = 0; index < count; index++)
+	{
+		if(index > 0) fputs(", ", fptr);
+		switch(kind)
+		{
+			case 'f':
+			case 'd':
+				value = kind == 'f' ? ((const GLfloat *)values)[index] :
+					((const GLdouble *)values)[index];
+				if(isfinite(value))
+					fprintf(fptr, kind == 'f' ? "%.9g" : "%.17g", value);
+				else
+					fputs("null", fptr);
+			break;
+
+			case 'u':
+				fprintf(fptr, "%u", ((const GLuint *)values)[index]);
+			break;
+
+			default:
+				fprintf(fptr, "%d", ((const GLint *)values)[index]);
+			break;
+		}
+	}
+}
+/*------------------------------------------------------------------------------
+	The report has a line for each uniform that differs
+------------------------------------------------------------------------------*/
+int oglh_uniform_snapshot_diff
+(
+	const OGLH_UNIFORM_SNAPSHOT *a, const OGLH_UNIFORM_SNAPSHOT *b,
+	FILE *report_fptr
+)
+{
+	const SNAPSHOT_ENTRY *entry, *other;
+	int index, differences = 0;
+
+	for(index = 0; index < a->entries; index++)
+	{
+		entry = &a->entry[index];
+		if((other = matching_entry(a, index, b)) != NULL &&
+			same_values(a, entry, b, other))
+		{
+			continue;
+		}
+
+		differences++;
+		if(report_fptr == NULL) continue;
+
+		fprintf(report_fptr, "%-24s ", entry_name(a, entry));
+		if(other == NULL)
+		{
+			fprintf(report_fptr, "only in the first\n");
+		}
+		else if(other->type != entry->type || other->size != entry->size)
+		{
+			fprintf(report_fptr, "%s[%d] -> %s[%d]\n",
+				oglh_find_uniform_variable_template(entry->type)->glsl_type_name,
+				entry->size,
+				oglh_find_uniform_variable_template(other->type)->glsl_type_name,
+				other->size);
+		}
+		else
+		{
+			write_values(report_fptr, a, entry);
+			fprintf(report_fptr, " -> ");
+			write_values(report_fptr, b, other);
+			fprintf(report_fptr, "\n");
+		}
+	}
+
+	for(index = 0; index < b->entries; index++)
+	{
+		if(matching_entry(b, index, a) != NULL) continue;
+
+		differences++;
+		if(report_fptr != NULL)
+		{
+			fprintf(report_fptr, "%-24s only in the second\n",
+				entry_name(b, &b->entry[index]));
+		}
+	}
+	return differences;
+}
+
+void oglh_uniform_snapshot_get_info
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, OGLH_UNIFORM_SNAPSHOT_INFO *info
+)
+{
+	memset(info, 0, sizeof(*info));
+	if(snapshot == NULL) return;
+
+	info->program_id = snapshot->program_id;
+	info->uniforms = snapshot->entries;
+	info->skipped = snapshot->skipped;
+	info->bytes = snapshot->bytes;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_uniform_snapshot_save
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, const char *file_name
+)
+{
+	FILE *snapshot_fptr;
+	bool written;
+
+	OGLH_NOTE_CALL_SITE();
+	if((snapshot_fptr = fopen(file_name, "wb")) == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't write %s", file_name);
+		return false;
+	}
+
+	written = fwrite(snapshot, snapshot->bytes, 1, snapshot_fptr) == 1;
+	if(fclose(snapshot_fptr) != 0) written = false;
+	if(!written)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"writing %s failed", file_name);
+	}
+	return written;
+}
+/*------------------------------------------------------------------------------
+	Everything in the file is checked before it is trusted
+------------------------------------------------------------------------------*/
+static bool valid_snapshot(const OGLH_UNIFORM_SNAPSHOT *snapshot, size_t bytes)
+{
+	const SNAPSHOT_ENTRY *entry;
+	GLSL_UNIFORM_TYPE *uniform_type;
+	size_t values_bytes, names_bytes;
+	int index;
+
+	if(bytes < sizeof(OGLH_UNIFORM_SNAPSHOT) ||
+		memcmp(snapshot->magic, SNAPSHOT_MAGIC, sizeof(snapshot->magic)) != 0 ||
+		snapshot->bytes != bytes || snapshot->entries < 0 ||
+		(size_t)snapshot->entries > (bytes - sizeof(OGLH_UNIFORM_SNAPSHOT)) /
+		sizeof(SNAPSHOT_ENTRY) ||
+		snapshot->values_offset < sizeof(OGLH_UNIFORM_SNAPSHOT) +
+		snapshot->entries * sizeof(SNAPSHOT_ENTRY) ||
+		snapshot->values_offset % 8 != 0 ||
+		snapshot->names_offset < snapshot->values_offset ||
+		snapshot->names_offset > bytes)
+	{
+		return false;
+	}
+
+	values_bytes = snapshot->names_offset - snapshot->values_offset;
+	names_bytes = bytes - snapshot->names_offset;
+	for(index = 0; index < snapshot->entries; index++)
+	{
+		entry = &snapshot->entry[index];
+		uniform_type = oglh_find_uniform_variable_template(entry->type);
+		if(uniform_type->gl_type_name == NULL || entry->size < 1 ||
+			entry->components != element_components(uniform_type) ||
+			entry->value_offset > values_bytes ||
+			(size_t)entry->size > (values_bytes - entry->value_offset) /
+			element_bytes(entry) ||
+			entry->name_offset >= names_bytes ||
+			memchr(entry_name(snapshot, entry), '\0',
+			names_bytes - entry->name_offset) == NULL)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+OGLH_UNIFORM_SNAPSHOT *oglh_uniform_snapshot_load(const char *file_name)
+{
+	OGLH_UNIFORM_SNAPSHOT *snapshot;
+	FILE *snapshot_fptr;
+	long bytes;
+
+	OGLH_NOTE_CALL_SITE();
+	if((snapshot_fptr = fopen(file_name, "rb")) == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't open %s", file_name);
+		return NULL;
+	}
+
+	fseek(snapshot_fptr, 0, SEEK_END);
+	bytes = ftell(snapshot_fptr);
+	rewind(snapshot_fptr);
+
+	if(bytes <= 0 || (snapshot = malloc(bytes)) == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't read %s", file_name);
+		fclose(snapshot_fptr);
+		return NULL;
+	}
+
+	if(fread(snapshot, bytes, 1, snapshot_fptr) != 1 ||
+		!valid_snapshot(snapshot, bytes))
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"%s isn't a uniform snapshot", file_name);
+		free(snapshot);
+		snapshot = NULL;
+	}
+	fclose(snapshot_fptr);
+
+	// locations are only good for the program they came from
+	if(snapshot != NULL) snapshot->program_id = 0;
+	return snapshot;
+}
+/*------------------------------------------------------------------------------
+	Names are GLSL identifiers with perhaps [n], they need no escaping
+------------------------------------------------------------------------------*/
+void oglh_uniform_snapshot_write_json
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, FILE *json_fptr
+)
+{
+	const SNAPSHOT_ENTRY *entry;
+	GLSL_UNIFORM_TYPE *uniform_type;
+	int index;
+
+	fprintf(json_fptr, "{\n\t\"program\": %u,\n\t\"skipped\": %d,\n",
+		snapshot->program_id, snapshot->skipped);
+	fprintf(json_fptr, "\t\"uniforms\":\n\t[\n");
+	for(index = 0; index < snapshot->entries; index++)
+	{
+		entry = &snapshot->entry[index];
+		uniform_type = oglh_find_uniform_variable_template(entry->type);
+		fprintf(json_fptr,
+			"\t\t{ \"name\": \"%s\", \"type\": \"%s\", \"glsl\": \"%s\", "
+			"\"location\": %d, \"size\": %d, \"value\": [",
+			entry_name(snapshot, entry), uniform_type->gl_type_name,
+			uniform_type->glsl_type_name, entry->location, entry->size);
+		write_values(json_fptr, snapshot, entry);
+		fprintf(json_fptr, "] }%s\n", index + 1 < snapshot->entries ? "," : "");
+	}
+	fprintf(json_fptr, "\t]\n}\n");
+}
+
+void oglh_uniform_snapshot_free(OGLH_UNIFORM_SNAPSHOT *snapshot)
+{
+	free(snapshot);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
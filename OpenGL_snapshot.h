@@ -0,0 +1,75 @@
+/*------------------------------------------------------------------------------
+	oglh_ uniform snapshots -- a program's parameters saved and put back
+
+	A snapshot holds the value of every active uniform of a program, of any
+	type in oglh_uniform_variable_type_table, arrays included, in a single
+	block of memory. Presets, undo and A/B comparisons are snapshots:
+
+	OGLH_UNIFORM_SNAPSHOT *before = oglh_uniform_snapshot_take(program);
+	... the user drags sliders ...
+	OGLH_UNIFORM_SNAPSHOT *after = oglh_uniform_snapshot_take(program);
+	oglh_uniform_snapshot_diff(before, after, stdout);	// what changed
+	oglh_uniform_snapshot_restore(program, before, after);	// undo
+	oglh_uniform_snapshot_free(before);
+	oglh_uniform_snapshot_free(after);
+
+	Restoring makes one glUniform*v call per uniform, a whole array in
+	one, and given a snapshot of what the program holds now it makes calls
+	only for the uniforms that differ. A snapshot restored to the program it
+	was taken from uses the locations it recorded, any other program --
+	the same shader relinked, or a snapshot loaded from a file -- is
+	matched by name.
+
+	oglh_uniform_snapshot_save writes the block as it is and
+	oglh_uniform_snapshot_load reads it back; oglh_uniform_snapshot_write_json
+	writes it for people and scripts. Uniforms in blocks have no location
+	and aren't saved, nor are types outside the table (images, say), which
+	are counted in skipped.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef struct oglh_uniform_snapshot OGLH_UNIFORM_SNAPSHOT;	// one malloc'd block
+
+typedef struct oglh_uniform_snapshot_info
+{
+	GLuint program_id;			// taken from, 0 if loaded
+	int uniforms;
+	int skipped;				// active uniforms of types that can't be saved
+	size_t bytes;				// of the whole snapshot
+}
+OGLH_UNIFORM_SNAPSHOT_INFO;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+OGLH_UNIFORM_SNAPSHOT *oglh_uniform_snapshot_take(GLuint program_id);
+bool oglh_uniform_snapshot_restore		// current may be NULL
+(
+	GLuint program_id, const OGLH_UNIFORM_SNAPSHOT *snapshot,
+	const OGLH_UNIFORM_SNAPSHOT *current
+);
+int oglh_uniform_snapshot_diff			// uniforms that differ, report may be NULL
+(
+	const OGLH_UNIFORM_SNAPSHOT *a, const OGLH_UNIFORM_SNAPSHOT *b,
+	FILE *report_fptr
+);
+void oglh_uniform_snapshot_get_info
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, OGLH_UNIFORM_SNAPSHOT_INFO *info
+);
+
+bool oglh_uniform_snapshot_save
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, const char *file_name
+);
+OGLH_UNIFORM_SNAPSHOT *oglh_uniform_snapshot_load(const char *file_name);
+void oglh_uniform_snapshot_write_json
+(
+	const OGLH_UNIFORM_SNAPSHOT *snapshot, FILE *json_fptr
+);
+void oglh_uniform_snapshot_free(OGLH_UNIFORM_SNAPSHOT *snapshot);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,497 @@
+/*------------------------------------------------------------------------------
+	oglh_ state cache -- GL state shadowed on the CPU
+
+	Each piece of state is a CACHED_VALUE, unknown until it is set or read
+	back from GL once. Capabilities and buffer targets the cache doesn't
+	know about go straight to GL every time.
+------------------------------------------------------------------------------*/
+#include "OpenGL_state.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_instancing.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+typedef struct cached_value
+{
+	bool known;
+	GLint value;
+}
+CACHED_VALUE;
+
+typedef struct framebuffer_buffers
+{
+	bool used;
+	GLuint frame_buffer_id;
+	CACHED_VALUE draw_buffer;
+	CACHED_VALUE read_buffer;
+}
+FRAMEBUFFER_BUFFERS;
+
+static const GLenum buffer_target[][2] =	// target, its binding
+{
+	{ GL_ARRAY_BUFFER,				GL_ARRAY_BUFFER_BINDING				},
+	{ GL_ELEMENT_ARRAY_BUFFER,		GL_ELEMENT_ARRAY_BUFFER_BINDING		},
+	{ GL_PIXEL_PACK_BUFFER,			GL_PIXEL_PACK_BUFFER_BINDING		},
+	{ GL_PIXEL_UNPACK_BUFFER,		GL_PIXEL_UNPACK_BUFFER_BINDING		},
+	{ GL_COPY_READ_BUFFER,			GL_COPY_READ_BUFFER_BINDING			},
+	{ GL_COPY_WRITE_BUFFER,			GL_COPY_WRITE_BUFFER_BINDING		},
+	{ GL_UNIFORM_BUFFER,			GL_UNIFORM_BUFFER_BINDING			},
+	{ GL_SHADER_STORAGE_BUFFER,		GL_SHADER_STORAGE_BUFFER_BINDING	},
+	{ GL_DRAW_INDIRECT_BUFFER,		GL_DRAW_INDIRECT_BUFFER_BINDING		},
+	{ GL_TRANSFORM_FEEDBACK_BUFFER,	GL_TRANSFORM_FEEDBACK_BUFFER_BINDING},
+	{ GL_TEXTURE_BUFFER,			GL_TEXTURE_BUFFER_BINDING			},
+	{ GL_QUERY_BUFFER,				GL_QUERY_BUFFER_BINDING				},
+};
+#define BUFFER_TARGETS		(int)(sizeof(buffer_target) / sizeof(buffer_target[0]))
+#define ELEMENT_ARRAY		1	// its index in buffer_target
+
+static const GLenum capability[] =
+{
+	GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST,
+	GL_RASTERIZER_DISCARD, GL_PRIMITIVE_RESTART, GL_FRAMEBUFFER_SRGB,
+	GL_PROGRAM_POINT_SIZE, GL_MULTISAMPLE,
+};
+#define CAPABILITIES		(int)(sizeof(capability) / sizeof(capability[0]))
+
+typedef struct state_cache
+{
+	CACHED_VALUE program;
+	CACHED_VALUE draw_framebuffer;
+	CACHED_VALUE read_framebuffer;
+	CACHED_VALUE renderbuffer;
+	CACHED_VALUE vertex_array;
+	CACHED_VALUE buffer[BUFFER_TARGETS];
+	CACHED_VALUE enabled[CAPABILITIES];
+	CACHED_VALUE blend_source;
+	CACHED_VALUE blend_destination;
+	bool viewport_known;
+	GLint viewport[4];
+	FRAMEBUFFER_BUFFERS framebuffer[OGLH_STATE_FRAMEBUFFERS];
+	int next_framebuffer;	// the entry to reuse when all are taken
+	OGLH_STATE_STATISTICS statistics;
+}
+STATE_CACHE;
+
+// the thread's oglh context's, see OpenGL_context.h
+static STATE_CACHE default_state;
+static _Thread_local STATE_CACHE *state = &default_state;
+/*------------------------------------------------------------------------------
+	True if the value is new, it is recorded either way
+------------------------------------------------------------------------------*/
+static bool update(CACHED_VALUE *cached, GLint value)
+{
+	if(cached->known && cached->value == value) return false;
+
+	cached->known = true;
+	cached->value = value;
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Counts a setter call, returns whether the GL call is needed
+------------------------------------------------------------------------------*/
+static bool needed(bool call)
+{
+	state->statistics.sets++;
+	if(!call) state->statistics.skipped++;
+	return call;
+}
+
+static int buffer_index(GLenum target)
+{
+	int index;
+
+	for(index = 0; index < BUFFER_TARGETS; index++)
+	{
+		if(buffer_target[index][0] == target) return index;
+	}
+	return -1;
+}
+
+static int capability_index(GLenum cap)
+{
+	int index;
+
+	for(index = 0; index < CAPABILITIES; index++)
+	{
+		if(capability[index] == cap) return index;
+	}
+	return -1;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_state_use_program(GLuint program_id)
+{
+	if(needed(update(&state->program, program_id)))
+		glUseProgram(program_id);
+}
+/*------------------------------------------------------------------------------
+	GL_FRAMEBUFFER binds both draw and read
+------------------------------------------------------------------------------*/
+void oglh_state_bind_framebuffer(GLenum target, GLuint frame_buffer_id)
+{
+	bool draw_changes, read_changes;
+
+	switch(target)
+	{
+		case GL_FRAMEBUFFER:
+			draw_changes = update(&state->draw_framebuffer, frame_buffer_id);
+			read_changes = update(&state->read_framebuffer, frame_buffer_id);
+			if(needed(draw_changes || read_changes))
+				glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer_id);
+		break;
+
+		case GL_DRAW_FRAMEBUFFER:
+			if(needed(update(&state->draw_framebuffer, frame_buffer_id)))
+				glBindFramebuffer(target, frame_buffer_id);
+		break;
+
+		case GL_READ_FRAMEBUFFER:
+			if(needed(update(&state->read_framebuffer, frame_buffer_id)))
+				glBindFramebuffer(target, frame_buffer_id);
+		break;
+
+		default:
+			oglh_program_error(__FILE__, __LINE__, __FUNC__,
+				"unrecognized framebuffer target: 0x%x", target);
+		break;
+	}
+}
+
+void oglh_state_bind_renderbuffer(GLuint render_buffer_id)
+{
+	if(needed(update(&state->renderbuffer, render_buffer_id)))
+		glBindRenderbuffer(GL_RENDERBUFFER, render_buffer_id);
+}
+/*------------------------------------------------------------------------------
+	Targets the cache doesn't know are bound every time
+------------------------------------------------------------------------------*/
+void oglh_state_bind_buffer(GLenum target, GLuint buffer_id)
+{
+	int index = buffer_index(target);
+
+	if(index < 0 || needed(update(&state->buffer[index], buffer_id)))
+		glBindBuffer(target, buffer_id);
+}
+/*------------------------------------------------------------------------------
+	Indexed bindings aren't cached, it's always a call, but glBindBufferBase
+	binds the generic target too and that is recorded
+------------------------------------------------------------------------------*/
+void oglh_state_bind_buffer_base(GLenum target, GLuint index, GLuint buffer_id)
+{
+	int target_index = buffer_index(target);
+
+	glBindBufferBase(target, index, buffer_id);
+	if(target_index >= 0)
+	{
+		state->buffer[target_index].known = true;
+		state->buffer[target_index].value = buffer_id;
+	}
+}
+
+void oglh_state_bind_vertex_array(GLuint vertex_array_id)
+{
+	if(needed(update(&state->vertex_array, vertex_array_id)))
+	{
+		glBindVertexArray(vertex_array_id);
+		state->buffer[ELEMENT_ARRAY].known = false;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	state->statistics.sets++;
+	if(state->viewport_known && state->viewport[0] == x &&
+		state->viewport[1] == y && state->viewport[2] == width &&
+		state->viewport[3] == height)
+	{
+		state->statistics.skipped++;
+		return;
+	}
+
+	glViewport(x, y, width, height);
+	state->viewport[0] = x;
+	state->viewport[1] = y;
+	state->viewport[2] = width;
+	state->viewport[3] = height;
+	state->viewport_known = true;
+}
+
+void oglh_state_enable(GLenum cap)
+{
+	int index = capability_index(cap);
+
+	if(index < 0 || needed(update(&state->enabled[index], GL_TRUE)))
+		glEnable(cap);
+}
+
+void oglh_state_disable(GLenum cap)
+{
+	int index = capability_index(cap);
+
+	if(index < 0 || needed(update(&state->enabled[index], GL_FALSE)))
+		glDisable(cap);
+}
+
+void oglh_state_blend_func(GLenum source_factor, GLenum destination_factor)
+{
+	bool source_changes, destination_changes;
+
+	source_changes = update(&state->blend_source, source_factor);
+	destination_changes = update(&state->blend_destination,
+		destination_factor);
+
+	if(needed(source_changes || destination_changes))
+		glBlendFunc(source_factor, destination_factor);
+}
+static void query(GLenum parameter, GLint *data);
+/*------------------------------------------------------------------------------
+	The draw and read buffers of a framebuffer, the entry made if need be
+------------------------------------------------------------------------------*/
+static FRAMEBUFFER_BUFFERS *framebuffer_buffers(GLenum binding)
+{
+	FRAMEBUFFER_BUFFERS *entry;
+	GLint frame_buffer_id;
+	int index;
+
+	query(binding, &frame_buffer_id);
+
+	for(index = 0; index < OGLH_STATE_FRAMEBUFFERS; index++)
+	{
+		entry = &state->framebuffer[index];
+		if(entry->used && entry->frame_buffer_id == (GLuint)frame_buffer_id)
+			return entry;
+	}
+
+	for(index = 0; index < OGLH_STATE_FRAMEBUFFERS; index++)
+	{
+		if(!state->framebuffer[index].used) break;
+	}
+	if(index == OGLH_STATE_FRAMEBUFFERS)
+	{
+		index = state->next_framebuffer;
+		state->next_framebuffer =
+			(state->next_framebuffer + 1) % OGLH_STATE_FRAMEBUFFERS;
+	}
+
+	entry = &state->framebuffer[index];
+	memset(entry, 0, sizeof(*entry));
+	entry->used = true;
+	entry->frame_buffer_id = frame_buffer_id;
+	return entry;
+}
+
+void oglh_state_draw_buffer(GLenum buffer)
+{
+	if(needed(update(
+		&framebuffer_buffers(GL_DRAW_FRAMEBUFFER_BINDING)->draw_buffer, buffer)))
+	{
+		glDrawBuffer(buffer);
+	}
+}
+
+void oglh_state_read_buffer(GLenum buffer)
+{
+	if(needed(update(
+		&framebuffer_buffers(GL_READ_FRAMEBUFFER_BINDING)->read_buffer, buffer)))
+	{
+		glReadBuffer(buffer);
+	}
+}
+/*------------------------------------------------------------------------------
+	Where a query's answer is kept, NULL if it isn't cached
+------------------------------------------------------------------------------*/
+static CACHED_VALUE *cached_value(GLenum parameter)
+{
+	int index;
+
+	switch(parameter)
+	{
+		case GL_CURRENT_PROGRAM:				return &state->program;
+		case GL_DRAW_FRAMEBUFFER_BINDING:		return &state->draw_framebuffer;
+		case GL_READ_FRAMEBUFFER_BINDING:		return &state->read_framebuffer;
+		case GL_RENDERBUFFER_BINDING:			return &state->renderbuffer;
+		case GL_VERTEX_ARRAY_BINDING:			return &state->vertex_array;
+
+		case GL_BLEND_SRC:
+		case GL_BLEND_SRC_RGB:
+		case GL_BLEND_SRC_ALPHA:				return &state->blend_source;
+
+		case GL_BLEND_DST:
+		case GL_BLEND_DST_RGB:
+		case GL_BLEND_DST_ALPHA:				return &state->blend_destination;
+
+		case GL_DRAW_BUFFER:
+		case GL_DRAW_BUFFER0:
+			return &framebuffer_buffers(GL_DRAW_FRAMEBUFFER_BINDING)->draw_buffer;
+
+		case GL_READ_BUFFER:
+			return &framebuffer_buffers(GL_READ_FRAMEBUFFER_BINDING)->read_buffer;
+	}
+
+	for(index = 0; index < BUFFER_TARGETS; index++)
+	{
+		if(buffer_target[index][1] == parameter) return &state->buffer[index];
+	}
+	if((index = capability_index(parameter)) >= 0)
+		return &state->enabled[index];
+
+	return NULL;
+}
+/*------------------------------------------------------------------------------
+	glGetIntegerv answered from the cache where it can be
+------------------------------------------------------------------------------*/
+static void query(GLenum parameter, GLint *data)
+{
+	CACHED_VALUE *cached;
+
+	if(parameter == GL_VIEWPORT)
+	{
+		if(!state->viewport_known)
+		{
+			state->statistics.forwarded++;
+			glGetIntegerv(GL_VIEWPORT, state->viewport);
+			state->viewport_known = true;
+		}
+		memcpy(data, state->viewport, sizeof(state->viewport));
+		return;
+	}
+
+	if((cached = cached_value(parameter)) == NULL)
+	{
+		state->statistics.forwarded++;
+		glGetIntegerv(parameter, data);
+		return;
+	}
+
+	if(!cached->known)
+	{
+		state->statistics.forwarded++;
+		glGetIntegerv(parameter, &cached->value);
+		cached->known = true;
+	}
+	*data = cached->value;
+}
+
+void oglh_state_get_integerv(GLenum parameter, GLint *data)
+{
+	state->statistics.queries++;
+	query(parameter, data);
+}
+
+bool oglh_state_is_enabled(GLenum cap)
+{
+	GLint enabled;
+
+	if(capability_index(cap) < 0)
+	{
+		state->statistics.queries++;
+		state->statistics.forwarded++;
+		return glIsEnabled(cap);
+	}
+
+	state->statistics.queries++;
+	query(cap, &enabled);
+	return enabled != GL_FALSE;
+}
+/*------------------------------------------------------------------------------
+	Called by the registry as an object is deleted: GL unbinds a deleted
+	buffer, framebuffer, renderbuffer or vertex array, a deleted program
+	stays in use until another is, but its name may come back as a new one
+------------------------------------------------------------------------------*/
+void oglh_state_forget_object(int object_type, GLuint object_id)
+{
+	int index;
+
+	switch(object_type)
+	{
+		case OGLH_OBJECT_BUFFER:
+			for(index = 0; index < BUFFER_TARGETS; index++)
+			{
+				if(state->buffer[index].value == (GLint)object_id)
+					state->buffer[index].value = 0;
+			}
+		break;
+
+		case OGLH_OBJECT_TEXTURE:
+			oglh_texture_units_forget_texture(object_id);
+		break;
+
+		case OGLH_OBJECT_RENDERBUFFER:
+			if(state->renderbuffer.value == (GLint)object_id)
+				state->renderbuffer.value = 0;
+		break;
+
+		case OGLH_OBJECT_FRAMEBUFFER:
+			if(state->draw_framebuffer.value == (GLint)object_id)
+				state->draw_framebuffer.value = 0;
+			if(state->read_framebuffer.value == (GLint)object_id)
+				state->read_framebuffer.value = 0;
+			for(index = 0; index < OGLH_STATE_FRAMEBUFFERS; index++)
+			{
+				if(state->framebuffer[index].frame_buffer_id == object_id)
+					state->framebuffer[index].used = false;
+			}
+		break;
+
+		case OGLH_OBJECT_VERTEX_ARRAY:
+			if(state->vertex_array.value == (GLint)object_id)
+			{
+				state->vertex_array.value = 0;
+				state->buffer[ELEMENT_ARRAY].known = false;
+			}
+		break;
+
+		case OGLH_OBJECT_PROGRAM:
+			if(state->program.value == (GLint)object_id)
+				state->program.known = false;
+			oglh_forget_uniform_locations(object_id);
+			oglh_texture_units_forget_program(object_id);
+			oglh_instancing_forget_program(object_id);
+		break;
+	}
+}
+/*------------------------------------------------------------------------------
+	Forget everything, textures bound on the texture units included, after
+	GL code outside the helpers has changed state
+------------------------------------------------------------------------------*/
+void oglh_state_invalidate(void)
+{
+	OGLH_STATE_STATISTICS statistics = state->statistics;
+
+	memset(state, 0, sizeof(*state));
+	state->statistics = statistics;
+	oglh_texture_units_invalidate();
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_state_get_statistics(OGLH_STATE_STATISTICS *statistics)
+{
+	*statistics = state->statistics;
+}
+/*------------------------------------------------------------------------------
+	The cache as a part of an oglh context, see OpenGL_context.h
+------------------------------------------------------------------------------*/
+void *oglh_state_new_context(void)
+{
+	return calloc(1, sizeof(STATE_CACHE));
+}
+
+void oglh_state_use_context(void *cache)
+{
+	state = cache != NULL ? cache : &default_state;
+}
+
+void oglh_state_delete_context(void *cache)
+{
+	if(cache == state) state = &default_state;
+	free(cache);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,75 @@
+/*------------------------------------------------------------------------------
+	oglh_ state cache -- GL state shadowed on the CPU
+
+	The helpers set the same state over and over: the program, the
+	framebuffer, the viewport, blending, draw and read buffers, buffer and
+	vertex array bindings. Each setter here remembers the value and skips
+	the GL call when it wouldn't change anything; oglh_state_get_integerv
+	answers from the cache rather than asking the driver, which can mean a
+	round trip to a driver thread.
+
+	oglh_state_use_program(program_id);		// glUseProgram, if it isn't
+	oglh_state_bind_framebuffer(GL_FRAMEBUFFER, fbo);
+	oglh_state_get_integerv(GL_VIEWPORT, viewport);	// no glGetIntegerv
+
+	Every oglh_ helper goes through the cache. Nothing is assumed at the
+	start -- a value is known once it has been set or asked for once. Code
+	that changes the same state with plain GL calls must call
+	oglh_state_invalidate afterwards, or the cache will skip calls that
+	were needed and answer queries wrongly.
+
+	Draw and read buffers belong to a framebuffer so they are remembered
+	per framebuffer, for the last OGLH_STATE_FRAMEBUFFERS used. The element
+	array buffer belongs to the vertex array and is forgotten when another
+	is bound. Objects deleted through the registry leave the cache as GL
+	leaves its bindings.
+
+	The cache belongs to the thread's current oglh context
+	(OpenGL_context.h), so each GL context can have its own.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_STATE_FRAMEBUFFERS		8	// draw and read buffers remembered
+
+typedef struct oglh_state_statistics
+{
+	long sets;			// setter calls
+	long skipped;		// setter calls that changed nothing
+	long queries;		// oglh_state_get_integerv calls
+	long forwarded;		// glGetIntegerv calls the cache had to make
+}
+OGLH_STATE_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_state_use_program(GLuint program_id);
+void oglh_state_bind_framebuffer(GLenum target, GLuint frame_buffer_id);
+void oglh_state_bind_renderbuffer(GLuint render_buffer_id);
+void oglh_state_bind_buffer(GLenum target, GLuint buffer_id);
+void oglh_state_bind_buffer_base(GLenum target, GLuint index, GLuint buffer_id);
+void oglh_state_bind_vertex_array(GLuint vertex_array_id);
+
+void oglh_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void oglh_state_enable(GLenum capability);
+void oglh_state_disable(GLenum capability);
+void oglh_state_blend_func(GLenum source_factor, GLenum destination_factor);
+void oglh_state_draw_buffer(GLenum buffer);
+void oglh_state_read_buffer(GLenum buffer);
+
+void oglh_state_get_integerv(GLenum parameter, GLint *data);
+bool oglh_state_is_enabled(GLenum capability);
+
+void oglh_state_forget_object(int object_type, GLuint object_id);
+void oglh_state_invalidate(void);
+void oglh_state_get_statistics(OGLH_STATE_STATISTICS *statistics);
+
+// for OpenGL_context.c
+void *oglh_state_new_context(void);
+void oglh_state_use_context(void *cache);
+void oglh_state_delete_context(void *cache);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
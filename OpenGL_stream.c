@@ -0,0 +1,296 @@
+/*------------------------------------------------------------------------------
+	oglh_ streaming buffers -- per-frame vertex and index data without
+	glBufferData
+
+	Persistent path, OGLH_STREAM_REGIONS regions of region_size bytes:
+
+	| region 0 | region 1 | region 2 |
+	  written    fenced     fenced		<- this frame writes region 0
+
+	oglh_stream_end_frame fences the region just written and moves on; the
+	first allocation in a region waits, if it must, for the fence from
+	OGLH_STREAM_REGIONS frames ago. With a GPU less than that many frames
+	behind the wait never happens.
+
+	Orphaning path, one region: the first allocation of a frame orphans the
+	buffer and maps it unsynchronized, later allocations after a flush map
+	just the unused tail. Nothing in the tail is in use by the GPU so the
+	driver needn't wait.
+
+	Build with OGLH_STREAM_ORPHANING to take the orphaning path even when
+	ARB_buffer_storage is available.
+------------------------------------------------------------------------------*/
+#include "OpenGL_stream.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+#include <time.h>			//	Time/date utilities
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define FENCE_WAIT_NS		1000000000	// a second, then ask again
+
+static bool have_buffer_storage(void)
+{
+#ifdef OGLH_STREAM_ORPHANING
+	return false;
+#else
+	return oglh_gl_version_or_extension(44, "GL_ARB_buffer_storage");
+#endif
+}
+/*------------------------------------------------------------------------------
+	region_size is the most a frame can allocate
+------------------------------------------------------------------------------*/
+bool oglh_stream_create
+(
+	OGLH_STREAM_BUFFER *stream, GLenum target, GLsizeiptr region_size
+)
+{
+	const GLbitfield persistent_flags =
+		GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(stream, 0, sizeof(*stream));
+	stream->target = target;
+	stream->region_size = region_size;
+
+	if(region_size <= 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"stream region size %ld", (long)region_size);
+		return false;
+	}
+
+	stream->buffer_id = oglh_registry_generate(OGLH_OBJECT_BUFFER);
+	oglh_state_bind_buffer(target, stream->buffer_id);
+
+	stream->persistent = have_buffer_storage();
+	if(stream->persistent)
+	{
+		glBufferStorage(target, region_size * OGLH_STREAM_REGIONS, NULL,
+			persistent_flags);
+		stream->mapping = glMapBufferRange(target, 0,
+			region_size * OGLH_STREAM_REGIONS, persistent_flags);
+
+		if(stream->mapping == NULL)
+		{
+			// storage is immutable, start again with a buffer we can orphan
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"persistent mapping failed, orphaning instead");
+			oglh_registry_delete(OGLH_OBJECT_BUFFER, stream->buffer_id);
+			stream->buffer_id = oglh_registry_generate(OGLH_OBJECT_BUFFER);
+			oglh_state_bind_buffer(target, stream->buffer_id);
+			stream->persistent = false;
+		}
+	}
+
+	if(!stream->persistent)
+		glBufferData(target, region_size, NULL, GL_STREAM_DRAW);
+
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, stream->buffer_id,
+		stream->persistent ? region_size * OGLH_STREAM_REGIONS : region_size);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return stream->buffer_id != 0;
+}
+/*------------------------------------------------------------------------------
+	Get the frame's region ready to be written
+------------------------------------------------------------------------------*/
+static void wait_for_region(OGLH_STREAM_BUFFER *stream)
+{
+	GLsync fence = stream->fence[stream->region];
+	struct timespec start, end;
+	GLenum status;
+
+	if(fence == NULL) return;
+
+	status = glClientWaitSync(fence, 0, 0);
+	if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+	{
+		stream->statistics.waits++;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do
+		{
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+				FENCE_WAIT_NS);
+		}
+		while(status == GL_TIMEOUT_EXPIRED);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		stream->statistics.wait_ms += (end.tv_sec - start.tv_sec) * 1e3 +
+			(end.tv_nsec - start.tv_nsec) * 1e-6;
+
+		if(status == GL_WAIT_FAILED)
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"waiting on stream region %d failed", stream->region);
+		}
+	}
+
+	glDeleteSync(fence);
+	stream->fence[stream->region] = NULL;
+}
+
+static void orphan_buffer(OGLH_STREAM_BUFFER *stream)
+{
+	oglh_state_bind_buffer(stream->target, stream->buffer_id);
+	glBufferData(stream->target, stream->region_size, NULL, GL_STREAM_DRAW);
+}
+/*------------------------------------------------------------------------------
+	The tail of the buffer past what's been allocated this frame
+------------------------------------------------------------------------------*/
+static bool map_tail(OGLH_STREAM_BUFFER *stream)
+{
+	oglh_state_bind_buffer(stream->target, stream->buffer_id);
+	stream->mapping = glMapBufferRange(stream->target, stream->used,
+		stream->region_size - stream->used,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+		GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	stream->mapped_from = stream->used;
+
+	if(stream->mapping == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"mapping stream buffer %u failed", stream->buffer_id);
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	A bump allocation from this frame's region. alignment is a power of two,
+	0 for OGLH_STREAM_ALIGNMENT. Fails, without touching the region, when
+	the allocation doesn't fit.
+------------------------------------------------------------------------------*/
+bool oglh_stream_allocate
+(
+	OGLH_STREAM_BUFFER *stream, GLsizeiptr size, GLsizeiptr alignment,
+	OGLH_STREAM_ALLOCATION *allocation
+)
+{
+	GLintptr offset;
+
+	OGLH_NOTE_CALL_SITE();
+	memset(allocation, 0, sizeof(*allocation));
+	if(alignment <= 0) alignment = OGLH_STREAM_ALIGNMENT;
+
+	offset = (stream->used + alignment - 1) & ~(GLintptr)(alignment - 1);
+	if(size <= 0 || offset + size > stream->region_size)
+	{
+		stream->statistics.overflows++;
+		return false;
+	}
+
+	if(!stream->region_ready)
+	{
+		if(stream->persistent)
+			wait_for_region(stream);
+		else
+			orphan_buffer(stream);
+		stream->region_ready = true;
+	}
+
+	if(stream->persistent)
+	{
+		allocation->offset = stream->region * stream->region_size + offset;
+		allocation->pointer = stream->mapping + allocation->offset;
+	}
+	else
+	{
+		if(stream->mapping == NULL && !map_tail(stream))
+			return false;
+
+		allocation->offset = offset;
+		allocation->pointer = stream->mapping + (offset - stream->mapped_from);
+	}
+
+	allocation->size = size;
+	allocation->buffer_id = stream->buffer_id;
+
+	stream->statistics.bytes += offset + size - stream->used;
+	stream->statistics.allocations++;
+	stream->used = offset + size;
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Makes what has been written visible to the GL. Leaves the stream's
+	buffer bound to its target on the orphaning path.
+------------------------------------------------------------------------------*/
+void oglh_stream_flush(OGLH_STREAM_BUFFER *stream)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(stream->persistent || stream->mapping == NULL) return;
+
+	oglh_state_bind_buffer(stream->target, stream->buffer_id);
+	glFlushMappedBufferRange(stream->target, 0,
+		stream->used - stream->mapped_from);
+	glUnmapBuffer(stream->target);
+	stream->mapping = NULL;
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Call once a frame, after the last draw that reads the stream
+------------------------------------------------------------------------------*/
+void oglh_stream_end_frame(OGLH_STREAM_BUFFER *stream)
+{
+	OGLH_NOTE_CALL_SITE();
+
+	if(stream->persistent)
+	{
+		if(stream->region_ready)
+		{
+			stream->fence[stream->region] =
+				glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		stream->region = (stream->region + 1) % OGLH_STREAM_REGIONS;
+	}
+	else
+	{
+		oglh_stream_flush(stream);
+	}
+
+	stream->used = 0;
+	stream->region_ready = false;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_stream_delete(OGLH_STREAM_BUFFER *stream)
+{
+	int region;
+
+	OGLH_NOTE_CALL_SITE();
+	if(stream->buffer_id == 0) return;
+
+	if(stream->mapping != NULL)
+	{
+		oglh_state_bind_buffer(stream->target, stream->buffer_id);
+		glUnmapBuffer(stream->target);
+	}
+
+	for(region = 0; region < OGLH_STREAM_REGIONS; region++)
+	{
+		if(stream->fence[region] != NULL)
+			glDeleteSync(stream->fence[region]);
+	}
+
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, stream->buffer_id);
+	memset(stream, 0, sizeof(*stream));
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_stream_get_statistics
+(
+	const OGLH_STREAM_BUFFER *stream, OGLH_STREAM_STATISTICS *statistics
+)
+{
+	*statistics = stream->statistics;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
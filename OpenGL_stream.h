@@ -0,0 +1,104 @@
+/*------------------------------------------------------------------------------
+	oglh_ streaming buffers -- per-frame vertex and index data without
+	glBufferData
+
+	A stream buffer is one buffer object split into OGLH_STREAM_REGIONS
+	regions, one per frame in flight. With ARB_buffer_storage (GL 4.4) it is
+	mapped once, persistently and coherently, so an allocation is a pointer
+	straight into memory the GPU reads -- write the vertices there and draw
+	from the offset, no copy and no glBufferData. Each region is fenced at
+	the end of its frame and only written again once that fence signals.
+
+	OGLH_STREAM_BUFFER particles;
+	OGLH_STREAM_ALLOCATION allocation;
+
+	oglh_stream_create(&particles, GL_ARRAY_BUFFER, 4 << 20);
+	while(running)
+	{
+		if(oglh_stream_allocate(&particles, n * sizeof(PARTICLE), 16,
+			&allocation))
+		{
+			memcpy(allocation.pointer, particle_data, n * sizeof(PARTICLE));
+			oglh_stream_flush(&particles);
+			glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer_id);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+				sizeof(PARTICLE), (void *)allocation.offset);
+			oglh_draw_arrays(GL_POINTS, 0, n);
+		}
+		oglh_stream_end_frame(&particles);
+	}
+	oglh_stream_delete(&particles);
+
+	Without ARB_buffer_storage the buffer is orphaned (glBufferData with
+	NULL) at the start of each frame and mapped unsynchronized; the pointers
+	are then only good until oglh_stream_flush, which must come before any
+	draw that reads them. Calling it in both cases keeps code portable -- it
+	costs nothing on the persistent path.
+
+	An allocation that doesn't fit in what is left of the frame's region
+	fails and is counted; size the region for the worst frame.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_STREAM_REGIONS			3	// frames the GPU may be behind by
+#define OGLH_STREAM_ALIGNMENT		16	// when allocate is given 0
+
+typedef struct oglh_stream_allocation
+{
+	void *pointer;			// where to write
+	GLintptr offset;		// the same place, in bytes into buffer_id
+	GLsizeiptr size;
+	GLuint buffer_id;
+}
+OGLH_STREAM_ALLOCATION;
+
+typedef struct oglh_stream_statistics
+{
+	long allocations;
+	long bytes;				// allocated, including alignment padding
+	long overflows;			// allocations that didn't fit
+	long waits;				// times a region's fence hadn't signalled
+	double wait_ms;			// time spent in those waits
+}
+OGLH_STREAM_STATISTICS;
+
+typedef struct oglh_stream_buffer	// the fields are private
+{
+	GLenum target;
+	GLuint buffer_id;
+	bool persistent;
+	GLsizeiptr region_size;
+	int region;						// the one being written this frame
+	GLintptr used;					// bytes of it allocated
+	GLsync fence[OGLH_STREAM_REGIONS];
+	unsigned char *mapping;			// persistent: the whole buffer
+	GLintptr mapped_from;			// orphaning: start of the live mapping
+	bool region_ready;				// fence waited or buffer orphaned
+	OGLH_STREAM_STATISTICS statistics;
+}
+OGLH_STREAM_BUFFER;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_stream_create
+(
+	OGLH_STREAM_BUFFER *stream, GLenum target, GLsizeiptr region_size
+);
+bool oglh_stream_allocate
+(
+	OGLH_STREAM_BUFFER *stream, GLsizeiptr size, GLsizeiptr alignment,
+	OGLH_STREAM_ALLOCATION *allocation
+);
+void oglh_stream_flush(OGLH_STREAM_BUFFER *stream);
+void oglh_stream_end_frame(OGLH_STREAM_BUFFER *stream);
+void oglh_stream_delete(OGLH_STREAM_BUFFER *stream);
+void oglh_stream_get_statistics
+(
+	const OGLH_STREAM_BUFFER *stream, OGLH_STREAM_STATISTICS *statistics
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,605 @@
+/*------------------------------------------------------------------------------
+	oglh_ texture loader -- textures loaded in the background without
+	frame hitches
+
+	Each load goes around a slot:
+
+	HEADER -> SIZED -> DECODING -> DECODED -> UPLOADED -> FREE
+	      \            \
+	       -> BROKEN    -> BROKEN -> FREE
+
+	HEADER		queued for a worker to read the file's header	(worker)
+	SIZED		width and height known, needs a mapped PBO		(GL thread)
+	DECODING	queued for a worker to decode into the PBO		(worker)
+	DECODED		unmap, glTexSubImage2D, mipmaps, fence			(GL thread)
+	UPLOADED	waiting on the fence							(GL thread)
+	BROKEN		a worker couldn't read the file					(GL thread)
+
+	Raw loads know their size up front and start at SIZED. The workers
+	share one queue under a mutex -- the jobs are whole files, the lock is
+	nothing next to them.
+------------------------------------------------------------------------------*/
+#include "OpenGL_texture_loader.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include "OpenGL_texture_units.h"
+#include "OpenGL_counted_calls.h"
+#include <pthread.h>		//	POSIX threads
+#include <stdatomic.h>		//	(since C11) Atomic operations
+#include <ctype.h>			//	Character classification
+#include <sched.h>			//	sched_yield
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define SLOT_FREE		0
+#define SLOT_HEADER		1
+#define SLOT_SIZED		2
+#define SLOT_DECODING	3
+#define SLOT_DECODED	4
+#define SLOT_UPLOADED	5
+#define SLOT_BROKEN		6
+
+#define FILE_PNM		1	// P6 or P5
+#define FILE_RAW		2
+
+typedef struct load_slot
+{
+	atomic_int state;
+	GLuint texture_id, pbo_id;
+	GLsync fence;
+	char file_name[FILENAME_MAX];
+	int file_type;
+	int width, height;
+	int channels;					// in the file, 1, 3 or 4
+	long data_offset;				// where the texels start in the file
+	bool mipmaps;
+	unsigned char *mapping;			// the PBO, while DECODING
+	OGLH_TEXTURE_LOADED callback;
+	void *user_data;
+}
+LOAD_SLOT;
+
+static struct
+{
+	bool active;
+	int number_of_threads;
+	pthread_t thread[OGLH_TEXTURE_LOADER_THREADS];
+	bool have_texture_storage;
+
+	LOAD_SLOT slot[OGLH_TEXTURE_LOADER_SLOTS];
+
+	// slot indices waiting for a worker
+	pthread_mutex_t queue_lock;
+	pthread_cond_t queue_not_empty;
+	int queue[OGLH_TEXTURE_LOADER_SLOTS];
+	int queue_head, queue_tail;
+	bool quit;
+
+	OGLH_TEXTURE_LOADER_STATISTICS statistics;
+}
+loader;
+/*------------------------------------------------------------------------------
+	There is one queue entry per slot so the queue can never overflow
+------------------------------------------------------------------------------*/
+static void queue_slot(int index, int state)
+{
+	pthread_mutex_lock(&loader.queue_lock);
+	atomic_store(&loader.slot[index].state, state);
+	loader.queue[loader.queue_tail++ % OGLH_TEXTURE_LOADER_SLOTS] = index;
+	pthread_cond_signal(&loader.queue_not_empty);
+	pthread_mutex_unlock(&loader.queue_lock);
+}
+/*------------------------------------------------------------------------------
+	PNM header fields are separated by whitespace and # comments
+------------------------------------------------------------------------------*/
+static bool read_pnm_number(FILE *image_fptr, int *number)
+{
+	int c;
+
+	for(;;)
+	{
+		c = fgetc(image_fptr);
+		if(c == '#')
+		{
+			while(c != '\n' && c != EOF) c = fgetc(image_fptr);
+		}
+		else
+		if(!isspace(c))
+			break;
+	}
+
+	if(!isdigit(c)) return false;
+	for(*number = 0; isdigit(c); c = fgetc(image_fptr))
+		*number = *number * 10 + (c - '0');
+	// the single whitespace after maxval is consumed here too
+	return true;
+}
+
+static bool read_header(LOAD_SLOT *slot)
+{
+	FILE *image_fptr;
+	char magic[2];
+	int maxval;
+	bool good;
+
+	if((image_fptr = fopen(slot->file_name, "rb")) == NULL) return false;
+
+	good = fread(magic, 2, 1, image_fptr) == 1 && magic[0] == 'P' &&
+		(magic[1] == '6' || magic[1] == '5');
+	good = good &&
+		read_pnm_number(image_fptr, &slot->width) &&
+		read_pnm_number(image_fptr, &slot->height) &&
+		read_pnm_number(image_fptr, &maxval) &&
+		maxval == 255 && slot->width > 0 && slot->height > 0;
+
+	if(good)
+	{
+		slot->channels = magic[1] == '6' ? 3 : 1;
+		slot->data_offset = ftell(image_fptr);
+	}
+	fclose(image_fptr);
+	return good;
+}
+/*------------------------------------------------------------------------------
+	Straight into the mapped PBO as RGBA8, bottom row first for GL
+------------------------------------------------------------------------------*/
+static bool decode_image(LOAD_SLOT *slot)
+{
+	FILE *image_fptr;
+	unsigned char *row = NULL, *texel;
+	size_t row_bytes = (size_t)slot->width * slot->channels;
+	int x, y;
+	bool good = true;
+
+	if((image_fptr = fopen(slot->file_name, "rb")) == NULL) return false;
+	if(fseek(image_fptr, slot->data_offset, SEEK_SET) != 0)
+	{
+		fclose(image_fptr);
+		return false;
+	}
+
+	if(slot->file_type == FILE_RAW)
+	{
+		good = fread(slot->mapping, row_bytes * slot->height, 1,
+			image_fptr) == 1;
+		fclose(image_fptr);
+		return good;
+	}
+
+	if((row = malloc(row_bytes)) == NULL)
+	{
+		fclose(image_fptr);
+		return false;
+	}
+
+	for(y = slot->height - 1; y >= 0 && good; y--)
+	{
+		good = fread(row, row_bytes, 1, image_fptr) == 1;
+		texel = slot->mapping + (size_t)y * slot->width * 4;
+
+		for(x = 0; x < slot->width && good; x++, texel += 4)
+		{
+			if(slot->channels == 3)
+			{
+				texel[0] = row[3 * x + 0];
+				texel[1] = row[3 * x + 1];
+				texel[2] = row[3 * x + 2];
+			}
+			else
+			{
+				texel[0] = texel[1] = texel[2] = row[x];
+			}
+			texel[3] = 255;
+		}
+	}
+
+	free(row);
+	fclose(image_fptr);
+	return good;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void *texture_loader_thread(void *argument)
+{
+	LOAD_SLOT *slot;
+	int index, state;
+	bool good;
+
+	(void)argument;
+	for(;;)
+	{
+		pthread_mutex_lock(&loader.queue_lock);
+		while(loader.queue_head == loader.queue_tail && !loader.quit)
+			pthread_cond_wait(&loader.queue_not_empty, &loader.queue_lock);
+		if(loader.queue_head == loader.queue_tail)
+		{
+			pthread_mutex_unlock(&loader.queue_lock);
+			return NULL;
+		}
+		index = loader.queue[loader.queue_head++ % OGLH_TEXTURE_LOADER_SLOTS];
+		pthread_mutex_unlock(&loader.queue_lock);
+
+		slot = &loader.slot[index];
+		state = atomic_load(&slot->state);
+		if(state == SLOT_HEADER)
+		{
+			good = read_header(slot);
+			atomic_store(&slot->state, good ? SLOT_SIZED : SLOT_BROKEN);
+		}
+		else
+		{
+			good = decode_image(slot);
+			atomic_store(&slot->state, good ? SLOT_DECODED : SLOT_BROKEN);
+		}
+	}
+}
+/*------------------------------------------------------------------------------
+	threads is clamped to 1 .. OGLH_TEXTURE_LOADER_THREADS
+------------------------------------------------------------------------------*/
+bool oglh_texture_loader_start(int threads)
+{
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(loader.active) return true;
+
+	if(threads < 1) threads = 1;
+	if(threads > OGLH_TEXTURE_LOADER_THREADS)
+		threads = OGLH_TEXTURE_LOADER_THREADS;
+
+	memset(&loader.statistics, 0, sizeof(loader.statistics));
+	for(index = 0; index < OGLH_TEXTURE_LOADER_SLOTS; index++)
+		atomic_init(&loader.slot[index].state, SLOT_FREE);
+
+	loader.have_texture_storage = oglh_gl_version_or_extension(42,
+		"GL_ARB_texture_storage");
+
+	pthread_mutex_init(&loader.queue_lock, NULL);
+	pthread_cond_init(&loader.queue_not_empty, NULL);
+	loader.queue_head = loader.queue_tail = 0;
+	loader.quit = false;
+
+	for(loader.number_of_threads = 0; loader.number_of_threads < threads;
+		loader.number_of_threads++)
+	{
+		if(pthread_create(&loader.thread[loader.number_of_threads], NULL,
+			texture_loader_thread, NULL))
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"texture loader started %d of %d threads",
+				loader.number_of_threads, threads);
+			break;
+		}
+	}
+
+	loader.active = loader.number_of_threads > 0;
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return loader.active;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static GLuint start_load
+(
+	const char *file_name, int file_type, int width, int height, bool mipmaps,
+	OGLH_TEXTURE_LOADED callback, void *user_data
+)
+{
+	LOAD_SLOT *slot = NULL;
+	int index;
+
+	if(!loader.active)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"oglh_texture_loader_start hasn't been called");
+		return 0;
+	}
+
+	for(index = 0; index < OGLH_TEXTURE_LOADER_SLOTS; index++)
+	{
+		if(atomic_load(&loader.slot[index].state) == SLOT_FREE)
+		{
+			slot = &loader.slot[index];
+			break;
+		}
+	}
+	if(slot == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"%d textures are already loading, %s has to wait",
+			OGLH_TEXTURE_LOADER_SLOTS, file_name);
+		return 0;
+	}
+
+	snprintf(slot->file_name, FILENAME_MAX, "%s", file_name);
+	slot->file_type = file_type;
+	slot->width = width;
+	slot->height = height;
+	slot->channels = 4;
+	slot->data_offset = 0;
+	slot->mipmaps = mipmaps;
+	slot->mapping = NULL;
+	slot->pbo_id = 0;
+	slot->fence = NULL;
+	slot->callback = callback;
+	slot->user_data = user_data;
+	slot->texture_id = oglh_registry_generate(OGLH_OBJECT_TEXTURE);
+	oglh_registry_set_label(OGLH_OBJECT_TEXTURE, slot->texture_id, file_name);
+
+	loader.statistics.requested++;
+	loader.statistics.in_flight++;
+
+	if(file_type == FILE_RAW)
+		atomic_store(&slot->state, SLOT_SIZED);
+	else
+		queue_slot(index, SLOT_HEADER);
+
+	return slot->texture_id;
+}
+/*------------------------------------------------------------------------------
+	The name is valid at once, the texture is complete when
+	oglh_texture_status says OGLH_TEXTURE_READY
+------------------------------------------------------------------------------*/
+GLuint oglh_texture_load
+(
+	const char *file_name, bool mipmaps,
+	OGLH_TEXTURE_LOADED callback, void *user_data
+)
+{
+	OGLH_NOTE_CALL_SITE();
+	return start_load(file_name, FILE_PNM, 0, 0, mipmaps, callback, user_data);
+}
+
+GLuint oglh_texture_load_raw
+(
+	const char *file_name, int width, int height, bool mipmaps,
+	OGLH_TEXTURE_LOADED callback, void *user_data
+)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(width <= 0 || height <= 0)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"raw texture %s is %d x %d", file_name, width, height);
+		return 0;
+	}
+	return start_load(file_name, FILE_RAW, width, height, mipmaps,
+		callback, user_data);
+}
+/*------------------------------------------------------------------------------
+	GL thread: a mapped PBO for the worker to decode into
+------------------------------------------------------------------------------*/
+static bool map_pbo(LOAD_SLOT *slot)
+{
+	GLsizeiptr bytes = (GLsizeiptr)slot->width * slot->height * 4;
+
+	slot->pbo_id = oglh_registry_generate(OGLH_OBJECT_BUFFER);
+	oglh_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo_id);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	oglh_registry_set_bytes(OGLH_OBJECT_BUFFER, slot->pbo_id, bytes);
+
+	slot->mapping = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if(slot->mapping == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"can't map a %ld byte PBO for %s", (long)bytes, slot->file_name);
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+	GL thread: PBO to texture, all on the GPU's time
+------------------------------------------------------------------------------*/
+static void upload_texture(LOAD_SLOT *slot)
+{
+	GLint alignment;
+	int levels = 1, size;
+
+	oglh_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo_id);
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	slot->mapping = NULL;
+
+	if(slot->mipmaps)
+	{
+		for(size = slot->width > slot->height ? slot->width : slot->height;
+			size > 1; size >>= 1)
+		{
+			levels++;
+		}
+	}
+
+	oglh_texture_units_bind_active(GL_TEXTURE_2D, slot->texture_id);
+	if(loader.have_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, slot->width,
+			slot->height);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, slot->width, slot->height, 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	}
+
+	// RGBA rows are 4 byte aligned, the caller's alignment is put back
+	oglh_state_get_integerv(GL_UNPACK_ALIGNMENT, &alignment);
+	if(alignment != 4) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	// with a PBO bound the pointer is an offset into it
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, slot->width, slot->height,
+		GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+	if(alignment != 4) glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+		slot->mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if(slot->mipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+
+	oglh_registry_set_image(OGLH_OBJECT_TEXTURE, slot->texture_id, GL_RGBA8,
+		slot->width, slot->height, 1, levels);
+	slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	loader.statistics.bytes += (long)slot->width * slot->height * 4;
+}
+/*------------------------------------------------------------------------------
+	GL thread: give the slot back and tell whoever asked
+------------------------------------------------------------------------------*/
+static void finish_slot(LOAD_SLOT *slot, bool loaded)
+{
+	GLuint texture_id = slot->texture_id;
+
+	if(slot->mapping != NULL)
+	{
+		oglh_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, slot->pbo_id);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		slot->mapping = NULL;
+	}
+	if(slot->fence != NULL) glDeleteSync(slot->fence);
+	slot->fence = NULL;
+	oglh_registry_delete(OGLH_OBJECT_BUFFER, slot->pbo_id);
+	slot->pbo_id = 0;
+
+	if(loaded)
+	{
+		loader.statistics.loaded++;
+	}
+	else
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"texture %s didn't load", slot->file_name);
+		oglh_registry_delete(OGLH_OBJECT_TEXTURE, texture_id);
+		loader.statistics.failed++;
+	}
+	loader.statistics.in_flight--;
+	atomic_store(&slot->state, SLOT_FREE);
+
+	if(slot->callback != NULL)
+		slot->callback(texture_id, loaded, slot->user_data);
+}
+/*------------------------------------------------------------------------------
+	Call once per frame on the GL thread. Moves every load on a step without
+	waiting on the GPU or the workers, and issues at most
+	OGLH_TEXTURE_UPLOADS_PER_FRAME uploads. The unpack buffer binding and
+	alignment are put back as they were; textures are bound on the active
+	unit through the texture unit manager, which keeps track.
+------------------------------------------------------------------------------*/
+void oglh_texture_loader_update(void)
+{
+	LOAD_SLOT *slot;
+	GLint unpack_binding;
+	GLenum status;
+	int index, uploads = 0;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!loader.active || loader.statistics.in_flight == 0) return;
+
+	oglh_state_get_integerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpack_binding);
+
+	for(index = 0; index < OGLH_TEXTURE_LOADER_SLOTS; index++)
+	{
+		slot = &loader.slot[index];
+		switch(atomic_load(&slot->state))
+		{
+			case SLOT_SIZED:
+				if(map_pbo(slot))
+					queue_slot(index, SLOT_DECODING);
+				else
+					finish_slot(slot, false);
+			break;
+
+			case SLOT_DECODED:
+				if(uploads++ < OGLH_TEXTURE_UPLOADS_PER_FRAME)
+				{
+					upload_texture(slot);
+					atomic_store(&slot->state, SLOT_UPLOADED);
+				}
+			break;
+
+			case SLOT_UPLOADED:
+				status = glClientWaitSync(slot->fence,
+					GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+				if(status == GL_ALREADY_SIGNALED ||
+					status == GL_CONDITION_SATISFIED)
+				{
+					finish_slot(slot, true);
+				}
+			break;
+
+			case SLOT_BROKEN:
+				finish_slot(slot, false);
+			break;
+		}
+	}
+
+	oglh_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, unpack_binding);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Blocks until every load has finished -- for loading screens and tools
+------------------------------------------------------------------------------*/
+void oglh_texture_loader_finish(void)
+{
+	OGLH_NOTE_CALL_SITE();
+	while(loader.active && loader.statistics.in_flight > 0)
+	{
+		oglh_texture_loader_update();
+		glFlush();
+		sched_yield();
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int oglh_texture_status(GLuint texture_id)
+{
+	int index, state;
+
+	if(texture_id == 0) return OGLH_TEXTURE_FAILED;
+
+	for(index = 0; index < OGLH_TEXTURE_LOADER_SLOTS; index++)
+	{
+		state = atomic_load(&loader.slot[index].state);
+		if(state != SLOT_FREE && loader.slot[index].texture_id == texture_id)
+			return OGLH_TEXTURE_LOADING;
+	}
+
+	return oglh_registry_is_live(OGLH_OBJECT_TEXTURE, texture_id) ?
+		OGLH_TEXTURE_READY : OGLH_TEXTURE_FAILED;
+}
+/*------------------------------------------------------------------------------
+	Finishes what is loading, then stops the workers
+------------------------------------------------------------------------------*/
+void oglh_texture_loader_stop(void)
+{
+	int index;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!loader.active) return;
+
+	oglh_texture_loader_finish();
+
+	pthread_mutex_lock(&loader.queue_lock);
+	loader.quit = true;
+	pthread_cond_broadcast(&loader.queue_not_empty);
+	pthread_mutex_unlock(&loader.queue_lock);
+
+	for(index = 0; index < loader.number_of_threads; index++)
+		pthread_join(loader.thread[index], NULL);
+
+	pthread_cond_destroy(&loader.queue_not_empty);
+	pthread_mutex_destroy(&loader.queue_lock);
+	loader.active = false;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_texture_loader_get_statistics
+(
+	OGLH_TEXTURE_LOADER_STATISTICS *statistics
+)
+{
+	*statistics = loader.statistics;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,82 @@
+/*------------------------------------------------------------------------------
+	oglh_ texture loader -- textures loaded in the background without
+	frame hitches
+
+	A small pool of worker threads reads and decodes image files straight
+	into mapped pixel unpack buffers (PBOs). The GL thread does only what
+	must be done on the GL thread -- mapping, glTexSubImage2D from the PBO,
+	glGenerateMipmap and a fence -- a few textures per frame, in
+	oglh_texture_loader_update. The texture name is handed out at once and
+	is complete, ready to sample, when its fence has signalled.
+
+	oglh_texture_loader_start(2);
+	GLuint rock = oglh_texture_load("rock.ppm", true, NULL, NULL);
+	while(running)
+	{
+		oglh_texture_loader_update();				// once per frame
+		if(oglh_texture_status(rock) == OGLH_TEXTURE_READY) ... use rock ...
+	}
+	oglh_texture_loader_stop();
+
+	or pass a callback, called from oglh_texture_loader_update on the GL
+	thread as each texture is ready or has failed.
+
+	Binary PPM (P6) and PGM (P5) with a maxval of 255 load as RGBA8, flipped
+	so the first row of the file is the top of the texture. Raw files are
+	width * height RGBA8 texels, as is. A texture that fails to load is
+	deleted and its status is OGLH_TEXTURE_FAILED.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_TEXTURE_LOADER_THREADS		8	// at most
+#define OGLH_TEXTURE_LOADER_SLOTS		64	// loads in flight, a power of two
+#define OGLH_TEXTURE_UPLOADS_PER_FRAME	4	// glTexSubImage2D calls per update
+
+#define OGLH_TEXTURE_FAILED				0
+#define OGLH_TEXTURE_LOADING			1
+#define OGLH_TEXTURE_READY				2
+
+typedef void (*OGLH_TEXTURE_LOADED)
+(
+	GLuint texture_id, bool loaded, void *user_data
+);
+
+typedef struct oglh_texture_loader_statistics
+{
+	long requested;
+	long loaded;
+	long failed;
+	long bytes;			// texels uploaded
+	int in_flight;
+}
+OGLH_TEXTURE_LOADER_STATISTICS;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+bool oglh_texture_loader_start(int threads);
+void oglh_texture_loader_stop(void);
+
+GLuint oglh_texture_load
+(
+	const char *file_name, bool mipmaps,
+	OGLH_TEXTURE_LOADED callback, void *user_data
+);
+GLuint oglh_texture_load_raw
+(
+	const char *file_name, int width, int height, bool mipmaps,
+	OGLH_TEXTURE_LOADED callback, void *user_data
+);
+
+void oglh_texture_loader_update(void);
+void oglh_texture_loader_finish(void);		// waits for every load
+int oglh_texture_status(GLuint texture_id);
+void oglh_texture_loader_get_statistics
+(
+	OGLH_TEXTURE_LOADER_STATISTICS *statistics
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,647 @@
+/*------------------------------------------------------------------------------
+	oglh_ texture units -- a binding cache for every texture unit and the
+	sampler units of each program
+
+	units[n] is what the manager last bound on unit n. A unit whose binding
+	isn't known, because nothing has been bound through the manager yet or
+	because it has been invalidated, has a target of 0 and is always bound.
+	One texture is remembered per unit -- binding a texture of another
+	target on the unit replaces it in the cache, though GL keeps both.
+
+	Build with OGLH_TEXTURE_SINGLE_BINDS to bind one unit at a time even
+	when ARB_multi_bind is available.
+------------------------------------------------------------------------------*/
+#include "OpenGL_texture_units.h"
+#include "OpenGL_state.h"
+#include "OpenGL_counted_calls.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define UNKNOWN_UNIT		-1
+#define PROGRAMS			32	// programs whose samplers are remembered
+
+typedef struct unit_binding
+{
+	GLenum target;			// 0 when unknown
+	GLuint texture_id;
+}
+UNIT_BINDING;
+
+typedef struct program_sampler
+{
+	char name[OGLH_SAMPLER_NAME_SIZE];	// without the [0] of an array
+	int unit;							// of element 0
+	int size;							// array elements, 1 otherwise
+	GLenum target;
+}
+PROGRAM_SAMPLER;
+
+typedef struct program_samplers
+{
+	GLuint program_id;					// 0 when the entry is free
+	int samplers;
+	PROGRAM_SAMPLER sampler[OGLH_MAX_PROGRAM_SAMPLERS];
+}
+PROGRAM_SAMPLERS;
+
+typedef struct texture_unit_manager
+{
+	bool initialised;
+	bool multi_bind;
+	int units;				// GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS
+	int active_unit;		// or UNKNOWN_UNIT
+	UNIT_BINDING *unit;
+	PROGRAM_SAMPLERS program[PROGRAMS];
+	int next_program;		// the entry to reuse when all are taken
+	OGLH_TEXTURE_UNIT_STATISTICS statistics;
+}
+TEXTURE_UNIT_MANAGER;
+
+// the thread's oglh context's, see OpenGL_context.h
+static TEXTURE_UNIT_MANAGER default_manager;
+static _Thread_local TEXTURE_UNIT_MANAGER *manager = &default_manager;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static bool have_multi_bind(void)
+{
+#ifdef OGLH_TEXTURE_SINGLE_BINDS
+	return false;
+#else
+	return oglh_gl_version_or_extension(44, "GL_ARB_multi_bind");
+#endif
+}
+
+static bool initialise(void)
+{
+	GLint units = 0;
+
+	if(manager->initialised) return true;
+
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &units);
+	manager->unit = calloc(units > 0 ? units : 1, sizeof(UNIT_BINDING));
+	if(manager->unit == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"no memory for %d texture units", units);
+		return false;
+	}
+
+	manager->units = units;
+	manager->active_unit = UNKNOWN_UNIT;
+
+	manager->multi_bind = have_multi_bind();
+
+	manager->initialised = true;
+	return true;
+}
+
+static void activate(int unit)
+{
+	if(manager->active_unit == unit) return;
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	manager->active_unit = unit;
+	manager->statistics.gl_calls++;
+}
+
+static bool is_bound(int unit, GLenum target, GLuint texture_id)
+{
+	return manager->unit[unit].target == target &&
+		manager->unit[unit].texture_id == texture_id;
+}
+
+static void bind(int unit, GLenum target, GLuint texture_id)
+{
+	activate(unit);
+	glBindTexture(target, texture_id);
+	manager->unit[unit].target = target;
+	manager->unit[unit].texture_id = texture_id;
+	manager->statistics.gl_calls++;
+}
+/*------------------------------------------------------------------------------
+	Leaves the active unit unspecified: if the texture is already bound
+	nothing is called at all
+------------------------------------------------------------------------------*/
+void oglh_texture_units_bind(int unit, GLenum target, GLuint texture_id)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return;
+
+	if(unit < 0 || unit >= manager->units)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"texture unit %d out of range 0..%d", unit, manager->units - 1);
+		return;
+	}
+
+	manager->statistics.binds++;
+	if(is_bound(unit, target, texture_id))
+	{
+		manager->statistics.skipped++;
+		return;
+	}
+
+	bind(unit, target, texture_id);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	Binds on whichever unit is active, as plain glBindTexture would
+------------------------------------------------------------------------------*/
+void oglh_texture_units_bind_active(GLenum target, GLuint texture_id)
+{
+	GLint active_texture;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return;
+
+	if(manager->active_unit == UNKNOWN_UNIT)
+	{
+		glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture);
+		manager->active_unit = active_texture - GL_TEXTURE0;
+	}
+
+	oglh_texture_units_bind(manager->active_unit, target, texture_id);
+}
+/*------------------------------------------------------------------------------
+	For glTexImage2D and the like on a particular unit
+------------------------------------------------------------------------------*/
+void oglh_texture_units_activate(int unit)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return;
+
+	if(unit < 0 || unit >= manager->units)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"texture unit %d out of range 0..%d", unit, manager->units - 1);
+		return;
+	}
+
+	activate(unit);
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	The texture target a sampler type samples, 0 if it isn't a sampler
+------------------------------------------------------------------------------*/
+static GLenum sampler_target(GLenum type)
+{
+	switch(type)
+	{
+		case GL_SAMPLER_1D:
+		case GL_SAMPLER_1D_SHADOW:
+		case GL_INT_SAMPLER_1D:
+		case GL_UNSIGNED_INT_SAMPLER_1D:
+			return GL_TEXTURE_1D;
+
+		case GL_SAMPLER_2D:
+		case GL_SAMPLER_2D_SHADOW:
+		case GL_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_2D:
+			return GL_TEXTURE_2D;
+
+		case GL_SAMPLER_3D:
+		case GL_INT_SAMPLER_3D:
+		case GL_UNSIGNED_INT_SAMPLER_3D:
+			return GL_TEXTURE_3D;
+
+		case GL_SAMPLER_CUBE:
+		case GL_SAMPLER_CUBE_SHADOW:
+		case GL_INT_SAMPLER_CUBE:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE:
+			return GL_TEXTURE_CUBE_MAP;
+
+		case GL_SAMPLER_1D_ARRAY:
+		case GL_SAMPLER_1D_ARRAY_SHADOW:
+		case GL_INT_SAMPLER_1D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+			return GL_TEXTURE_1D_ARRAY;
+
+		case GL_SAMPLER_2D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY_SHADOW:
+		case GL_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+			return GL_TEXTURE_2D_ARRAY;
+
+		case GL_SAMPLER_2D_RECT:
+		case GL_SAMPLER_2D_RECT_SHADOW:
+		case GL_INT_SAMPLER_2D_RECT:
+		case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+			return GL_TEXTURE_RECTANGLE;
+
+		case GL_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+			return GL_TEXTURE_BUFFER;
+
+		case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D_MULTISAMPLE:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+			return GL_TEXTURE_2D_MULTISAMPLE;
+
+		case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+			return GL_TEXTURE_2D_MULTISAMPLE_ARRAY;
+
+		case GL_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+		case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+			return GL_TEXTURE_CUBE_MAP_ARRAY;
+	}
+	return 0;
+}
+/*------------------------------------------------------------------------------
+	The entry for a program, a fresh one if create and it hasn't one
+------------------------------------------------------------------------------*/
+static PROGRAM_SAMPLERS *find_program(GLuint program_id, bool create)
+{
+	PROGRAM_SAMPLERS *entry;
+	int index;
+
+	if(program_id == 0) return NULL;
+
+	for(index = 0; index < PROGRAMS; index++)
+	{
+		if(manager->program[index].program_id == program_id)
+			return &manager->program[index];
+	}
+	if(!create) return NULL;
+
+	for(index = 0; index < PROGRAMS; index++)
+	{
+		if(manager->program[index].program_id == 0) break;
+	}
+	if(index == PROGRAMS)
+	{
+		index = manager->next_program;
+		manager->next_program = (manager->next_program + 1) % PROGRAMS;
+	}
+
+	entry = &manager->program[index];
+	memset(entry, 0, sizeof(*entry));
+	entry->program_id = program_id;
+	return entry;
+}
+/*------------------------------------------------------------------------------
+	"lights[2]" is element 2 of the sampler array "lights"
+------------------------------------------------------------------------------*/
+static PROGRAM_SAMPLER *find_sampler
+(
+	PROGRAM_SAMPLERS *entry, const char *sampler_name, int *element
+)
+{
+	const char *bracket = strchr(sampler_name, '[');
+	size_t length = bracket ? (size_t)(bracket - sampler_name) :
+		strlen(sampler_name);
+	int index;
+
+	*element = bracket ? atoi(bracket + 1) : 0;
+
+	for(index = 0; index < entry->samplers; index++)
+	{
+		if(strncmp(entry->sampler[index].name, sampler_name, length) == 0 &&
+			entry->sampler[index].name[length] == '\0')
+		{
+			return &entry->sampler[index];
+		}
+	}
+	return NULL;
+}
+/*------------------------------------------------------------------------------
+	Fills the entry with the program's samplers. With assign each gets
+	units of its own from OGLH_TEXTURE_UNIT_FIRST, otherwise whatever units
+	the program already has are read back.
+------------------------------------------------------------------------------*/
+static void introspect_samplers
+(
+	PROGRAM_SAMPLERS *entry, GLuint program_id, bool assign
+)
+{
+	GLint active_uniforms = 0, size, location, units[OGLH_MAX_PROGRAM_SAMPLERS];
+	GLint next_unit = OGLH_TEXTURE_UNIT_FIRST;
+	GLsizei length;
+	GLenum type, target;
+	PROGRAM_SAMPLER *sampler;
+	char name[OGLH_SAMPLER_NAME_SIZE], *bracket;
+	int index, element;
+
+	// a relinked program, or a new one under an old name, starts again
+	entry->samplers = 0;
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &active_uniforms);
+
+	for(index = 0; index < active_uniforms; index++)
+	{
+		glGetActiveUniform(program_id, index, sizeof(name), &length, &size,
+			&type, name);
+		if((target = sampler_target(type)) == 0) continue;
+
+		if((location = glGetUniformLocation(program_id, name)) < 0) continue;
+		if((bracket = strchr(name, '[')) != NULL) *bracket = '\0';
+
+		if(entry->samplers == OGLH_MAX_PROGRAM_SAMPLERS ||
+			size > OGLH_MAX_PROGRAM_SAMPLERS)
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"program %u has more than %d samplers, '%s' left unassigned",
+				program_id, OGLH_MAX_PROGRAM_SAMPLERS, name);
+			continue;
+		}
+
+		sampler = &entry->sampler[entry->samplers++];
+		strcpy(sampler->name, name);
+		sampler->size = size;
+		sampler->target = target;
+
+		if(!assign)
+		{
+			glGetUniformiv(program_id, location, &sampler->unit);
+			continue;
+		}
+
+		if(next_unit + size > manager->units)
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"out of texture units for sampler '%s' in program %u",
+				name, program_id);
+			entry->samplers--;
+			continue;
+		}
+
+		for(element = 0; element < size; element++)
+			units[element] = next_unit + element;
+		glUniform1iv(location, size, units);
+
+		sampler->unit = next_unit;
+		next_unit += size;
+	}
+}
+/*------------------------------------------------------------------------------
+	Gives each sampler uniform of the program units of its own, in the
+	order GL lists them. oglh_install_shader calls this for every program
+	it links.
+------------------------------------------------------------------------------*/
+void oglh_texture_units_assign_samplers(GLuint program_id)
+{
+	GLint current_program;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return;
+
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &current_program);
+	if((GLuint)current_program != program_id)
+		oglh_state_use_program(program_id);
+
+	introspect_samplers(find_program(program_id, true), program_id, true);
+
+	if((GLuint)current_program != program_id)
+		oglh_state_use_program(current_program);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	The samplers of the current program, read back from GL the first time
+	a program the manager didn't link is seen
+------------------------------------------------------------------------------*/
+static PROGRAM_SAMPLERS *current_program_samplers(void)
+{
+	PROGRAM_SAMPLERS *entry;
+	GLint program_id;
+
+	oglh_state_get_integerv(GL_CURRENT_PROGRAM, &program_id);
+	if((entry = find_program(program_id, false)) == NULL &&
+		(entry = find_program(program_id, true)) != NULL)
+	{
+		introspect_samplers(entry, program_id, false);
+	}
+
+	if(entry == NULL)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no program in use");
+	}
+	return entry;
+}
+/*------------------------------------------------------------------------------
+	Called when a sampler uniform of the current program is set by hand
+------------------------------------------------------------------------------*/
+void oglh_texture_units_note_sampler(const char *sampler_name, int unit)
+{
+	PROGRAM_SAMPLERS *entry;
+	PROGRAM_SAMPLER *sampler;
+	int element;
+
+	if(!initialise()) return;
+	if((entry = current_program_samplers()) == NULL) return;
+
+	if((sampler = find_sampler(entry, sampler_name, &element)) != NULL &&
+		element == 0)
+	{
+		sampler->unit = unit;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int oglh_texture_units_sampler_unit(const char *sampler_name)
+{
+	PROGRAM_SAMPLERS *entry;
+	PROGRAM_SAMPLER *sampler;
+	int element;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return -1;
+	if((entry = current_program_samplers()) == NULL) return -1;
+
+	sampler = find_sampler(entry, sampler_name, &element);
+	if(sampler == NULL || element < 0 || element >= sampler->size)
+		return -1;
+
+	return sampler->unit + element;
+}
+/*------------------------------------------------------------------------------
+	Binds textures to the units of the current program's samplers. Only the
+	units whose binding changes are touched: with multi-bind, one
+	glBindTextures for each run of consecutive units from the first to the
+	last change in it.
+------------------------------------------------------------------------------*/
+typedef struct wanted_binding
+{
+	int unit;
+	GLenum target;
+	GLuint texture_id;
+}
+WANTED_BINDING;
+
+static void bind_run(const WANTED_BINDING *wanted, int count)
+{
+	GLuint texture_ids[OGLH_MAX_PROGRAM_SAMPLERS];
+	int index;
+
+	for(index = 0; index < count; index++)
+	{
+		texture_ids[index] = wanted[index].texture_id;
+		manager->unit[wanted[index].unit].target = wanted[index].target;
+		manager->unit[wanted[index].unit].texture_id = wanted[index].texture_id;
+	}
+
+	glBindTextures(wanted[0].unit, count, texture_ids);
+	manager->statistics.gl_calls++;
+}
+
+void oglh_bind_named_textures
+(
+	int count, const char *sampler_names[], const GLuint texture_ids[]
+)
+{
+	WANTED_BINDING wanted[OGLH_MAX_PROGRAM_SAMPLERS], swap;
+	PROGRAM_SAMPLERS *entry;
+	PROGRAM_SAMPLER *sampler;
+	int index, wanted_count = 0, element, first, last, run;
+
+	OGLH_NOTE_CALL_SITE();
+	if(!initialise()) return;
+	if((entry = current_program_samplers()) == NULL) return;
+
+	for(index = 0; index < count; index++)
+	{
+		sampler = find_sampler(entry, sampler_names[index], &element);
+		if(sampler == NULL || element < 0 || element >= sampler->size)
+		{
+			oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+				"no sampler '%s' in program %u", sampler_names[index],
+				entry->program_id);
+			continue;
+		}
+		if(wanted_count == OGLH_MAX_PROGRAM_SAMPLERS) break;
+
+		wanted[wanted_count].unit = sampler->unit + element;
+		wanted[wanted_count].target = sampler->target;
+		wanted[wanted_count].texture_id = texture_ids[index];
+		wanted_count++;
+	}
+	manager->statistics.binds += wanted_count;
+
+	// in unit order, a few entries so insertion sort
+	for(index = 1; index < wanted_count; index++)
+	{
+		for(run = index; run > 0 && wanted[run - 1].unit > wanted[run].unit;
+			run--)
+		{
+			swap = wanted[run];
+			wanted[run] = wanted[run - 1];
+			wanted[run - 1] = swap;
+		}
+	}
+
+	for(index = 0; index < wanted_count; index = run)
+	{
+		// run is one past the end of the consecutive units from index
+		for(run = index + 1; run < wanted_count &&
+			wanted[run].unit == wanted[run - 1].unit + 1; run++);
+
+		if(!manager->multi_bind)
+		{
+			for(element = index; element < run; element++)
+			{
+				if(is_bound(wanted[element].unit, wanted[element].target,
+					wanted[element].texture_id))
+				{
+					manager->statistics.skipped++;
+				}
+				else
+				{
+					bind(wanted[element].unit, wanted[element].target,
+						wanted[element].texture_id);
+				}
+			}
+			continue;
+		}
+
+		// unchanged units at either end of the run are left alone
+		for(first = index; first < run && is_bound(wanted[first].unit,
+			wanted[first].target, wanted[first].texture_id); first++);
+		for(last = run - 1; last > first && is_bound(wanted[last].unit,
+			wanted[last].target, wanted[last].texture_id); last--);
+
+		if(first == run)
+		{
+			manager->statistics.skipped += run - index;
+			continue;
+		}
+		manager->statistics.skipped += run - index - (last - first + 1);
+		bind_run(&wanted[first], last - first + 1);
+	}
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+}
+/*------------------------------------------------------------------------------
+	A deleted texture is unbound from every unit it was on
+------------------------------------------------------------------------------*/
+void oglh_texture_units_forget_texture(GLuint texture_id)
+{
+	int unit;
+
+	for(unit = 0; manager->initialised && unit < manager->units; unit++)
+	{
+		if(manager->unit[unit].texture_id == texture_id)
+			manager->unit[unit].texture_id = 0;
+	}
+}
+/*------------------------------------------------------------------------------
+	A deleted program's samplers go, its name may come back as another
+------------------------------------------------------------------------------*/
+void oglh_texture_units_forget_program(GLuint program_id)
+{
+	PROGRAM_SAMPLERS *entry;
+
+	if((entry = find_program(program_id, false)) != NULL)
+		memset(entry, 0, sizeof(*entry));
+}
+/*------------------------------------------------------------------------------
+	Forget every binding, after textures have been bound behind the
+	manager's back
+------------------------------------------------------------------------------*/
+void oglh_texture_units_invalidate(void)
+{
+	OGLH_NOTE_CALL_SITE();
+	if(!manager->initialised) return;
+
+	memset(manager->unit, 0, manager->units * sizeof(UNIT_BINDING));
+	manager->active_unit = UNKNOWN_UNIT;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_texture_units_get_statistics
+(
+	OGLH_TEXTURE_UNIT_STATISTICS *statistics
+)
+{
+	*statistics = manager->statistics;
+}
+/*------------------------------------------------------------------------------
+	The manager as a part of an oglh context, see OpenGL_context.h
+------------------------------------------------------------------------------*/
+void *oglh_texture_units_new_context(void)
+{
+	return calloc(1, sizeof(TEXTURE_UNIT_MANAGER));
+}
+
+void oglh_texture_units_use_context(void *units)
+{
+	manager = units != NULL ? units : &default_manager;
+}
+
+void oglh_texture_units_delete_context(void *units)
+{
+	if(units == NULL) return;
+
+	if(units == manager) manager = &default_manager;
+	free(((TEXTURE_UNIT_MANAGER *)units)->unit);
+	free(units);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,71 @@
+/*------------------------------------------------------------------------------
+	oglh_ texture units -- what is bound where, sampler units assigned for
+	you
+
+	Every texture unit up to GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS has its
+	binding remembered, so binding what is already bound costs nothing,
+	not even a glActiveTexture.
+
+	When oglh_install_shader links a program its sampler uniforms are
+	found and given units of their own, in order, from
+	OGLH_TEXTURE_UNIT_FIRST -- no more hard-coded unit numbers. Textures are
+	then bound by sampler name, as many as a draw needs in one call:
+
+	const char *samplers[] = { "diffuse_map", "normal_map" };
+	GLuint textures[] = { rock_diffuse, rock_normal };
+	oglh_bind_named_textures(2, samplers, textures);
+
+	With ARB_multi_bind (GL 4.4) that is one glBindTextures for each run of
+	consecutive units that has something to change; without it one
+	glActiveTexture and glBindTexture per change.
+
+	Setting a sampler uniform by hand still works, the unit given is
+	remembered for the name. Binding textures with raw GL calls behind the
+	manager's back leaves it out of date -- call
+	oglh_texture_units_invalidate afterwards.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_TEXTURE_UNIT_FIRST		1	// unit 0 is left to the fixed pipeline
+#define OGLH_MAX_PROGRAM_SAMPLERS	32
+#define OGLH_SAMPLER_NAME_SIZE		64
+
+typedef struct oglh_texture_unit_statistics
+{
+	long binds;			// textures bound
+	long skipped;		// binds that were already in place
+	long gl_calls;		// glActiveTexture, glBindTexture and glBindTextures
+}
+OGLH_TEXTURE_UNIT_STATISTICS;
+/*------------------------------------------------------------------------------
+	unit is a unit number, 0 upwards, not GL_TEXTURE0 + n
+------------------------------------------------------------------------------*/
+void oglh_texture_units_bind(int unit, GLenum target, GLuint texture_id);
+void oglh_texture_units_bind_active(GLenum target, GLuint texture_id);
+void oglh_texture_units_activate(int unit);
+void oglh_bind_named_textures
+(
+	int count, const char *sampler_names[], const GLuint texture_ids[]
+);
+int oglh_texture_units_sampler_unit(const char *sampler_name);	// or -1
+
+void oglh_texture_units_assign_samplers(GLuint program_id);
+void oglh_texture_units_note_sampler(const char *sampler_name, int unit);
+void oglh_texture_units_forget_texture(GLuint texture_id);
+void oglh_texture_units_forget_program(GLuint program_id);
+void oglh_texture_units_invalidate(void);
+void oglh_texture_units_get_statistics
+(
+	OGLH_TEXTURE_UNIT_STATISTICS *statistics
+);
+
+// for OpenGL_context.c
+void *oglh_texture_units_new_context(void);
+void oglh_texture_units_use_context(void *units);
+void oglh_texture_units_delete_context(void *units);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,366 @@
+/*------------------------------------------------------------------------------
+	oglh_ timers -- scoped GPU and CPU timing
+
+	Every scope owns a small ring of GL_TIMESTAMP query pairs. A pair is
+	PENDING from oglh_timer_end until its result has been collected, and a
+	begin that finds its next pair still PENDING (the GPU is more than
+	OGLH_TIMER_QUERIES uses behind) skips the GPU sample instead of waiting.
+
+	Scope names and ids are the process's, as OGLH_TIMER_BEGIN keeps the
+	id in a static. The queries and samples are a part of the oglh context
+	(OpenGL_context.h) since query objects aren't shared between contexts.
+------------------------------------------------------------------------------*/
+#include "OpenGL_timers.h"
+#include <pthread.h>		//	POSIX threads
+#include <time.h>			//	Time/date utilities
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define QUERY_FREE		0
+#define QUERY_OPEN		1	// begin issued, end not yet
+#define QUERY_PENDING	2	// both issued, result not yet collected
+
+typedef struct sample_ring
+{
+	float ms[OGLH_TIMER_HISTORY];
+	int count, next;
+}
+SAMPLE_RING;
+
+typedef struct timer_scope
+{
+	bool open;
+	struct timespec cpu_start;
+
+	GLuint query[OGLH_TIMER_QUERIES][2];	// begin and end timestamps
+	int query_state[OGLH_TIMER_QUERIES];
+	long query_frame[OGLH_TIMER_QUERIES];
+	int next_query, open_query;
+	long gpu_skipped;
+
+	SAMPLE_RING cpu, gpu;
+}
+TIMER_SCOPE;
+
+typedef struct timer_context
+{
+	TIMER_SCOPE scope[OGLH_TIMER_MAX_SCOPES];
+	long frame;
+}
+TIMER_CONTEXT;
+
+static char scope_name[OGLH_TIMER_MAX_SCOPES][OGLH_TIMER_NAME_SIZE];
+static int number_of_scopes = 0;
+static pthread_mutex_t scope_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static TIMER_CONTEXT default_timers;
+static _Thread_local TIMER_CONTEXT *timers = &default_timers;
+
+// names up to here are written, registering never blocks a reader
+static int scopes(void)
+{
+	return __atomic_load_n(&number_of_scopes, __ATOMIC_ACQUIRE);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void add_sample(SAMPLE_RING *ring, float ms)
+{
+	ring->ms[ring->next] = ms;
+	ring->next = (ring->next + 1) % OGLH_TIMER_HISTORY;
+	if(ring->count < OGLH_TIMER_HISTORY) ring->count++;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static int compare_floats(const void *a, const void *b)
+{
+	float fa = *(const float *)a, fb = *(const float *)b;
+	return (fa > fb) - (fa < fb);
+}
+/*------------------------------------------------------------------------------
+	min, average and 99th percentile of what is in the ring
+------------------------------------------------------------------------------*/
+static void ring_statistics
+(
+	const SAMPLE_RING *ring, float *min, float *average, float *p99
+)
+{
+	float sorted[OGLH_TIMER_HISTORY], sum = 0.0f;
+	int index, p99_index;
+
+	*min = *average = *p99 = 0.0f;
+	if(ring->count == 0) return;
+
+	memcpy(sorted, ring->ms, ring->count * sizeof(float));
+	qsort(sorted, ring->count, sizeof(float), compare_floats);
+
+	for(index = 0; index < ring->count; index++) sum += sorted[index];
+
+	p99_index = (int)ceilf(0.99f * ring->count) - 1;
+	if(p99_index < 0) p99_index = 0;
+
+	*min = sorted[0];
+	*average = sum / ring->count;
+	*p99 = sorted[p99_index];
+}
+/*------------------------------------------------------------------------------
+	read the results that are old enough and ready -- never waits
+------------------------------------------------------------------------------*/
+static void collect_gpu_results(TIMER_SCOPE *scope)
+{
+	int index;
+	GLint available;
+	GLuint64 begin_ns, end_ns;
+
+	for(index = 0; index < OGLH_TIMER_QUERIES; index++)
+	{
+		if(scope->query_state[index] != QUERY_PENDING) continue;
+		if(timers->frame - scope->query_frame[index] < OGLH_TIMER_FRAME_LATENCY)
+			continue;
+
+		glGetQueryObjectiv(scope->query[index][1],
+			GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available) continue;
+
+		glGetQueryObjectui64v(scope->query[index][0], GL_QUERY_RESULT, &begin_ns);
+		glGetQueryObjectui64v(scope->query[index][1], GL_QUERY_RESULT, &end_ns);
+		add_sample(&scope->gpu, (float)((end_ns - begin_ns) * 1.0e-6));
+		scope->query_state[index] = QUERY_FREE;
+	}
+}
+/*------------------------------------------------------------------------------
+	returns the id of the named scope, making it if it's new
+------------------------------------------------------------------------------*/
+int oglh_timer_register(const char *name)
+{
+	int scope_id;
+
+	pthread_mutex_lock(&scope_lock);
+	for(scope_id = 0; scope_id < number_of_scopes; scope_id++)
+	{
+		if(!strncmp(scope_name[scope_id], name, OGLH_TIMER_NAME_SIZE - 1))
+		{
+			pthread_mutex_unlock(&scope_lock);
+			return scope_id;
+		}
+	}
+
+	if(number_of_scopes >= OGLH_TIMER_MAX_SCOPES)
+	{
+		pthread_mutex_unlock(&scope_lock);
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"too many timer scopes, the limit is %d", OGLH_TIMER_MAX_SCOPES);
+		return 0;
+	}
+
+	// the queries are made on first use in each context, there may not be
+	// a context yet
+	snprintf(scope_name[scope_id], OGLH_TIMER_NAME_SIZE, "%s", name);
+	__atomic_store_n(&number_of_scopes, scope_id + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&scope_lock);
+	return scope_id;
+}
+/*------------------------------------------------------------------------------
+	A begin on a scope that is already open restarts it
+------------------------------------------------------------------------------*/
+void oglh_timer_begin(int scope_id)
+{
+	TIMER_SCOPE *scope = &timers->scope[scope_id];
+	int index;
+
+	if(scope->query[0][0] == 0)
+	{
+		for(index = 0; index < OGLH_TIMER_QUERIES; index++)
+			glGenQueries(2, scope->query[index]);
+	}
+
+	if(scope->open && scope->open_query >= 0)
+		scope->query_state[scope->open_query] = QUERY_FREE;
+
+	index = scope->next_query;
+	if(scope->query_state[index] == QUERY_PENDING) collect_gpu_results(scope);
+
+	if(scope->query_state[index] == QUERY_FREE)
+	{
+		glQueryCounter(scope->query[index][0], GL_TIMESTAMP);
+		scope->query_state[index] = QUERY_OPEN;
+		scope->open_query = index;
+		scope->next_query = (index + 1) % OGLH_TIMER_QUERIES;
+	}
+	else
+	{
+		scope->open_query = -1;	// the GPU is too far behind
+		scope->gpu_skipped++;
+	}
+
+	scope->open = true;
+	clock_gettime(CLOCK_MONOTONIC, &scope->cpu_start);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_timer_end(int scope_id)
+{
+	TIMER_SCOPE *scope = &timers->scope[scope_id];
+	struct timespec cpu_end;
+	int index;
+
+	clock_gettime(CLOCK_MONOTONIC, &cpu_end);
+	if(!scope->open) return;
+
+	add_sample(&scope->cpu,
+		(cpu_end.tv_sec - scope->cpu_start.tv_sec) * 1.0e3f +
+		(cpu_end.tv_nsec - scope->cpu_start.tv_nsec) * 1.0e-6f);
+
+	if((index = scope->open_query) >= 0)
+	{
+		glQueryCounter(scope->query[index][1], GL_TIMESTAMP);
+		scope->query_state[index] = QUERY_PENDING;
+		scope->query_frame[index] = timers->frame;
+	}
+
+	scope->open = false;
+	scope->open_query = -1;
+}
+/*------------------------------------------------------------------------------
+	Call once per frame, this is where GPU results are picked up
+------------------------------------------------------------------------------*/
+void oglh_timer_new_frame(void)
+{
+	int scope_id, number = scopes();
+
+	timers->frame++;
+	for(scope_id = 0; scope_id < number; scope_id++)
+		collect_gpu_results(&timers->scope[scope_id]);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_timer_report(void)
+{
+	int scope_id, number = scopes();
+	TIMER_SCOPE *scope;
+	float cpu_min, cpu_average, cpu_p99, gpu_min, gpu_average, gpu_p99;
+
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+	printf(ANSI_COLOR_GREEN);
+	printf("\t%-30s %9s %5s %5s %10s %5s %5s\n", "scope timers (ms)",
+		"cpu min", "avg", "p99", "gpu min", "avg", "p99");
+	printf(ANSI_COLOR_RESET);
+
+	for(scope_id = 0; scope_id < number; scope_id++)
+	{
+		scope = &timers->scope[scope_id];
+		ring_statistics(&scope->cpu, &cpu_min, &cpu_average, &cpu_p99);
+		ring_statistics(&scope->gpu, &gpu_min, &gpu_average, &gpu_p99);
+
+		printf("\t%-30s %9.3f %5.3f %5.3f", scope_name[scope_id],
+			cpu_min, cpu_average, cpu_p99);
+
+		if(scope->gpu.count == 0)
+		{
+			printf(ANSI_COLOR_YELLOW "    (no GPU results yet)\n" ANSI_COLOR_RESET);
+			continue;
+		}
+
+		printf(ANSI_COLOR_CYAN " %10.3f %5.3f %5.3f" ANSI_COLOR_RESET,
+			gpu_min, gpu_average, gpu_p99);
+
+		if(scope->gpu_skipped > 0)
+		{
+			printf(ANSI_COLOR_YELLOW "  %ld skipped" ANSI_COLOR_RESET,
+				scope->gpu_skipped);
+		}
+		printf("\n");
+	}
+
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_timer_dump_csv(FILE *csv_fptr)
+{
+	int scope_id, number = scopes();
+	TIMER_SCOPE *scope;
+	float cpu_min, cpu_average, cpu_p99, gpu_min, gpu_average, gpu_p99;
+
+	fprintf(csv_fptr, "scope,cpu_samples,cpu_min_ms,cpu_avg_ms,cpu_p99_ms,"
+		"gpu_samples,gpu_min_ms,gpu_avg_ms,gpu_p99_ms,gpu_skipped\n");
+
+	for(scope_id = 0; scope_id < number; scope_id++)
+	{
+		scope = &timers->scope[scope_id];
+		ring_statistics(&scope->cpu, &cpu_min, &cpu_average, &cpu_p99);
+		ring_statistics(&scope->gpu, &gpu_min, &gpu_average, &gpu_p99);
+
+		fprintf(csv_fptr, "\"%s\",%d,%.6f,%.6f,%.6f,%d,%.6f,%.6f,%.6f,%ld\n",
+			scope_name[scope_id],
+			scope->cpu.count, cpu_min, cpu_average, cpu_p99,
+			scope->gpu.count, gpu_min, gpu_average, gpu_p99,
+			scope->gpu_skipped);
+	}
+}
+/*------------------------------------------------------------------------------
+	deletes the queries and clears the history -- the scopes stay registered
+	since their ids are cached by OGLH_TIMER_BEGIN
+------------------------------------------------------------------------------*/
+void oglh_timer_delete_all(void)
+{
+	int scope_id, index, number = scopes();
+	TIMER_SCOPE *scope;
+
+	for(scope_id = 0; scope_id < number; scope_id++)
+	{
+		scope = &timers->scope[scope_id];
+		if(scope->query[0][0] != 0)
+		{
+			for(index = 0; index < OGLH_TIMER_QUERIES; index++)
+				glDeleteQueries(2, scope->query[index]);
+		}
+
+		memset(scope->query, 0, sizeof(scope->query));
+		memset(scope->query_state, 0, sizeof(scope->query_state));
+		memset(&scope->cpu, 0, sizeof(SAMPLE_RING));
+		memset(&scope->gpu, 0, sizeof(SAMPLE_RING));
+		scope->open = false;
+		scope->open_query = -1;
+		scope->next_query = 0;
+		scope->gpu_skipped = 0;
+	}
+}
+/*------------------------------------------------------------------------------
+	The timers as a part of an oglh context, see OpenGL_context.h. The part
+	goes without GL calls, so its queries are left to oglh_timer_delete_all.
+------------------------------------------------------------------------------*/
+void *oglh_timers_new_context(void)
+{
+	return calloc(1, sizeof(TIMER_CONTEXT));
+}
+
+void oglh_timers_use_context(void *part)
+{
+	timers = part != NULL ? part : &default_timers;
+}
+
+void oglh_timers_delete_context(void *part)
+{
+	if(part == timers) timers = &default_timers;
+	free(part);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
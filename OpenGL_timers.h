@@ -0,0 +1,71 @@
+/*------------------------------------------------------------------------------
+	oglh_ timers -- scoped GPU and CPU timing
+
+	Each named scope is timed twice: on the CPU with the monotonic clock and
+	on the GPU with a pair of GL_TIMESTAMP queries (timestamps rather than
+	GL_TIME_ELAPSED so that scopes can nest). GPU results are only collected
+	OGLH_TIMER_FRAME_LATENCY frames after they were issued, and only if the
+	query says it is available, so reading them never stalls. If a scope
+	runs out of free queries the GPU sample is skipped and counted.
+
+	The last OGLH_TIMER_HISTORY samples of each scope are kept in a ring and
+	reported as min / average / 99th percentile.
+
+	oglh_timer_new_frame();			// once per frame
+	...
+	OGLH_TIMER_BEGIN("shadow pass");
+	... draw ...
+	OGLH_TIMER_END();
+	...
+	oglh_timer_report();			// or oglh_timer_dump_csv(file)
+
+	The OGLH_TIMER_ macros compile to nothing unless OGLH_TIMERS is defined,
+	and when it is defined oglh_install_shader, oglh_set_rendering_to_fbo
+	and oglh_blit_fbo_to_front_buffer are timed too. Use at most one
+	OGLH_TIMER_BEGIN per C block; for anything fancier call
+	oglh_timer_register, oglh_timer_begin and oglh_timer_end directly.
+
+	Scopes are registered for the whole process; each oglh context times
+	them with queries of its own, and the report and CSV are the current
+	context's.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_TIMER_MAX_SCOPES		64
+#define OGLH_TIMER_NAME_SIZE		32
+#define OGLH_TIMER_HISTORY			256	// samples kept per scope
+#define OGLH_TIMER_QUERIES			16	// GPU query pairs in flight per scope
+#define OGLH_TIMER_FRAME_LATENCY	3	// frames before a result is read
+
+#ifdef OGLH_TIMERS
+#define OGLH_TIMER_BEGIN(name)											\
+	static int oglh_timer_scope_id = -1;								\
+	if(oglh_timer_scope_id < 0)											\
+		oglh_timer_scope_id = oglh_timer_register(name);				\
+	oglh_timer_begin(oglh_timer_scope_id)
+#define OGLH_TIMER_END() oglh_timer_end(oglh_timer_scope_id)
+#else
+#define OGLH_TIMER_BEGIN(name) do { } while(0)
+#define OGLH_TIMER_END() do { } while(0)
+#endif
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int oglh_timer_register(const char *scope_name);
+void oglh_timer_begin(int scope_id);
+void oglh_timer_end(int scope_id);
+void oglh_timer_new_frame(void);
+void oglh_timer_report(void);
+void oglh_timer_dump_csv(FILE *csv_fptr);
+void oglh_timer_delete_all(void);
+
+// for OpenGL_context.c
+void *oglh_timers_new_context(void);
+void oglh_timers_use_context(void *part);
+void oglh_timers_delete_context(void *part);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
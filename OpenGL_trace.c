@@ -0,0 +1,555 @@
+/*------------------------------------------------------------------------------
+	oglh_ trace -- binary record and replay of the helper calls
+
+	The trace is the magic string followed by records, each an opcode byte
+	and its fields in host byte order:
+
+	NAME			u16 id, u16 length, characters
+	UNIFORM			u16 name id, u32 GL type, u8 byte count, the bytes
+	INSTALL_SHADER	u16 name id, u64 vertex hash, u64 fragment hash
+	FBO				i32 width, i32 height
+	BLIT
+	DRAW_ARRAYS		u32 mode, i32 first, i32 count
+	DRAW_ELEMENTS	u32 mode, i32 count, u32 type, u64 offset
+	END_FRAME
+
+	Uniform and shader names are sent once as a NAME and referred to by id
+	after that, so a frame of uniform sets is a few bytes per call.
+------------------------------------------------------------------------------*/
+#include "OpenGL_trace.h"
+#include "OpenGL_registry.h"
+#include "OpenGL_state.h"
+#include <stdint.h>			//	Fixed-width integer types
+#include <time.h>			//	Time/date utilities
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OP_NAME				1
+#define OP_UNIFORM			2
+#define OP_INSTALL_SHADER	3
+#define OP_FBO				4
+#define OP_BLIT				5
+#define OP_DRAW_ARRAYS		6
+#define OP_DRAW_ELEMENTS	7
+#define OP_END_FRAME		8
+
+#define NAME_TABLE_SIZE		(2 * OGLH_TRACE_MAX_NAMES)	// a power of two
+#define TRACE_BUFFER_SIZE	(1024 * 1024)
+
+bool oglh_trace_hooks_on = false;
+
+static bool recording = false;
+static FILE *trace_fptr = NULL;
+static char *trace_buffer = NULL;
+
+static char *name_table[NAME_TABLE_SIZE];	// open addressing on the hash
+static uint16_t name_table_id[NAME_TABLE_SIZE];
+static int number_of_names = 0;
+
+static uint64_t vertex_source_hash, fragment_source_hash;
+/*------------------------------------------------------------------------------
+	FNV-1a, 64 bit
+------------------------------------------------------------------------------*/
+static uint64_t hash_bytes(const void *data, size_t length)
+{
+	const unsigned char *byte = data;
+	uint64_t hash = 14695981039346656037ull;
+
+	while(length--)
+	{
+		hash ^= *byte++;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void put_u8(uint8_t value)	{ fwrite(&value, 1, 1, trace_fptr); }
+static void put_u16(uint16_t value)	{ fwrite(&value, 2, 1, trace_fptr); }
+static void put_u32(uint32_t value)	{ fwrite(&value, 4, 1, trace_fptr); }
+static void put_u64(uint64_t value)	{ fwrite(&value, 8, 1, trace_fptr); }
+/*------------------------------------------------------------------------------
+	the id for a name, writing a NAME record the first time it is seen
+------------------------------------------------------------------------------*/
+static uint16_t name_id(const char *name)
+{
+	size_t length = strlen(name);
+	unsigned int slot;
+
+	slot = (unsigned int)hash_bytes(name, length) & (NAME_TABLE_SIZE - 1);
+	while(name_table[slot] != NULL)
+	{
+		if(!strcmp(name_table[slot], name)) return name_table_id[slot];
+		slot = (slot + 1) & (NAME_TABLE_SIZE - 1);
+	}
+
+	if(number_of_names >= OGLH_TRACE_MAX_NAMES || length > UINT16_MAX)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"trace name table is full (%d names)", OGLH_TRACE_MAX_NAMES);
+		return 0;
+	}
+
+	name_table[slot] = strdup(name);
+	name_table_id[slot] = (uint16_t)number_of_names++;
+
+	put_u8(OP_NAME);
+	put_u16(name_table_id[slot]);
+	put_u16((uint16_t)length);
+	fwrite(name, length, 1, trace_fptr);
+
+	return name_table_id[slot];
+}
+/*------------------------------------------------------------------------------
+	bytes of data behind the void pointer oglh_set_uniform_variable takes
+------------------------------------------------------------------------------*/
+static int uniform_data_bytes(int type)
+{
+	switch(type)
+	{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+		case GL_FLOAT:			return 4;
+		case GL_FLOAT_VEC2:		return 8;
+		case GL_FLOAT_VEC3:		return 12;
+		case GL_FLOAT_VEC4:		return 16;
+		case GL_FLOAT_MAT4:		return 64;
+		default:				return 0;
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_record_start(const char *trace_file_name)
+{
+	if(recording)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"a trace is already being recorded");
+		return;
+	}
+
+	if((trace_fptr = fopen(trace_file_name, "wb")) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't open trace file: %s", trace_file_name);
+		return;
+	}
+
+	// a big stdio buffer so the render thread rarely touches the disk
+	if((trace_buffer = (char *)malloc(TRACE_BUFFER_SIZE)) != NULL)
+		setvbuf(trace_fptr, trace_buffer, _IOFBF, TRACE_BUFFER_SIZE);
+
+	fwrite(OGLH_TRACE_MAGIC, strlen(OGLH_TRACE_MAGIC), 1, trace_fptr);
+	recording = oglh_trace_hooks_on = true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_record_stop(void)
+{
+	int slot;
+
+	if(!recording) return;
+
+	fclose(trace_fptr);
+	trace_fptr = NULL;
+	free(trace_buffer);
+	trace_buffer = NULL;
+
+	for(slot = 0; slot < NAME_TABLE_SIZE; slot++)
+	{
+		free(name_table[slot]);
+		name_table[slot] = NULL;
+	}
+	number_of_names = 0;
+	recording = oglh_trace_hooks_on = false;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_end_frame(void)
+{
+	if(recording) put_u8(OP_END_FRAME);
+}
+/*------------------------------------------------------------------------------
+	the hooks
+------------------------------------------------------------------------------*/
+void oglh_trace_uniform(const char *variable_name, int type, const void *data)
+{
+	int bytes;
+	uint16_t id;
+
+	if(!recording || (bytes = uniform_data_bytes(type)) == 0) return;
+
+	id = name_id(variable_name);
+	put_u8(OP_UNIFORM);
+	put_u16(id);
+	put_u32(type);
+	put_u8((uint8_t)bytes);
+	fwrite(data, bytes, 1, trace_fptr);
+}
+/*------------------------------------------------------------------------------
+	the hash is kept while replaying too, to check the shader hasn't changed
+------------------------------------------------------------------------------*/
+void oglh_trace_shader_source(GLenum shader_type, const char *source_code)
+{
+	uint64_t hash = hash_bytes(source_code, strlen(source_code));
+
+	if(shader_type == GL_VERTEX_SHADER)
+		vertex_source_hash = hash;
+	else
+		fragment_source_hash = hash;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_install_shader(const char *shader_name)
+{
+	uint16_t id;
+
+	if(!recording) return;
+
+	id = name_id(shader_name);
+	put_u8(OP_INSTALL_SHADER);
+	put_u16(id);
+	put_u64(vertex_source_hash);
+	put_u64(fragment_source_hash);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_fbo(int width, int height)
+{
+	if(!recording) return;
+
+	put_u8(OP_FBO);
+	put_u32(width);
+	put_u32(height);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_blit(void)
+{
+	if(recording) put_u8(OP_BLIT);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_draw_arrays(GLenum mode, GLint first, GLsizei count)
+{
+	if(!recording) return;
+
+	put_u8(OP_DRAW_ARRAYS);
+	put_u32(mode);
+	put_u32(first);
+	put_u32(count);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_draw_elements
+(
+	GLenum mode, GLsizei count, GLenum type, GLintptr offset
+)
+{
+	if(!recording) return;
+
+	put_u8(OP_DRAW_ELEMENTS);
+	put_u32(mode);
+	put_u32(count);
+	put_u32(type);
+	put_u64(offset);
+}
+/*------------------------------------------------------------------------------
+	replay: reading from the loaded trace, false if it runs out early
+------------------------------------------------------------------------------*/
+typedef struct trace_reader
+{
+	const unsigned char *next, *end;
+}
+TRACE_READER;
+
+static bool get_bytes(TRACE_READER *reader, void *data, size_t length)
+{
+	if((size_t)(reader->end - reader->next) < length) return false;
+	memcpy(data, reader->next, length);
+	reader->next += length;
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static double milliseconds_between(struct timespec *from, struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1.0e3 +
+		(to->tv_nsec - from->tv_nsec) * 1.0e-6;
+}
+/*------------------------------------------------------------------------------
+	Replays a trace into the current context. GPU time per frame comes from
+	GL_TIMESTAMP queries that are only read once the whole trace has been
+	submitted so the replay never waits on them.
+------------------------------------------------------------------------------*/
+bool oglh_trace_replay
+(
+	const char *trace_file_name, FILE *frame_csv_fptr,
+	OGLH_TRACE_REPLAY_RESULT *result
+)
+{
+	FILE *replay_fptr;
+	long file_size, frame, frame_capacity = 0, capacity;
+	unsigned char *trace = NULL, opcode;
+	char **names = NULL;
+	TRACE_READER reader;
+	GLuint (*frame_query)[2] = NULL, (*more_query)[2];
+	GLuint vertex_array_id, element_buffer;
+	double *frame_cpu_ms = NULL, *more_cpu_ms, gpu_ms;
+	struct timespec frame_start, frame_end;
+	bool intact = true, out_of_memory = false, frame_open = false;
+	bool have_front_buffer;
+	int index;
+	uint16_t id, length;
+	uint32_t type, mode, index_type;
+	uint64_t offset, vertex_hash, fragment_hash;
+	int32_t width, height, first, count;
+	uint8_t bytes;
+	float uniform_data[16];
+	GLuint64 begin_ns, end_ns;
+
+	memset(result, 0, sizeof(OGLH_TRACE_REPLAY_RESULT));
+
+	if((replay_fptr = fopen(trace_file_name, "rb")) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't open trace file: %s", trace_file_name);
+		return false;
+	}
+	fseek(replay_fptr, 0, SEEK_END);
+	file_size = ftell(replay_fptr);
+	rewind(replay_fptr);
+
+	trace = (unsigned char *)malloc(file_size > 0 ? file_size : 1);
+	names = (char **)calloc(OGLH_TRACE_MAX_NAMES, sizeof(char *));
+	if(trace == NULL || names == NULL ||
+		fread(trace, 1, file_size, replay_fptr) != (size_t)file_size)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't read trace file: %s", trace_file_name);
+		fclose(replay_fptr);
+		free(trace);
+		free(names);
+		return false;
+	}
+	fclose(replay_fptr);
+
+	reader.next = trace;
+	reader.end = trace + file_size;
+	if(file_size < (long)strlen(OGLH_TRACE_MAGIC) ||
+		memcmp(trace, OGLH_TRACE_MAGIC, strlen(OGLH_TRACE_MAGIC)))
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"%s is not an oglh_ trace", trace_file_name);
+		free(trace);
+		free(names);
+		return false;
+	}
+	reader.next += strlen(OGLH_TRACE_MAGIC);
+
+	// a core profile won't draw without a VAO bound
+	vertex_array_id = oglh_registry_generate(OGLH_OBJECT_VERTEX_ARRAY);
+	oglh_state_bind_vertex_array(vertex_array_id);
+
+	// a headless context has no window to blit to
+	oglh_state_bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	have_front_buffer =
+		glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_UNDEFINED;
+
+	oglh_trace_hooks_on = true;	// for the shader source hashes
+	frame = 0;
+	clock_gettime(CLOCK_MONOTONIC, &frame_start);
+
+	while(intact && reader.next < reader.end)
+	{
+		// the frames so far are kept and reported if there's no more room
+		if(frame >= frame_capacity)
+		{
+			capacity = frame_capacity ? 2 * frame_capacity : 256;
+			if((more_query = realloc(frame_query,
+				capacity * sizeof(*frame_query))) != NULL)
+			{
+				frame_query = more_query;
+			}
+			if((more_cpu_ms = realloc(frame_cpu_ms,
+				capacity * sizeof(double))) != NULL)
+			{
+				frame_cpu_ms = more_cpu_ms;
+			}
+			if(more_query == NULL || more_cpu_ms == NULL)
+			{
+				oglh_program_error(__FILE__, __LINE__, __FUNC__,
+					"no memory for %ld frames, replay of %s stopped",
+					capacity, trace_file_name);
+				out_of_memory = true;
+				break;
+			}
+			glGenQueries(2 * (capacity - frame), frame_query[frame]);
+			frame_capacity = capacity;
+		}
+
+		if(!frame_open)
+		{
+			glQueryCounter(frame_query[frame][0], GL_TIMESTAMP);
+			frame_open = true;
+		}
+
+		opcode = *reader.next++;
+		result->records++;
+
+		switch(opcode)
+		{
+			case OP_NAME:
+				intact = get_bytes(&reader, &id, 2) &&
+					get_bytes(&reader, &length, 2) &&
+					id < OGLH_TRACE_MAX_NAMES &&
+					(size_t)(reader.end - reader.next) >= length;
+				if(!intact) break;
+				free(names[id]);
+				names[id] = strndup((const char *)reader.next, length);
+				reader.next += length;
+			break;
+
+			case OP_UNIFORM:
+				intact = get_bytes(&reader, &id, 2) &&
+					get_bytes(&reader, &type, 4) &&
+					get_bytes(&reader, &bytes, 1) &&
+					bytes <= sizeof(uniform_data) &&
+					get_bytes(&reader, uniform_data, bytes) &&
+					id < OGLH_TRACE_MAX_NAMES && names[id] != NULL;
+				if(!intact) break;
+				oglh_set_uniform_variable(names[id], type, uniform_data);
+			break;
+
+			case OP_INSTALL_SHADER:
+				intact = get_bytes(&reader, &id, 2) &&
+					get_bytes(&reader, &vertex_hash, 8) &&
+					get_bytes(&reader, &fragment_hash, 8) &&
+					id < OGLH_TRACE_MAX_NAMES && names[id] != NULL;
+				if(!intact) break;
+				if(oglh_install_shader(names[id]) != 0 &&
+					(vertex_hash != vertex_source_hash ||
+					fragment_hash != fragment_source_hash))
+				{
+					oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+						"shader %s has changed since it was recorded",
+						names[id]);
+				}
+			break;
+
+			case OP_FBO:
+				intact = get_bytes(&reader, &width, 4) &&
+					get_bytes(&reader, &height, 4);
+				if(!intact) break;
+				oglh_set_rendering_to_fbo(width, height);
+			break;
+
+			case OP_BLIT:
+				if(have_front_buffer) oglh_blit_fbo_to_front_buffer();
+			break;
+
+			case OP_DRAW_ARRAYS:
+				intact = get_bytes(&reader, &mode, 4) &&
+					get_bytes(&reader, &first, 4) &&
+					get_bytes(&reader, &count, 4);
+				if(!intact) break;
+				glDrawArrays(mode, first, count);
+			break;
+
+			case OP_DRAW_ELEMENTS:
+				intact = get_bytes(&reader, &mode, 4) &&
+					get_bytes(&reader, &count, 4) &&
+					get_bytes(&reader, &index_type, 4) &&
+					get_bytes(&reader, &offset, 8);
+				if(!intact) break;
+				oglh_state_get_integerv(GL_ELEMENT_ARRAY_BUFFER_BINDING,
+					(GLint *)&element_buffer);
+				if(element_buffer != 0)
+				{
+					glDrawElements(mode, count, index_type,
+						(const void *)(uintptr_t)offset);
+				}
+				else	// no indices in this context, keep the vertex load
+				{
+					glDrawArrays(mode, 0, count);
+				}
+			break;
+
+			case OP_END_FRAME:
+				glQueryCounter(frame_query[frame][1], GL_TIMESTAMP);
+				clock_gettime(CLOCK_MONOTONIC, &frame_end);
+				frame_cpu_ms[frame++] = milliseconds_between(&frame_start, &frame_end);
+				frame_start = frame_end;
+				frame_open = false;
+			break;
+
+			default:
+				intact = false;
+			break;
+		}
+	}
+
+	if(!intact)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"trace %s is damaged after %ld records, replay stopped",
+			trace_file_name, result->records);
+	}
+
+	glFinish();
+	oglh_trace_hooks_on = recording;
+
+	if(frame_csv_fptr != NULL)
+		fprintf(frame_csv_fptr, "frame,cpu_ms,gpu_ms\n");
+
+	result->frames = frame;
+	result->cpu_ms_min = result->gpu_ms_min = 1.0e30;
+	for(frame = 0; frame < result->frames; frame++)
+	{
+		glGetQueryObjectui64v(frame_query[frame][0], GL_QUERY_RESULT, &begin_ns);
+		glGetQueryObjectui64v(frame_query[frame][1], GL_QUERY_RESULT, &end_ns);
+		gpu_ms = (end_ns - begin_ns) * 1.0e-6;
+
+		result->cpu_ms_total += frame_cpu_ms[frame];
+		if(frame_cpu_ms[frame] < result->cpu_ms_min)
+			result->cpu_ms_min = frame_cpu_ms[frame];
+		if(frame_cpu_ms[frame] > result->cpu_ms_max)
+			result->cpu_ms_max = frame_cpu_ms[frame];
+
+		result->gpu_ms_total += gpu_ms;
+		if(gpu_ms < result->gpu_ms_min) result->gpu_ms_min = gpu_ms;
+		if(gpu_ms > result->gpu_ms_max) result->gpu_ms_max = gpu_ms;
+
+		if(frame_csv_fptr != NULL)
+		{
+			fprintf(frame_csv_fptr, "%ld,%.6f,%.6f\n",
+				frame, frame_cpu_ms[frame], gpu_ms);
+		}
+	}
+	if(result->frames == 0) result->cpu_ms_min = result->gpu_ms_min = 0.0;
+
+	if(frame_capacity > 0) glDeleteQueries(2 * frame_capacity, frame_query[0]);
+	oglh_registry_delete(OGLH_OBJECT_VERTEX_ARRAY, vertex_array_id);
+	for(index = 0; index < OGLH_TRACE_MAX_NAMES; index++) free(names[index]);
+	free(names);
+	free(trace);
+	free(frame_query);
+	free(frame_cpu_ms);
+
+	oglh_error_check(__FILE__, __LINE__, __FUNC__);
+	return intact && !out_of_memory;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
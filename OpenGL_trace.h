@@ -0,0 +1,86 @@
+/*------------------------------------------------------------------------------
+	oglh_ trace -- binary record and replay of the helper calls
+
+	Build the helpers with OGLH_TRACE defined and every oglh_ call can be
+	written to a compact binary trace: uniform sets with their values,
+	shader installs with the hashes of their sources, FBO set up, blits
+	and draws. The trace can then be replayed, as fast as the GL will go,
+	with per-frame CPU and GPU timings -- a deterministic benchmark that
+	doesn't need the original application.
+
+	oglh_trace_record_start("field.trace");
+	while(running)
+	{
+		... oglh_ calls ...
+		oglh_trace_end_frame();
+	}
+	oglh_trace_record_stop();
+
+	and later, with a context current (tools/oglh_replay.c makes a headless
+	one):
+
+	oglh_trace_replay("field.trace", stdout);	// per-frame CSV to stdout
+
+	Only what goes through the helpers is recorded. Vertex data is not, so
+	draws are replayed with the geometry that is bound at the time, and
+	shaders are installed again from their files -- a warning is given if
+	a source hash no longer matches the recording.
+
+	Without OGLH_TRACE the hooks compile to nothing.
+------------------------------------------------------------------------------*/
+#pragma once
+#include "OpenGL_helpers.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define OGLH_TRACE_MAGIC			"OGLHTRC1"
+#define OGLH_TRACE_MAX_NAMES		4096
+
+typedef struct oglh_trace_replay_result
+{
+	long frames;
+	long records;
+	double cpu_ms_total, cpu_ms_min, cpu_ms_max;	// submission per frame
+	double gpu_ms_total, gpu_ms_min, gpu_ms_max;	// execution per frame
+}
+OGLH_TRACE_REPLAY_RESULT;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+void oglh_trace_record_start(const char *trace_file_name);
+void oglh_trace_record_stop(void);
+void oglh_trace_end_frame(void);
+
+bool oglh_trace_replay
+(
+	const char *trace_file_name, FILE *frame_csv_fptr,
+	OGLH_TRACE_REPLAY_RESULT *result
+);
+/*------------------------------------------------------------------------------
+	Hooks called by the helpers
+------------------------------------------------------------------------------*/
+#ifdef OGLH_TRACE
+
+extern bool oglh_trace_hooks_on;	// recording or replaying
+
+#define OGLH_TRACE_HOOK(call) do { if(oglh_trace_hooks_on) call; } while(0)
+
+#else
+
+#define OGLH_TRACE_HOOK(call) do { } while(0)
+
+#endif
+
+void oglh_trace_uniform(const char *variable_name, int type, const void *data);
+void oglh_trace_shader_source(GLenum shader_type, const char *source_code);
+void oglh_trace_install_shader(const char *shader_name);
+void oglh_trace_fbo(int width, int height);
+void oglh_trace_blit(void);
+void oglh_trace_draw_arrays(GLenum mode, GLint first, GLsizei count);
+void oglh_trace_draw_elements
+(
+	GLenum mode, GLsizei count, GLenum type, GLintptr offset
+);
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,683 @@
+/*------------------------------------------------------------------------------
+	oglh_bench -- microbenchmarks of the helpers on a headless context
+
+	oglh_bench [-o results.json] [-n iterations] [-c error_check_level]
+
+	Times the helpers one at a time and writes ns/op and GL calls/op to a
+	JSON file (oglh_bench.json by default) so runs can be compared before
+	and after a change:
+
+		uniform sets of each type, by pointer and by value
+		uniform reads
+		oglh_install_shader cold and warm, on generated shaders of
+			increasing size
+		oglh_set_rendering_to_fbo
+		oglh_blit_fbo_to_front_buffer at several resolutions, as bandwidth
+
+	-n scales the iteration counts (100000 uniform sets by default) and -c
+	sets the error check level for the run. GL calls/op need OGLH_COUNTERS;
+	without it they are written as null. Counting adds a little to ns/op,
+	so build twice if the difference matters. The generated shaders go in
+	a temporary directory that is removed afterwards.
+
+	cc -O2 -DGL_GLEXT_PROTOTYPES -DOGLH_COUNTERS -I.. oglh_bench.c \
+		../OpenGL_helpers.c ../OpenGL_registry.c ../OpenGL_counters.c \
+		../OpenGL_timers.c ../OpenGL_trace.c ../OpenGL_headless.c \
+		../OpenGL_texture_units.c ../OpenGL_state.c ../OpenGL_instancing.c \
+		../OpenGL_stream.c ../OpenGL_indirect.c ../OpenGL_feedback.c \
+		../OpenGL_shader_pack.c -lEGL -lGL -lm -o oglh_bench
+------------------------------------------------------------------------------*/
+#include "OpenGL_helpers.h"
+#include "OpenGL_headless.h"
+#include "OpenGL_registry.h"
+#include <time.h>			//	Time/date utilities
+#include <unistd.h>			//	getpid, rmdir, unlink
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define BENCH_MAX_RESULTS			128
+#define BENCH_NAME_SIZE				64
+#define BENCH_UNIFORM_ITERATIONS	100000
+#define BENCH_GET_ITERATIONS		20000
+#define BENCH_WARM_INSTALLS			5
+#define BENCH_FBO_ITERATIONS		50
+#define BENCH_BLIT_ITERATIONS		50
+#define BENCH_FRONT_WIDTH			3840
+#define BENCH_FRONT_HEIGHT			2160
+
+typedef struct bench_result
+{
+	char name[BENCH_NAME_SIZE];
+	long ops;
+	double ns_per_op;
+	double gl_calls_per_op;
+	double bytes_per_second;	// zero when it isn't a bandwidth test
+}
+BENCH_RESULT;
+
+typedef void (*BENCH_OPERATION)(long iteration, void *argument);
+
+static BENCH_RESULT results[BENCH_MAX_RESULTS];
+static int number_of_results = 0;
+static double iteration_scale = 1.0;
+static char shader_directory[FILENAME_MAX];
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static double now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+/*------------------------------------------------------------------------------
+	Runs operation ops times between glFinish calls, so queued GPU work is
+	paid for inside the measurement. The counters' frame boundary brackets
+	the loop, the last frame then holds just the loop's GL calls.
+------------------------------------------------------------------------------*/
+static BENCH_RESULT *run_bench
+(
+	const char *name, long ops, BENCH_OPERATION operation, void *argument
+)
+{
+	BENCH_RESULT *result;
+	double start;
+	long iteration;
+
+	if(number_of_results == BENCH_MAX_RESULTS)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"more than %d benchmarks", BENCH_MAX_RESULTS);
+		return NULL;
+	}
+	if(ops < 1) ops = 1;
+
+	result = &results[number_of_results++];
+	snprintf(result->name, BENCH_NAME_SIZE, "%s", name);
+	result->ops = ops;
+	result->bytes_per_second = 0.0;
+
+	glFinish();
+	oglh_counters_new_frame();
+	start = now_ns();
+
+	for(iteration = 0; iteration < ops; iteration++)
+		operation(iteration, argument);
+
+	glFinish();
+	result->ns_per_op = (now_ns() - start) / ops;
+	oglh_counters_new_frame();
+	result->gl_calls_per_op = (double)oglh_counters_get(NULL, -1) / ops;
+
+	return result;
+}
+/*------------------------------------------------------------------------------
+	A short untimed run first, so first-use costs don't land in the numbers
+------------------------------------------------------------------------------*/
+static void warm_up(long ops, BENCH_OPERATION operation, void *argument)
+{
+	long iteration;
+
+	for(iteration = 0; iteration < ops / 10 + 1; iteration++)
+		operation(iteration, argument);
+	glFinish();
+}
+/*------------------------------------------------------------------------------
+	iterations as set by -n
+------------------------------------------------------------------------------*/
+static long scaled(long iterations)
+{
+	long ops = iterations * iteration_scale;
+
+	return ops < 1 ? 1 : ops;
+}
+/*------------------------------------------------------------------------------
+	Shader sources for the benchmarks, written to the temporary directory
+------------------------------------------------------------------------------*/
+static bool write_text_file(const char *file_name, const char *text)
+{
+	FILE *text_fptr;
+	bool written;
+
+	if((text_fptr = fopen(file_name, "w")) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't write %s", file_name);
+		return false;
+	}
+	written = fputs(text, text_fptr) >= 0;
+	return fclose(text_fptr) == 0 && written;
+}
+
+static bool write_shader_file
+(
+	const char *shader_name, const char *extension, const char *text
+)
+{
+	char file_name[FILENAME_MAX];
+
+	if(text == NULL || snprintf(file_name, FILENAME_MAX, "%s%s",
+			shader_name, extension) >= FILENAME_MAX)
+	{
+		return false;
+	}
+	return write_text_file(file_name, text);
+}
+
+static void remove_shader_files(const char *shader_name)
+{
+	char file_name[FILENAME_MAX];
+
+	if(snprintf(file_name, FILENAME_MAX, "%s.vert", shader_name) < FILENAME_MAX)
+		unlink(file_name);
+	if(snprintf(file_name, FILENAME_MAX, "%s.frag", shader_name) < FILENAME_MAX)
+		unlink(file_name);
+}
+/*------------------------------------------------------------------------------
+	Every uniform type the setters handle, all of them live so none are
+	optimised away
+------------------------------------------------------------------------------*/
+static const char *uniform_vertex_source =
+	"#version 330 compatibility\n"
+	"uniform int u_int;\n"
+	"uniform bool u_bool;\n"
+	"uniform float u_float;\n"
+	"uniform vec2 u_vec2;\n"
+	"uniform vec3 u_vec3;\n"
+	"uniform mat4 u_mat4;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = u_mat4 * gl_Vertex + vec4(u_vec3, u_float)\n"
+	"		+ vec4(u_vec2, float(u_int), u_bool ? 1.0 : 0.0);\n"
+	"}\n";
+
+static const char *uniform_fragment_source =
+	"#version 330 compatibility\n"
+	"uniform sampler2D u_sampler;\n"
+	"uniform vec4 u_vec4;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = texture(u_sampler, vec2(0.5)) * u_vec4;\n"
+	"}\n";
+/*------------------------------------------------------------------------------
+	statements lines of dependent arithmetic in each stage. The run tag
+	makes the source unique so a driver's on-disk shader cache can't turn
+	the cold install warm.
+------------------------------------------------------------------------------*/
+static char *generate_shader_source
+(
+	GLenum shader_type, int statements, const char *run_tag
+)
+{
+	size_t size = 256 + statements * 64;
+	char *source_code, *end;
+	int statement;
+
+	if((source_code = malloc(size)) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"out of memory for a %d statement shader", statements);
+		return NULL;
+	}
+
+	end = source_code;
+	end += sprintf(end, "#version 330 compatibility\n// %s\n", run_tag);
+	end += sprintf(end, "uniform vec4 u_seed;\nvoid main()\n{\n");
+	end += sprintf(end, shader_type == GL_VERTEX_SHADER ?
+		"\tvec4 v = gl_Vertex + u_seed;\n" : "\tvec4 v = gl_Color + u_seed;\n");
+
+	for(statement = 0; statement < statements; statement++)
+	{
+		end += sprintf(end, "\tv = sin(v) * %d.5 + v.yzwx;\n",
+			statement % 7 + 1);
+	}
+
+	sprintf(end, shader_type == GL_VERTEX_SHADER ?
+		"\tgl_Position = v;\n}\n" : "\tgl_FragColor = v;\n}\n");
+	return source_code;
+}
+/*------------------------------------------------------------------------------
+	The operations
+------------------------------------------------------------------------------*/
+typedef struct uniform_argument
+{
+	const char *variable_name;
+	int type;
+}
+UNIFORM_ARGUMENT;
+
+static void set_uniform_variable_operation(long iteration, void *argument)
+{
+	UNIFORM_ARGUMENT *uniform = argument;
+	float identity[16] =
+		{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+	float values[4];
+	int int_value = iteration & 1;
+
+	values[0] = values[1] = values[2] = values[3] = (float)(iteration & 255);
+
+	switch(uniform->type)
+	{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+			oglh_set_uniform_variable(uniform->variable_name, uniform->type,
+				&int_value);
+		break;
+
+		case GL_FLOAT_MAT4:
+			identity[12] = values[0];
+			oglh_set_uniform_variable(uniform->variable_name, uniform->type,
+				identity);
+		break;
+
+		default:
+			oglh_set_uniform_variable(uniform->variable_name, uniform->type,
+				values);
+	}
+}
+
+static void set_uniform_value_operation(long iteration, void *argument)
+{
+	UNIFORM_ARGUMENT *uniform = argument;
+	double value = (double)(iteration & 255);
+
+	switch(uniform->type)
+	{
+		case GL_INT:
+		case GL_BOOL:
+		case GL_SAMPLER_2D:
+			oglh_set_uniform_value(uniform->variable_name, uniform->type,
+				(int)(iteration & 1));
+		break;
+
+		default:
+			oglh_set_uniform_value(uniform->variable_name, uniform->type,
+				value, value, value, value);
+	}
+}
+
+static void get_uniform_variable_operation(long iteration, void *argument)
+{
+	UNIFORM_ARGUMENT *uniform = argument;
+	float values[4];
+
+	(void)iteration;
+	oglh_get_uniform_variable(uniform->variable_name, uniform->type, values);
+}
+
+static void install_shader_operation(long iteration, void *argument)
+{
+	GLuint program_id;
+
+	(void)iteration;
+	program_id = oglh_install_shader((const char *)argument);
+	glUseProgram(0);
+	oglh_registry_delete(OGLH_OBJECT_PROGRAM, program_id);
+}
+
+static void set_rendering_to_fbo_operation(long iteration, void *argument)
+{
+	int *size = argument;
+
+	(void)iteration;
+	oglh_set_rendering_to_fbo(size[0], size[1]);	// deletes the last one
+}
+
+static void blit_operation(long iteration, void *argument)
+{
+	(void)iteration; (void)argument;
+	oglh_blit_fbo_to_front_buffer();
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void bench_uniforms(void)
+{
+	static const UNIFORM_ARGUMENT uniforms[] =
+	{
+		{ "u_int",		GL_INT			},
+		{ "u_bool",		GL_BOOL			},
+		{ "u_sampler",	GL_SAMPLER_2D	},
+		{ "u_float",	GL_FLOAT		},
+		{ "u_vec2",		GL_FLOAT_VEC2	},
+		{ "u_vec3",		GL_FLOAT_VEC3	},
+		{ "u_vec4",		GL_FLOAT_VEC4	},
+		{ "u_mat4",		GL_FLOAT_MAT4	},
+		{ NULL,			0				}
+	};
+	static const UNIFORM_ARGUMENT readable[] =
+	{
+		{ "u_int",		GL_INT			},
+		{ "u_float",	GL_FLOAT		},
+		{ "u_vec4",		GL_FLOAT_VEC4	},
+		{ NULL,			0				}
+	};
+	char shader_name[FILENAME_MAX];
+	char bench_name[BENCH_NAME_SIZE];
+	const UNIFORM_ARGUMENT *uniform;
+	GLuint program_id = 0;
+	long ops;
+
+	if(snprintf(shader_name, FILENAME_MAX, "%s/uniforms",
+			shader_directory) >= FILENAME_MAX)
+	{
+		return;
+	}
+
+	if(write_shader_file(shader_name, ".vert", uniform_vertex_source) &&
+		write_shader_file(shader_name, ".frag", uniform_fragment_source))
+	{
+		program_id = oglh_install_shader(shader_name);
+	}
+	if(program_id == 0)
+	{
+		remove_shader_files(shader_name);
+		return;
+	}
+
+	ops = scaled(BENCH_UNIFORM_ITERATIONS);
+	for(uniform = uniforms; uniform->variable_name != NULL; uniform++)
+	{
+		snprintf(bench_name, BENCH_NAME_SIZE, "set_uniform_variable/%s",
+			oglh_find_uniform_variable_template(uniform->type)->glsl_type_name);
+		warm_up(ops, set_uniform_variable_operation, (void *)uniform);
+		run_bench(bench_name, ops, set_uniform_variable_operation,
+			(void *)uniform);
+
+		if(uniform->type == GL_FLOAT_MAT4) continue; // by pointer only
+		snprintf(bench_name, BENCH_NAME_SIZE, "set_uniform_value/%s",
+			oglh_find_uniform_variable_template(uniform->type)->glsl_type_name);
+		warm_up(ops, set_uniform_value_operation, (void *)uniform);
+		run_bench(bench_name, ops, set_uniform_value_operation,
+			(void *)uniform);
+	}
+
+	ops = scaled(BENCH_GET_ITERATIONS);
+	for(uniform = readable; uniform->variable_name != NULL; uniform++)
+	{
+		snprintf(bench_name, BENCH_NAME_SIZE, "get_uniform_variable/%s",
+			oglh_find_uniform_variable_template(uniform->type)->glsl_type_name);
+		warm_up(ops, get_uniform_variable_operation, (void *)uniform);
+		run_bench(bench_name, ops, get_uniform_variable_operation,
+			(void *)uniform);
+	}
+
+	glUseProgram(0);
+	oglh_registry_delete(OGLH_OBJECT_PROGRAM, program_id);
+	remove_shader_files(shader_name);
+}
+/*------------------------------------------------------------------------------
+	Cold is the first install of a never seen source, warm installs the same
+	files again -- the difference is what the driver caches
+------------------------------------------------------------------------------*/
+static void bench_install_shader(void)
+{
+	static const int shader_statements[] = { 16, 64, 256, 1024, 0 };
+	char shader_name[FILENAME_MAX];
+	char bench_name[BENCH_NAME_SIZE], run_tag[64];
+	char *vertex_source, *fragment_source;
+	const int *statements;
+	bool written;
+
+	snprintf(run_tag, sizeof(run_tag), "oglh_bench %ld.%ld",
+		(long)getpid(), (long)time(NULL));
+
+	for(statements = shader_statements; *statements != 0; statements++)
+	{
+		if(snprintf(shader_name, FILENAME_MAX, "%s/generated_%d",
+				shader_directory, *statements) >= FILENAME_MAX)
+		{
+			return;
+		}
+
+		vertex_source = generate_shader_source(GL_VERTEX_SHADER,
+			*statements, run_tag);
+		fragment_source = generate_shader_source(GL_FRAGMENT_SHADER,
+			*statements, run_tag);
+
+		written = write_shader_file(shader_name, ".vert", vertex_source) &&
+			write_shader_file(shader_name, ".frag", fragment_source);
+		free(vertex_source);
+		free(fragment_source);
+
+		if(written)
+		{
+			snprintf(bench_name, BENCH_NAME_SIZE,
+				"install_shader/cold/%d_statements", *statements);
+			run_bench(bench_name, 1, install_shader_operation, shader_name);
+
+			snprintf(bench_name, BENCH_NAME_SIZE,
+				"install_shader/warm/%d_statements", *statements);
+			run_bench(bench_name, BENCH_WARM_INSTALLS,
+				install_shader_operation, shader_name);
+		}
+		remove_shader_files(shader_name);
+	}
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void bench_fbo_and_blit(void)
+{
+	static const int resolutions[][2] =
+	{
+		{  256,  256 },
+		{ 1280,  720 },
+		{ 1920, 1080 },
+		{ 3840, 2160 },
+		{    0,    0 }
+	};
+	char bench_name[BENCH_NAME_SIZE];
+	BENCH_RESULT *result;
+	bool have_front_buffer;
+	int index;
+
+	for(index = 0; resolutions[index][0] != 0; index++)
+	{
+		snprintf(bench_name, BENCH_NAME_SIZE, "set_rendering_to_fbo/%dx%d",
+			resolutions[index][0], resolutions[index][1]);
+		warm_up(BENCH_FBO_ITERATIONS, set_rendering_to_fbo_operation,
+			(void *)resolutions[index]);
+		run_bench(bench_name, scaled(BENCH_FBO_ITERATIONS),
+			set_rendering_to_fbo_operation, (void *)resolutions[index]);
+	}
+
+	have_front_buffer = oglh_create_headless_front_buffer(BENCH_FRONT_WIDTH,
+		BENCH_FRONT_HEIGHT);
+	if(!have_front_buffer)
+	{
+		oglh_program_warning(__FILE__, __LINE__, __FUNC__,
+			"no front buffer -- the blits are not measured");
+		return;
+	}
+
+	for(index = 0; resolutions[index][0] != 0; index++)
+	{
+		oglh_set_rendering_to_fbo(resolutions[index][0], resolutions[index][1]);
+		glClearColor(0.25, 0.5, 0.75, 1.0);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		snprintf(bench_name, BENCH_NAME_SIZE, "blit_fbo_to_front_buffer/%dx%d",
+			resolutions[index][0], resolutions[index][1]);
+		warm_up(BENCH_BLIT_ITERATIONS, blit_operation, NULL);
+		result = run_bench(bench_name, scaled(BENCH_BLIT_ITERATIONS),
+			blit_operation, NULL);
+
+		// the RGBA8 bytes written to the front buffer
+		if(result != NULL)
+		{
+			result->bytes_per_second = resolutions[index][0] *
+				resolutions[index][1] * 4.0 / (result->ns_per_op * 1e-9);
+		}
+	}
+	oglh_delete_rendering_fbo();
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void write_json_string(FILE *json_fptr, const char *text)
+{
+	fputc('"', json_fptr);
+	for(; text != NULL && *text != '\0'; text++)
+	{
+		if(*text == '"' || *text == '\\')
+			fprintf(json_fptr, "\\%c", *text);
+		else
+		if((unsigned char)*text < ' ')
+			fprintf(json_fptr, "\\u%04x", *text);
+		else
+			fputc(*text, json_fptr);
+	}
+	fputc('"', json_fptr);
+}
+
+static bool write_json(const char *json_file_name)
+{
+	FILE *json_fptr;
+	BENCH_RESULT *result;
+	int index;
+
+	if((json_fptr = fopen(json_file_name, "w")) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't write %s", json_file_name);
+		return false;
+	}
+
+	fprintf(json_fptr, "{\n\t\"renderer\": ");
+	write_json_string(json_fptr, (const char *)glGetString(GL_RENDERER));
+	fprintf(json_fptr, ",\n\t\"version\": ");
+	write_json_string(json_fptr, (const char *)glGetString(GL_VERSION));
+	fprintf(json_fptr, ",\n\t\"error_check_level\": %d", oglh_error_check_level);
+#ifdef OGLH_COUNTERS
+	fprintf(json_fptr, ",\n\t\"counters\": true");
+#else
+	fprintf(json_fptr, ",\n\t\"counters\": false");
+#endif
+	fprintf(json_fptr, ",\n\t\"benchmarks\":\n\t[\n");
+
+	for(index = 0; index < number_of_results; index++)
+	{
+		result = &results[index];
+		fprintf(json_fptr, "\t\t{ \"name\": ");
+		write_json_string(json_fptr, result->name);
+		fprintf(json_fptr, ", \"ops\": %ld, \"ns_per_op\": %.1f",
+			result->ops, result->ns_per_op);
+#ifdef OGLH_COUNTERS
+		fprintf(json_fptr, ", \"gl_calls_per_op\": %.2f",
+			result->gl_calls_per_op);
+#else
+		fprintf(json_fptr, ", \"gl_calls_per_op\": null");
+#endif
+		if(result->bytes_per_second > 0.0)
+		{
+			fprintf(json_fptr, ", \"bytes_per_second\": %.0f",
+				result->bytes_per_second);
+		}
+		fprintf(json_fptr, " }%s\n", index + 1 < number_of_results ? "," : "");
+	}
+
+	fprintf(json_fptr, "\t]\n}\n");
+	return fclose(json_fptr) == 0;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void display_results(const char *json_file_name)
+{
+	BENCH_RESULT *result;
+	int index;
+
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+	printf(ANSI_COLOR_GREEN "\t%-40s %12s %10s %10s\n" ANSI_COLOR_RESET,
+		"benchmark", "ns/op", "calls/op", "MB/s");
+
+	for(index = 0; index < number_of_results; index++)
+	{
+		result = &results[index];
+		printf("\t%-40s %12.1f %10.2f ", result->name, result->ns_per_op,
+			result->gl_calls_per_op);
+		if(result->bytes_per_second > 0.0)
+			printf("%10.1f\n", result->bytes_per_second / 1e6);
+		else
+			printf("%10s\n", "-");
+	}
+
+	printf(ANSI_COLOR_GREEN "\tresults in %s\n" ANSI_COLOR_RESET,
+		json_file_name);
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	const char *json_file_name = "oglh_bench.json";
+	const char *temporary_directory;
+	int option;
+	bool written;
+
+	while((option = getopt(argc, argv, "o:n:c:")) != -1)
+	{
+		switch(option)
+		{
+			case 'o': json_file_name = optarg; break;
+			case 'n': iteration_scale = atof(optarg) /
+				BENCH_UNIFORM_ITERATIONS; break;
+			case 'c': oglh_set_error_check_level(atoi(optarg)); break;
+
+			default:
+				fprintf(stderr, "usage: %s [-o results.json] [-n iterations]"
+					" [-c error_check_level]\n", argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if(iteration_scale <= 0.0) iteration_scale = 1.0;
+
+	if((temporary_directory = getenv("TMPDIR")) == NULL)
+		temporary_directory = "/tmp";
+	snprintf(shader_directory, FILENAME_MAX, "%s/oglh_bench.XXXXXX",
+		temporary_directory);
+	if(mkdtemp(shader_directory) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't make a directory for the shaders in %s",
+			temporary_directory);
+		return EXIT_FAILURE;
+	}
+
+	if(!oglh_create_headless_context(4, 5) &&
+		!oglh_create_headless_context(3, 3))
+	{
+		rmdir(shader_directory);
+		return EXIT_FAILURE;
+	}
+
+	bench_uniforms();
+	bench_install_shader();
+	bench_fbo_and_blit();
+	rmdir(shader_directory);
+
+	written = write_json(json_file_name);
+	display_results(json_file_name);
+
+	oglh_destroy_headless_context();
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,479 @@
+/*------------------------------------------------------------------------------
+	oglh_obj2mesh -- converts a Wavefront OBJ file to an oglh_ .mesh file
+
+	oglh_obj2mesh model.obj model.mesh
+
+	Faces are triangulated as fans and each distinct position, texture
+	coordinate and normal triple becomes one vertex. Every usemtl starts or
+	continues a submesh named after the material, so a mesh is one draw
+	per material. The vertex is
+
+		location 0	position			3 floats
+		location 1	normal				3 floats, if the file has any
+		location 2	texture coordinate	2 floats, if the file has any
+
+	and indices are 16 bit when there are few enough vertices. Everything
+	is read into memory, it is an offline tool. It needs no GL to run:
+
+	cc -O2 -I.. oglh_obj2mesh.c -o oglh_obj2mesh
+------------------------------------------------------------------------------*/
+#include "OpenGL_mesh.h"
+#include <ctype.h>			//	Character classification
+#include <float.h>			//	FLT_MAX
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define LOCATION_POSITION	0
+#define LOCATION_NORMAL		1
+#define LOCATION_TEXCOORD	2
+#define MAX_FACE_VERTICES	64
+
+typedef struct float_array
+{
+	float *value;
+	long count, allocated;		// in floats
+}
+FLOAT_ARRAY;
+
+typedef struct index_array
+{
+	uint32_t *value;
+	long count, allocated;
+}
+INDEX_ARRAY;
+
+typedef struct vertex_key		// 1 based into the OBJ's lists, 0 for none
+{
+	long position, texcoord, normal;
+}
+VERTEX_KEY;
+
+typedef struct submesh_indices
+{
+	char name[OGLH_MESH_NAME_SIZE];
+	INDEX_ARRAY indices;
+}
+SUBMESH_INDICES;
+
+static FLOAT_ARRAY positions, texcoords, normals;
+static VERTEX_KEY *vertex_key;
+static long vertices, vertices_allocated;
+static long *vertex_table;				// open addressing, -1 is empty
+static long vertex_table_size;
+static SUBMESH_INDICES *submesh;
+static int submeshes, submeshes_allocated;
+static bool have_texcoords, have_normals;
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void *grow(void *memory, long *allocated, long needed, size_t size)
+{
+	long allocate = *allocated ? *allocated : 1024;
+
+	if(needed <= *allocated) return memory;
+	while(allocate < needed) allocate *= 2;
+	if((memory = realloc(memory, allocate * size)) == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	*allocated = allocate;
+	return memory;
+}
+
+static void add_floats(FLOAT_ARRAY *array, const float *value, int count)
+{
+	array->value = grow(array->value, &array->allocated, array->count + count,
+		sizeof(float));
+	memcpy(array->value + array->count, value, count * sizeof(float));
+	array->count += count;
+}
+
+static void add_index(INDEX_ARRAY *array, uint32_t value)
+{
+	array->value = grow(array->value, &array->allocated, array->count + 1,
+		sizeof(uint32_t));
+	array->value[array->count++] = value;
+}
+/*------------------------------------------------------------------------------
+	The vertex for a triple, made the first time it is seen
+------------------------------------------------------------------------------*/
+static unsigned long hash_key(const VERTEX_KEY *key)
+{
+	return (unsigned long)key->position * 73856093ul ^
+		(unsigned long)key->texcoord * 19349663ul ^
+		(unsigned long)key->normal * 83492791ul;
+}
+
+static void rehash(void)
+{
+	long index, slot;
+
+	free(vertex_table);
+	vertex_table_size = vertex_table_size ? 2 * vertex_table_size : 4096;
+	if((vertex_table = malloc(vertex_table_size * sizeof(long))) == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(vertex_table, 0xff, vertex_table_size * sizeof(long));
+
+	for(index = 0; index < vertices; index++)
+	{
+		slot = hash_key(&vertex_key[index]) & (vertex_table_size - 1);
+		while(vertex_table[slot] >= 0) slot = (slot + 1) & (vertex_table_size - 1);
+		vertex_table[slot] = index;
+	}
+}
+
+static uint32_t vertex_for(const VERTEX_KEY *key)
+{
+	long slot, index;
+
+	if(2 * (vertices + 1) > vertex_table_size) rehash();
+
+	slot = hash_key(key) & (vertex_table_size - 1);
+	while((index = vertex_table[slot]) >= 0)
+	{
+		if(memcmp(&vertex_key[index], key, sizeof(*key)) == 0) return index;
+		slot = (slot + 1) & (vertex_table_size - 1);
+	}
+
+	vertex_key = grow(vertex_key, &vertices_allocated, vertices + 1,
+		sizeof(VERTEX_KEY));
+	vertex_key[vertices] = *key;
+	vertex_table[slot] = vertices;
+	return vertices++;
+}
+/*------------------------------------------------------------------------------
+	"7", "7/3", "7//2" or "7/3/2", negative counting back from the end
+------------------------------------------------------------------------------*/
+static long resolve(long index, long count)
+{
+	if(index < 0) index += count + 1;
+	return index >= 1 && index <= count ? index : -1;
+}
+
+static bool parse_face_vertex(const char *text, VERTEX_KEY *key)
+{
+	char *end;
+
+	memset(key, 0, sizeof(*key));
+	key->position = resolve(strtol(text, &end, 10), positions.count / 3);
+	if(end == text || key->position < 0) return false;
+
+	if(*end == '/')
+	{
+		text = end + 1;
+		if(*text != '/')
+		{
+			key->texcoord = resolve(strtol(text, &end, 10), texcoords.count / 2);
+			if(end == text || key->texcoord < 0) return false;
+			have_texcoords = true;
+		}
+		else
+		{
+			end = (char *)text;
+		}
+		if(*end == '/')
+		{
+			text = end + 1;
+			key->normal = resolve(strtol(text, &end, 10), normals.count / 3);
+			if(end == text || key->normal < 0) return false;
+			have_normals = true;
+		}
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static int use_submesh(const char *name)
+{
+	int index;
+
+	for(index = 0; index < submeshes; index++)
+		if(strncmp(submesh[index].name, name, OGLH_MESH_NAME_SIZE - 1) == 0)
+			return index;
+
+	if(submeshes == submeshes_allocated)
+	{
+		submeshes_allocated = submeshes_allocated ? 2 * submeshes_allocated : 16;
+		if((submesh = realloc(submesh,
+			submeshes_allocated * sizeof(SUBMESH_INDICES))) == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	memset(&submesh[submeshes], 0, sizeof(SUBMESH_INDICES));
+	snprintf(submesh[submeshes].name, OGLH_MESH_NAME_SIZE, "%s", name);
+	return submeshes++;
+}
+
+static bool read_obj(const char *file_name)
+{
+	FILE *obj_fptr;
+	char line[4096], *text, *token, *save;
+	float value[3];
+	VERTEX_KEY key;
+	uint32_t face[MAX_FACE_VERTICES];
+	int current = -1, corners, corner;
+	long line_number = 0, skipped = 0;
+
+	if((obj_fptr = fopen(file_name, "rt")) == NULL)
+	{
+		fprintf(stderr, "can't open %s\n", file_name);
+		return false;
+	}
+
+	while(fgets(line, sizeof(line), obj_fptr) != NULL)
+	{
+		line_number++;
+		for(text = line; isspace((unsigned char)*text); text++);
+
+		if(strncmp(text, "v ", 2) == 0)
+		{
+			value[0] = value[1] = value[2] = 0;
+			sscanf(text + 2, "%f %f %f", &value[0], &value[1], &value[2]);
+			add_floats(&positions, value, 3);
+		}
+		else if(strncmp(text, "vt ", 3) == 0)
+		{
+			value[0] = value[1] = 0;
+			sscanf(text + 3, "%f %f", &value[0], &value[1]);
+			add_floats(&texcoords, value, 2);
+		}
+		else if(strncmp(text, "vn ", 3) == 0)
+		{
+			value[0] = value[1] = value[2] = 0;
+			sscanf(text + 3, "%f %f %f", &value[0], &value[1], &value[2]);
+			add_floats(&normals, value, 3);
+		}
+		else if(strncmp(text, "usemtl ", 7) == 0)
+		{
+			text[strcspn(text, "\r\n")] = '\0';
+			for(text += 7; isspace((unsigned char)*text); text++);
+			current = use_submesh(text);
+		}
+		else if(strncmp(text, "f ", 2) == 0)
+		{
+			if(current < 0) current = use_submesh("default");
+
+			corners = 0;
+			for(token = strtok_r(text + 2, " \t\r\n", &save); token != NULL;
+				token = strtok_r(NULL, " \t\r\n", &save))
+			{
+				if(corners == MAX_FACE_VERTICES || !parse_face_vertex(token, &key))
+				{
+					corners = -1;
+					break;
+				}
+				face[corners++] = vertex_for(&key);
+			}
+			if(corners < 3)
+			{
+				if(skipped++ == 0)
+					fprintf(stderr, "%s:%ld: bad face skipped\n", file_name,
+						line_number);
+				continue;
+			}
+
+			for(corner = 1; corner + 1 < corners; corner++)
+			{
+				add_index(&submesh[current].indices, face[0]);
+				add_index(&submesh[current].indices, face[corner]);
+				add_index(&submesh[current].indices, face[corner + 1]);
+			}
+		}
+	}
+	fclose(obj_fptr);
+
+	if(skipped > 1) fprintf(stderr, "%ld bad faces skipped\n", skipped);
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static void pad_to(FILE *mesh_fptr, uint64_t offset)
+{
+	while((uint64_t)ftell(mesh_fptr) < offset) fputc(0, mesh_fptr);
+}
+
+static uint64_t aligned(uint64_t offset)
+{
+	return (offset + OGLH_MESH_ALIGNMENT - 1) & ~(uint64_t)(OGLH_MESH_ALIGNMENT - 1);
+}
+
+static bool write_mesh(const char *file_name)
+{
+	FILE *mesh_fptr;
+	OGLH_MESH_HEADER header;
+	OGLH_MESH_SUBMESH entry;
+	OGLH_MESH_ATTRIBUTE *attribute;
+	float vertex[8], *position;
+	uint16_t short_index;
+	long index, total_indices = 0, first_index = 0, i;
+	int part, floats, axis;
+
+	for(part = 0; part < submeshes; part++)
+		total_indices += submesh[part].indices.count;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, OGLH_MESH_MAGIC, 8);
+	header.header_bytes = sizeof(header);
+	header.index_type = vertices <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	header.submesh_count = submeshes;
+	header.vertex_count = vertices;
+	header.index_count = total_indices;
+
+	attribute = &header.attribute[header.attribute_count++];
+	attribute->location = LOCATION_POSITION;
+	attribute->components = 3;
+	attribute->type = GL_FLOAT;
+	attribute->offset = header.vertex_stride;
+	header.vertex_stride += 3 * sizeof(float);
+	if(have_normals)
+	{
+		attribute = &header.attribute[header.attribute_count++];
+		attribute->location = LOCATION_NORMAL;
+		attribute->components = 3;
+		attribute->type = GL_FLOAT;
+		attribute->offset = header.vertex_stride;
+		header.vertex_stride += 3 * sizeof(float);
+	}
+	if(have_texcoords)
+	{
+		attribute = &header.attribute[header.attribute_count++];
+		attribute->location = LOCATION_TEXCOORD;
+		attribute->components = 2;
+		attribute->type = GL_FLOAT;
+		attribute->offset = header.vertex_stride;
+		header.vertex_stride += 2 * sizeof(float);
+	}
+
+	header.vertex_offset = aligned(sizeof(header) +
+		(uint64_t)submeshes * sizeof(OGLH_MESH_SUBMESH));
+	header.index_offset = aligned(header.vertex_offset +
+		(uint64_t)vertices * header.vertex_stride);
+
+	for(axis = 0; axis < 3; axis++)
+	{
+		header.bounds_min[axis] = vertices ? FLT_MAX : 0;
+		header.bounds_max[axis] = vertices ? -FLT_MAX : 0;
+	}
+	for(index = 0; index < vertices; index++)
+	{
+		position = &positions.value[3 * (vertex_key[index].position - 1)];
+		for(axis = 0; axis < 3; axis++)
+		{
+			if(position[axis] < header.bounds_min[axis])
+				header.bounds_min[axis] = position[axis];
+			if(position[axis] > header.bounds_max[axis])
+				header.bounds_max[axis] = position[axis];
+		}
+	}
+
+	if((mesh_fptr = fopen(file_name, "wb")) == NULL)
+	{
+		fprintf(stderr, "can't create %s\n", file_name);
+		return false;
+	}
+	fwrite(&header, sizeof(header), 1, mesh_fptr);
+
+	for(part = 0; part < submeshes; part++)
+	{
+		memset(&entry, 0, sizeof(entry));
+		entry.first_index = first_index;
+		entry.index_count = submesh[part].indices.count;
+		memcpy(entry.name, submesh[part].name, OGLH_MESH_NAME_SIZE);
+		fwrite(&entry, sizeof(entry), 1, mesh_fptr);
+		first_index += entry.index_count;
+	}
+
+	pad_to(mesh_fptr, header.vertex_offset);
+	for(index = 0; index < vertices; index++)
+	{
+		memcpy(vertex, &positions.value[3 * (vertex_key[index].position - 1)],
+			3 * sizeof(float));
+		floats = 3;
+		if(have_normals)
+		{
+			if(vertex_key[index].normal)
+				memcpy(vertex + floats,
+					&normals.value[3 * (vertex_key[index].normal - 1)],
+					3 * sizeof(float));
+			else
+				memset(vertex + floats, 0, 3 * sizeof(float));
+			floats += 3;
+		}
+		if(have_texcoords)
+		{
+			if(vertex_key[index].texcoord)
+				memcpy(vertex + floats,
+					&texcoords.value[2 * (vertex_key[index].texcoord - 1)],
+					2 * sizeof(float));
+			else
+				memset(vertex + floats, 0, 2 * sizeof(float));
+			floats += 2;
+		}
+		fwrite(vertex, floats * sizeof(float), 1, mesh_fptr);
+	}
+
+	pad_to(mesh_fptr, header.index_offset);
+	for(part = 0; part < submeshes; part++)
+	{
+		if(header.index_type == GL_UNSIGNED_INT)
+		{
+			fwrite(submesh[part].indices.value, sizeof(uint32_t),
+				submesh[part].indices.count, mesh_fptr);
+			continue;
+		}
+		for(i = 0; i < submesh[part].indices.count; i++)
+		{
+			short_index = submesh[part].indices.value[i];
+			fwrite(&short_index, sizeof(short_index), 1, mesh_fptr);
+		}
+	}
+
+	if(fclose(mesh_fptr) != 0)
+	{
+		fprintf(stderr, "writing %s failed\n", file_name);
+		return false;
+	}
+	return true;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	int part;
+
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage: %s model.obj model.mesh\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(!read_obj(argv[1])) return EXIT_FAILURE;
+	if(vertices == 0)
+	{
+		fprintf(stderr, "%s has no faces\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	if(!write_mesh(argv[2])) return EXIT_FAILURE;
+
+	printf("%s: %ld vertices (%s%s), %d submeshes\n", argv[2], vertices,
+		have_normals ? "normals" : "no normals",
+		have_texcoords ? ", texture coordinates" : "", submeshes);
+	for(part = 0; part < submeshes; part++)
+	{
+		printf("\t%-32s %ld triangles\n", submesh[part].name,
+			submesh[part].indices.count / 3);
+	}
+	return EXIT_SUCCESS;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
@@ -0,0 +1,80 @@
+/*------------------------------------------------------------------------------
+	oglh_replay -- replays an oglh_ trace on a headless context
+
+	oglh_replay trace_file [frames.csv]
+
+	Shaders are installed again from their files so run it from the
+	directory the application ran in. Build it along with the helpers:
+
+	cc -O2 -DGL_GLEXT_PROTOTYPES -DOGLH_TRACE -I.. oglh_replay.c \
+		../OpenGL_helpers.c ../OpenGL_registry.c ../OpenGL_trace.c \
+		../OpenGL_texture_units.c ../OpenGL_state.c ../OpenGL_instancing.c \
+		../OpenGL_stream.c ../OpenGL_indirect.c ../OpenGL_headless.c \
+		../OpenGL_feedback.c ../OpenGL_shader_pack.c -lEGL -lGL -lm -o oglh_replay
+------------------------------------------------------------------------------*/
+#include "OpenGL_helpers.h"
+#include "OpenGL_trace.h"
+#include "OpenGL_headless.h"
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	OGLH_TRACE_REPLAY_RESULT result;
+	FILE *csv_fptr = NULL;
+	bool intact;
+
+	if(argc < 2)
+	{
+		fprintf(stderr, "usage: %s trace_file [frames.csv]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(!oglh_create_headless_context(4, 5) &&
+		!oglh_create_headless_context(3, 3))
+	{
+		return EXIT_FAILURE;
+	}
+
+	if(argc > 2 && (csv_fptr = fopen(argv[2], "w")) == NULL)
+	{
+		oglh_program_error(__FILE__, __LINE__, __FUNC__,
+			"can't open %s", argv[2]);
+	}
+
+	intact = oglh_trace_replay(argv[1], csv_fptr, &result);
+	if(csv_fptr != NULL) fclose(csv_fptr);
+
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+	printf(ANSI_COLOR_GREEN "\treplay of %s\n" ANSI_COLOR_RESET, argv[1]);
+	printf("\t%-20s %ld\n", "frames", result.frames);
+	printf("\t%-20s %ld\n", "records", result.records);
+	if(result.frames > 0)
+	{
+		printf("\t%-20s %9.3f %9.3f %9.3f\n", "cpu ms min avg max",
+			result.cpu_ms_min, result.cpu_ms_total / result.frames,
+			result.cpu_ms_max);
+		printf("\t%-20s %9.3f %9.3f %9.3f\n", "gpu ms min avg max",
+			result.gpu_ms_min, result.gpu_ms_total / result.frames,
+			result.gpu_ms_max);
+	}
+	printf
+	(
+		"        "
+		"--------------------------------------------"
+		"---------------------------"
+		"\n"
+	);
+
+	oglh_destroy_headless_context();
+	return intact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
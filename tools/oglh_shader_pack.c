@@ -0,0 +1,326 @@
+/*------------------------------------------------------------------------------
+	oglh_shader_pack -- packs shaders into one file for oglh_shader_pack_open
+
+	oglh_shader_pack [-b] [-c embedded.c] -o shaders.pack shader_name ...
+
+	Each shader_name is given as it is to oglh_install_shader: its .vert,
+	and its .frag and .h where they exist, are packed under the names the
+	loader would open, so run it from the directory the application runs
+	in. -b links every program with a .frag on this machine's driver and
+	packs the binaries too; they are used only where the renderer and
+	version match. -c also writes a C file defining
+	oglh_embedded_shader_pack and oglh_embedded_shader_pack_bytes, for
+	oglh_shader_pack_use_memory.
+
+	cc -O2 -DGL_GLEXT_PROTOTYPES -I.. oglh_shader_pack.c \
+		../OpenGL_helpers.c ../OpenGL_registry.c ../OpenGL_trace.c \
+		../OpenGL_texture_units.c ../OpenGL_state.c ../OpenGL_instancing.c \
+		../OpenGL_stream.c ../OpenGL_indirect.c ../OpenGL_headless.c \
+		../OpenGL_feedback.c ../OpenGL_shader_pack.c \
+		-lEGL -lGL -lm -o oglh_shader_pack
+------------------------------------------------------------------------------*/
+#include "OpenGL_helpers.h"
+#include "OpenGL_headless.h"
+#include "OpenGL_shader_pack.h"
+#include <unistd.h>			//	getopt
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+#define MAX_ENTRIES		4096
+
+typedef struct pack_entry
+{
+	char name[FILENAME_MAX];
+	void *data;
+	size_t bytes;
+	GLenum binary_format;
+	uint64_t source_hash;
+}
+PACK_ENTRY;
+
+static PACK_ENTRY entry[MAX_ENTRIES];
+static int entries;
+static char renderer[512];
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+static PACK_ENTRY *new_entry(const char *name)
+{
+	if(entries == MAX_ENTRIES)
+	{
+		fprintf(stderr, "more than %d files\n", MAX_ENTRIES);
+		exit(EXIT_FAILURE);
+	}
+	snprintf(entry[entries].name, sizeof(entry[entries].name), "%s", name);
+	return &entry[entries++];
+}
+
+static bool add_file(const char *file_name, bool required)
+{
+	PACK_ENTRY *file;
+	FILE *file_fptr;
+	long bytes;
+
+	if((file_fptr = fopen(file_name, "rb")) == NULL)
+	{
+		if(required) fprintf(stderr, "can't open %s\n", file_name);
+		return !required;
+	}
+
+	fseek(file_fptr, 0, SEEK_END);
+	bytes = ftell(file_fptr);
+	rewind(file_fptr);
+
+	file = new_entry(file_name);
+	if((file->data = malloc(bytes > 0 ? bytes : 1)) == NULL ||
+		(bytes > 0 && fread(file->data, bytes, 1, file_fptr) != 1))
+	{
+		fprintf(stderr, "can't read %s\n", file_name);
+		fclose(file_fptr);
+		return false;
+	}
+	file->bytes = bytes;
+	fclose(file_fptr);
+	return true;
+}
+/*------------------------------------------------------------------------------
+	Linked from the sources exactly as the loader will give them to GL
+------------------------------------------------------------------------------*/
+static GLuint compile(GLenum shader_type, const char *source)
+{
+	GLuint shader_id = glCreateShader(shader_type);
+	GLint success;
+
+	glShaderSource(shader_id, 1, &source, NULL);
+	glCompileShader(shader_id);
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+	if(!success)
+	{
+		glDeleteShader(shader_id);
+		return 0;
+	}
+	return shader_id;
+}
+
+static bool add_binary(const char *shader_name)
+{
+	char *vertex_source, *fragment_source;
+	GLuint program_id, vertex_shader_id, fragment_shader_id;
+	GLint success = GL_FALSE, length = 0;
+	PACK_ENTRY *binary;
+
+	vertex_source = oglh_load_shader_source(shader_name, GL_VERTEX_SHADER);
+	fragment_source = oglh_load_shader_source(shader_name, GL_FRAGMENT_SHADER);
+	if(vertex_source == NULL || fragment_source == NULL)
+	{
+		free(vertex_source);
+		free(fragment_source);
+		return false;
+	}
+
+	program_id = glCreateProgram();
+	glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	vertex_shader_id = compile(GL_VERTEX_SHADER, vertex_source);
+	fragment_shader_id = compile(GL_FRAGMENT_SHADER, fragment_source);
+	if(vertex_shader_id != 0 && fragment_shader_id != 0)
+	{
+		glAttachShader(program_id, vertex_shader_id);
+		glAttachShader(program_id, fragment_shader_id);
+		glLinkProgram(program_id);
+		glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+	}
+	glDeleteShader(vertex_shader_id);
+	glDeleteShader(fragment_shader_id);
+
+	if(success) glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length > 0)
+	{
+		binary = new_entry(shader_name);
+		binary->source_hash = oglh_shader_pack_hash(vertex_source,
+			fragment_source);
+		if((binary->data = malloc(length)) == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+		glGetProgramBinary(program_id, length, &length, &binary->binary_format,
+			binary->data);
+		binary->bytes = length;
+	}
+	glDeleteProgram(program_id);
+	free(vertex_source);
+	free(fragment_source);
+
+	if(length <= 0) fprintf(stderr, "no binary for %s\n", shader_name);
+	return length > 0;
+}
+/*------------------------------------------------------------------------------
+	Header, table, names, then the data 8 byte aligned
+------------------------------------------------------------------------------*/
+static int by_name(const void *a, const void *b)
+{
+	return strcmp(((const PACK_ENTRY *)a)->name, ((const PACK_ENTRY *)b)->name);
+}
+
+static unsigned char *build_pack(size_t *pack_bytes)
+{
+	OGLH_SHADER_PACK_HEADER *header;
+	OGLH_SHADER_PACK_ENTRY *table;
+	unsigned char *pack;
+	size_t bytes, name_offset, data_offset;
+	int index;
+
+	qsort(entry, entries, sizeof(PACK_ENTRY), by_name);
+	for(index = 1; index < entries; index++)
+	{
+		if(strcmp(entry[index - 1].name, entry[index].name) == 0)
+		{
+			fprintf(stderr, "%s is packed twice\n", entry[index].name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	bytes = sizeof(*header) + entries * sizeof(*table);
+	name_offset = bytes;
+	for(index = 0; index < entries; index++) bytes += strlen(entry[index].name) + 1;
+	bytes += strlen(renderer) + 1;
+	for(index = 0; index < entries; index++)
+		bytes = ((bytes + 7) & ~(size_t)7) + entry[index].bytes;
+
+	if(bytes > UINT32_MAX || (pack = calloc(1, bytes)) == NULL)
+	{
+		fprintf(stderr, "a pack of %zu bytes is too big\n", bytes);
+		exit(EXIT_FAILURE);
+	}
+
+	header = (OGLH_SHADER_PACK_HEADER *)pack;
+	table = (OGLH_SHADER_PACK_ENTRY *)(header + 1);
+	memcpy(header->magic, OGLH_SHADER_PACK_MAGIC, sizeof(header->magic));
+	header->bytes = bytes;
+	header->entry_count = entries;
+
+	for(index = 0; index < entries; index++)
+	{
+		table[index].name_offset = name_offset;
+		strcpy((char *)pack + name_offset, entry[index].name);
+		name_offset += strlen(entry[index].name) + 1;
+	}
+	if(renderer[0] != '\0')
+	{
+		header->renderer_offset = name_offset;
+		strcpy((char *)pack + name_offset, renderer);
+	}
+	data_offset = name_offset + strlen(renderer) + 1;
+
+	for(index = 0; index < entries; index++)
+	{
+		data_offset = (data_offset + 7) & ~(size_t)7;
+		table[index].data_offset = data_offset;
+		table[index].data_bytes = entry[index].bytes;
+		table[index].binary_format = entry[index].binary_format;
+		table[index].source_hash = entry[index].source_hash;
+		memcpy(pack + data_offset, entry[index].data, entry[index].bytes);
+		data_offset += entry[index].bytes;
+	}
+
+	*pack_bytes = bytes;
+	return pack;
+}
+
+static bool write_c_file(const char *file_name, const unsigned char *pack,
+	size_t bytes)
+{
+	FILE *c_fptr;
+	size_t index;
+
+	if((c_fptr = fopen(file_name, "w")) == NULL)
+	{
+		fprintf(stderr, "can't write %s\n", file_name);
+		return false;
+	}
+
+	fprintf(c_fptr, "// made by oglh_shader_pack, for oglh_shader_pack_use_memory\n"
+		"#include <stddef.h>\n\n"
+		"const size_t oglh_embedded_shader_pack_bytes = %zu;\n"
+		"const unsigned char oglh_embedded_shader_pack[] "
+		"__attribute__((aligned(64))) =\n{", bytes);
+	for(index = 0; index < bytes; index++)
+	{
+		fprintf(c_fptr, "%s0x%02x,", index % 16 ? " " : "\n\t", pack[index]);
+	}
+	fprintf(c_fptr, "\n};\n");
+	return fclose(c_fptr) == 0;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+	const char *pack_file_name = NULL, *c_file_name = NULL;
+	char file_name[FILENAME_MAX];
+	bool binaries = false, fragment;
+	unsigned char *pack;
+	size_t bytes;
+	FILE *pack_fptr;
+	int option, index, binary_count = 0;
+
+	while((option = getopt(argc, argv, "bc:o:")) != -1)
+	{
+		switch(option)
+		{
+			case 'b':	binaries = true;			break;
+			case 'c':	c_file_name = optarg;		break;
+			case 'o':	pack_file_name = optarg;	break;
+			default:	pack_file_name = NULL; optind = argc;	break;
+		}
+	}
+	if(pack_file_name == NULL || optind >= argc)
+	{
+		fprintf(stderr, "usage: %s [-b] [-c embedded.c] -o shaders.pack "
+			"shader_name ...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if(binaries)
+	{
+		if(!oglh_create_headless_context(4, 5) &&
+			!oglh_create_headless_context(4, 1))
+		{
+			return EXIT_FAILURE;
+		}
+		snprintf(renderer, sizeof(renderer), "%s\n%s",
+			(const char *)glGetString(GL_RENDERER),
+			(const char *)glGetString(GL_VERSION));
+	}
+
+	for(index = optind; index < argc; index++)
+	{
+		snprintf(file_name, sizeof(file_name), "%s.vert", argv[index]);
+		if(!add_file(file_name, true)) return EXIT_FAILURE;
+		snprintf(file_name, sizeof(file_name), "%s.frag", argv[index]);
+		fragment = access(file_name, R_OK) == 0;
+		if(!add_file(file_name, false)) return EXIT_FAILURE;
+		snprintf(file_name, sizeof(file_name), "%s.h", argv[index]);
+		if(!add_file(file_name, false)) return EXIT_FAILURE;
+
+		if(binaries && fragment && add_binary(argv[index])) binary_count++;
+	}
+
+	pack = build_pack(&bytes);
+	if((pack_fptr = fopen(pack_file_name, "wb")) == NULL ||
+		fwrite(pack, bytes, 1, pack_fptr) != 1 || fclose(pack_fptr) != 0)
+	{
+		fprintf(stderr, "writing %s failed\n", pack_file_name);
+		return EXIT_FAILURE;
+	}
+	if(c_file_name != NULL && !write_c_file(c_file_name, pack, bytes))
+		return EXIT_FAILURE;
+
+	printf("%s: %d files, %d binaries, %zu bytes\n", pack_file_name,
+		entries - binary_count, binary_count, bytes);
+	free(pack);
+	return EXIT_SUCCESS;
+}
+/*------------------------------------------------------------------------------
+
+------------------------------------------------------------------------------*/